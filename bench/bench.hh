@@ -0,0 +1,126 @@
+#ifndef BENCH_HH
+#define BENCH_HH
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+//Minimal benchmark harness. Results are printed as CSV lines
+//benchmark,type,input,mode,ns_per_item so that runs of different versions
+//can be compared with other tools.
+
+//Keeps the compiler from optimizing away the computation of v
+template <typename T>
+inline void do_not_optimize(const T& v) {
+  asm volatile("" : : "r,m"(v) : "memory");
+}
+
+//Keeps the compiler from assuming anything about the memory p points to
+inline void clobber(const void* p) {
+  asm volatile("" : : "r"(p) : "memory");
+}
+
+//Returns x, which the compiler can no longer see through
+template <typename T>
+inline T opaque(T x) {
+  asm volatile("" : "+r"(x));
+  return x;
+}
+
+//Calls f, which processes items elements per call, repeatedly and returns the
+//fastest time per element in nanoseconds over runs of at least min_ms each.
+template <typename F>
+double measure(F f, size_t items, int runs = 5, int min_ms = 10) {
+  typedef std::chrono::steady_clock clock;
+  double best = 1e300;
+  for(int run = 0; run < runs; ++run) {
+    size_t calls = 0;
+    auto start = clock::now();
+    auto elapsed = clock::duration::zero();
+    do {
+      f();
+      ++calls;
+      elapsed = clock::now() - start;
+    } while(elapsed < std::chrono::milliseconds(min_ms));
+    double ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    best = std::min(best, ns / double(calls * items));
+  }
+  return best;
+}
+
+//Benchmarks whose name does not contain the first command line argument are skipped
+struct bench_filter {
+  const char* substr = nullptr;
+  bool operator()(const char* benchmark) const {
+    return substr == nullptr || std::strstr(benchmark, substr) != nullptr;
+  }
+};
+
+inline void report_header() {
+  std::printf("benchmark,type,input,mode,ns_per_item\n");
+}
+
+inline void report(const char* benchmark, const char* type, const char* input, const char* mode, double ns) {
+  std::printf("%s,%s,%s,%s,%.4f\n", benchmark, type, input, mode, ns);
+  std::fflush(stdout);
+}
+
+template <typename T> inline const char* type_name();
+template <> inline const char* type_name<int8_t>() { return "int8_t"; }
+template <> inline const char* type_name<uint8_t>() { return "uint8_t"; }
+template <> inline const char* type_name<int16_t>() { return "int16_t"; }
+template <> inline const char* type_name<uint16_t>() { return "uint16_t"; }
+template <> inline const char* type_name<int32_t>() { return "int32_t"; }
+template <> inline const char* type_name<uint32_t>() { return "uint32_t"; }
+template <> inline const char* type_name<int64_t>() { return "int64_t"; }
+template <> inline const char* type_name<uint64_t>() { return "uint64_t"; }
+
+//Calls f.template operator()<T>() for each of the types of test/driver.hh IntTypes.
+//The benchmarks cannot include driver.hh as it needs gtest.
+template <typename F>
+void for_each_int_type(F f) {
+  f(int8_t());
+  f(uint8_t());
+  f(int16_t());
+  f(uint16_t());
+  f(int32_t());
+  f(uint32_t());
+  f(int64_t());
+  f(uint64_t());
+}
+
+//Distributions of input values. Sparse and dense values have about 1/8 and 7/8 of
+//their bits set, which is the worst case for some of the portable fallbacks.
+enum input_kind { input_random, input_sparse, input_dense };
+
+inline const char* input_name(input_kind kind) {
+  return kind == input_random ? "random" : kind == input_sparse ? "sparse" : "dense";
+}
+
+//n values of the given distribution, the same for every run with the same seed
+template <typename T>
+std::vector<T> make_inputs(size_t n, input_kind kind = input_random, uint64_t seed = 0) {
+  std::vector<T> v(n);
+  uint64_t r = 0x9E3779B97F4A7C15ULL ^ seed;
+  auto next = [&r]() {
+    r ^= r << 13; r ^= r >> 7; r ^= r << 17;
+    return r;
+  };
+  for(auto& x : v) {
+    uint64_t w = next();
+    if(kind == input_sparse) { w &= next() & next(); }
+    if(kind == input_dense) { w |= next() | next(); }
+    x = T(w);
+  }
+  return v;
+}
+
+template <typename T>
+std::vector<T> random_inputs(size_t n, uint64_t seed = 0) {
+  return make_inputs<T>(n, input_random, seed);
+}
+
+#endif
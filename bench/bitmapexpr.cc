@@ -0,0 +1,61 @@
+#include <bitmap_expr.hh>
+#include "bench.hh"
+
+#include <string>
+
+using namespace std;
+
+//One pass per operator into the result, then one more to count it
+static size_t per_operator(const std::vector<std::vector<uint64_t>>& in, std::vector<uint64_t>& out) {
+  const size_t n = out.size();
+  for(size_t w = 0; w < n; ++w) out[w] = in[0][w] & in[1][w];
+  for(size_t k = 2; k < in.size(); ++k) {
+    const uint64_t* x = in[k].data();
+    if(k % 2 == 0) {
+      for(size_t w = 0; w < n; ++w) out[w] |= x[w];
+    } else {
+      for(size_t w = 0; w < n; ++w) out[w] &= ~x[w];
+    }
+  }
+  return popcount(out.data(), n);
+}
+
+//((a & b) | c) & ~d | e ... over nin bitmaps of 2^20 bits
+static void bench_chain(size_t nin) {
+  const size_t nwords = 1 << 14;
+  std::vector<std::vector<uint64_t>> in;
+  for(size_t k = 0; k < nin; ++k) {
+    in.push_back(random_inputs<uint64_t>(nwords, k));
+  }
+  std::vector<uint64_t> out(nwords);
+  bitmap_expr e(nwords);
+  int root = e.apply(bitmap_op::bit_and, e.input(in[0].data()), e.input(in[1].data()));
+  for(size_t k = 2; k < nin; ++k) {
+    root = e.apply(k % 2 == 0 ? bitmap_op::bit_or : bitmap_op::bit_andnot, root, e.input(in[k].data()));
+  }
+  std::string input = std::to_string(nin) + "_inputs";
+
+  report("bitmap_expr", "uint64_t", input.c_str(), "per_operator", measure([&]() {
+    do_not_optimize(per_operator(in, out));
+    clobber(out.data());
+  }, nwords));
+  report("bitmap_expr", "uint64_t", input.c_str(), "evaluate", measure([&]() {
+    e.evaluate(root, out.data());
+    clobber(out.data());
+  }, nwords));
+  report("bitmap_expr", "uint64_t", input.c_str(), "evaluate_count", measure([&]() {
+    do_not_optimize(e.evaluate_count(root, out.data()));
+    clobber(out.data());
+  }, nwords));
+  report("bitmap_expr", "uint64_t", input.c_str(), "count", measure([&]() {
+    do_not_optimize(e.count(root));
+  }, nwords));
+}
+
+int main() {
+  report_header();
+  for(size_t nin : {2, 4, 8, 16, 32}) {
+    bench_chain(nin);
+  }
+  return 0;
+}
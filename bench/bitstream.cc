@@ -0,0 +1,74 @@
+#include <bit_stream.hh>
+#include "bench.hh"
+
+#include <string>
+
+using namespace std;
+
+//Reads one bit at a time, lsb first
+static uint64_t naive_read(const unsigned char* p, size_t& pos, int n) {
+  uint64_t x = 0;
+  for(int b = 0; b < n; ++b, ++pos) {
+    x |= uint64_t((p[pos / 8] >> (pos % 8)) & 1) << b;
+  }
+  return x;
+}
+
+//Items are bits. The rows stay in ns per bit like those of the other benchmarks, so that make run
+//gives one CSV. The throughput in bits per cycle at a clock of f GHz is 1 / (ns_per_item * f).
+template <bit_order Order>
+static void bench_order(const char* mode, const char* input, const std::vector<int>& widths) {
+  const size_t n = widths.size();
+  std::vector<uint64_t> values = random_inputs<uint64_t>(n);
+  size_t nbits = 0;
+  for(int w : widths) {
+    nbits += size_t(w);
+  }
+  std::vector<unsigned char> buf(nbits / 8 + 16);
+
+  report("bit_writer", "uint64_t", input, mode, measure([&]() {
+    bit_writer<Order> w(buf.data(), buf.size());
+    for(size_t i = 0; i < n; ++i) w.write(values[i], widths[i]);
+    do_not_optimize(w.flush());
+    clobber(buf.data());
+  }, nbits));
+  report("bit_reader", "uint64_t", input, mode, measure([&]() {
+    bit_reader<Order> r(buf.data(), buf.size());
+    uint64_t acc = 0;
+    for(size_t i = 0; i < n; ++i) acc += r.read(widths[i]);
+    do_not_optimize(acc);
+  }, nbits));
+}
+
+static void bench_widths(const char* input, const std::vector<int>& widths) {
+  size_t nbits = 0;
+  for(int w : widths) {
+    nbits += size_t(w);
+  }
+  std::vector<unsigned char> buf = random_inputs<unsigned char>(nbits / 8 + 16);
+  report("bit_reader", "uint64_t", input, "naive", measure([&]() {
+    size_t pos = 0;
+    uint64_t acc = 0;
+    for(int w : widths) acc += naive_read(buf.data(), pos, w);
+    do_not_optimize(acc);
+  }, nbits));
+  bench_order<bit_order::lsb_first>("lsb_first", input, widths);
+  bench_order<bit_order::msb_first>("msb_first", input, widths);
+}
+
+int main() {
+  report_header();
+  const size_t n = 1 << 16;
+  for(int width : {1, 8, 13, 32, 56}) {
+    std::string input = "width_" + std::to_string(width);
+    bench_widths(input.c_str(), std::vector<int>(n, width));
+  }
+  //Code lengths of a typical Huffman code
+  std::vector<uint64_t> r = random_inputs<uint64_t>(n, 1);
+  std::vector<int> widths(n);
+  for(size_t i = 0; i < n; ++i) {
+    widths[i] = 1 + int(r[i] % 15);
+  }
+  bench_widths("width_1_to_15", widths);
+  return 0;
+}
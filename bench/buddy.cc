@@ -0,0 +1,83 @@
+#include <buddy_allocator.hh>
+#include "bench.hh"
+
+#include <cstdlib>
+
+using namespace std;
+
+//Frees and replaces one block of a window of live blocks per item, on a region
+//large enough that every request succeeds.
+static void bench_churn(const char* type, size_t min_size, size_t max_size) {
+  const size_t window = 1000;
+  const size_t capacity = size_t(1) << 28;
+  std::vector<uint64_t> meta(buddy_allocator::metadata_words(capacity, 64));
+  void* region = std::malloc(capacity);
+  buddy_allocator a(region, capacity, 64, meta.data());
+
+  std::vector<uint64_t> r = random_inputs<uint64_t>(100003, 1);
+  std::vector<size_t> sizes(r.size());
+  for(size_t i = 0; i < r.size(); ++i) {
+    sizes[i] = min_size + size_t(r[i] % (max_size - min_size + 1));
+  }
+
+  std::vector<void*> live(window);
+  for(size_t i = 0; i < window; ++i) {
+    live[i] = a.allocate(sizes[i]);
+  }
+  size_t next = window;
+  report("alloc_free", type, "window1000", "buddy_allocator", measure([&]() {
+    for(size_t i = 0; i < window; ++i) {
+      a.deallocate(live[i], sizes[(next - window) % sizes.size()]);
+      live[i] = a.allocate(sizes[next % sizes.size()]);
+      ++next;
+    }
+    clobber(live.data());
+  }, window));
+
+  next = window;
+  for(size_t i = 0; i < window; ++i) {
+    a.deallocate(live[i], sizes[i]);
+    live[i] = std::malloc(sizes[i]);
+  }
+  report("alloc_free", type, "window1000", "malloc", measure([&]() {
+    for(size_t i = 0; i < window; ++i) {
+      std::free(live[i]);
+      live[i] = std::malloc(sizes[next % sizes.size()]);
+      ++next;
+    }
+    clobber(live.data());
+  }, window));
+  for(void* p : live) {
+    std::free(p);
+  }
+  std::free(region);
+}
+
+//A full region whose only free block alternates between the start and a random block past it,
+//so the lowest free block is far from the last one taken.
+static void bench_far() {
+  const size_t capacity = size_t(1) << 26;
+  std::vector<uint64_t> meta(buddy_allocator::metadata_words(capacity, 64));
+  char* region = static_cast<char*>(std::malloc(capacity));
+  buddy_allocator a(region, capacity, 64, meta.data());
+  while(a.allocate(64) != nullptr) {
+  }
+
+  std::vector<uint64_t> r = random_inputs<uint64_t>(1000, 2);
+  report("alloc_free", "64B", "far", "buddy_allocator", measure([&]() {
+    for(size_t i = 0; i < r.size(); ++i) {
+      size_t j = i % 2 == 0 ? 0 : size_t(r[i] % (capacity / 64));
+      a.deallocate(region + j * 64, 64);
+      clobber(a.allocate(64));
+    }
+  }, r.size()));
+  std::free(region);
+}
+
+int main() {
+  report_header();
+  bench_churn("64B-4KiB", 64, 4096);
+  bench_churn("64B-64KiB", 64, 65536);
+  bench_far();
+  return 0;
+}
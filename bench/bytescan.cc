@@ -0,0 +1,132 @@
+#include <byte_scan.hh>
+#include "bench.hh"
+
+#include <algorithm>
+#include <string>
+
+using namespace std;
+
+//Byte at a time scans
+static const void* loop_memchr(const void* p, int c, size_t n) {
+  const unsigned char* s = static_cast<const unsigned char*>(p);
+  for(size_t i = 0; i < n; ++i) {
+    if(s[i] == (unsigned char)c) return s + i;
+  }
+  return nullptr;
+}
+
+#if defined(__GLIBC__)
+//memrchr is a GNU extension, with a const overload in C++
+static const void* memrchr_libc(const void* p, int c, size_t n) {
+  return memrchr(p, c, n);
+}
+#endif
+
+static const void* loop_first_of(const void* p, size_t n, const char* set) {
+  const char* s = static_cast<const char*>(p);
+  const char* e = std::find_first_of(s, s + n, set, set + std::strlen(set));
+  return e == s + n ? nullptr : e;
+}
+
+//Splits text of n bytes into fields at each delimiter. Fields are about gap bytes long.
+//ns per byte
+static void bench_fields(size_t gap) {
+  const size_t n = 1 << 16;
+  std::string text(n, 'a');
+  uint64_t r = 0x9E3779B97F4A7C15ULL;
+  for(size_t i = 0; i < n; i += 1 + r % (2 * gap)) {
+    r ^= r << 13; r ^= r >> 7; r ^= r << 17;
+    text[i] = " ,=\t"[r % 4];
+  }
+  text.back() = '\0';
+  std::string input = "gap_" + std::to_string(gap);
+  const char* delims = " ,=\t";
+  const byte_set set(delims);
+
+  //The spaces only, or any of the delimiters
+  auto fields = [&](const void* (*f)(const void*, int, size_t)) {
+    size_t count = 0;
+    const char* p = text.data();
+    const char* e = p + n;
+    while(const void* d = f(p, ' ', size_t(e - p))) {
+      p = static_cast<const char*>(d) + 1;
+      ++count;
+    }
+    return count;
+  };
+  report("memchr", "char", input.c_str(), "loop", measure([&]() { do_not_optimize(fields(loop_memchr)); }, n));
+  report("memchr", "char", input.c_str(), "libc", measure([&]() { do_not_optimize(fields(std::memchr)); }, n));
+  report("memchr", "char", input.c_str(), "scan", measure([&]() { do_not_optimize(fields(scan_memchr)); }, n));
+
+  //The same fields from the end
+  auto fields_back = [&](const void* (*f)(const void*, int, size_t)) {
+    size_t count = 0;
+    const char* p = text.data();
+    const char* e = p + n;
+    while(const void* d = f(p, ' ', size_t(e - p))) {
+      e = static_cast<const char*>(d);
+      ++count;
+    }
+    return count;
+  };
+#if defined(__GLIBC__)
+  report("memrchr", "char", input.c_str(), "libc", measure([&]() { do_not_optimize(fields_back(memrchr_libc)); }, n));
+#endif
+  report("memrchr", "char", input.c_str(), "scan", measure([&]() { do_not_optimize(fields_back(scan_memrchr)); }, n));
+
+  report("first_of", "char", input.c_str(), "find_first_of", measure([&]() {
+    size_t count = 0;
+    const char* e = text.data() + n;
+    for(const char* p = text.data(); const void* d = loop_first_of(p, size_t(e - p), delims); p = static_cast<const char*>(d) + 1) {
+      ++count;
+    }
+    do_not_optimize(count);
+  }, n));
+  report("first_of", "char", input.c_str(), "strpbrk", measure([&]() {
+    size_t count = 0;
+    for(const char* p = text.data(); (p = std::strpbrk(p, delims)) != nullptr; ++p) {
+      ++count;
+    }
+    do_not_optimize(count);
+  }, n));
+  report("first_of", "char", input.c_str(), "scan", measure([&]() {
+    size_t count = 0;
+    const char* e = text.data() + n;
+    for(const char* p = text.data(); const void* d = scan_first_of(p, size_t(e - p), set); p = static_cast<const char*>(d) + 1) {
+      ++count;
+    }
+    do_not_optimize(count);
+  }, n));
+}
+
+//One scan of a long buffer which has the byte at the end or the start, ns per byte
+static void bench_long() {
+  const size_t n = 1 << 16;
+  std::string text(n, 'a');
+  text.back() = '\0';
+  const char* p = opaque(text.data());
+  report("strlen", "char", "64KiB", "libc", measure([&]() { do_not_optimize(std::strlen(p)); }, n));
+  report("strlen", "char", "64KiB", "scan", measure([&]() { do_not_optimize(scan_strlen(p)); }, n));
+  report("memchr", "char", "64KiB", "libc", measure([&]() { do_not_optimize(std::memchr(p, 0, n)); }, n));
+  report("memchr", "char", "64KiB", "scan", measure([&]() { do_not_optimize(scan_memchr(p, 0, n)); }, n));
+  text[0] = '\0';
+  text.back() = 'a';
+  report("memrchr", "char", "64KiB", "loop", measure([&]() {
+    size_t i = n;
+    while(i-- > 0 && p[i] != '\0') {}
+    do_not_optimize(i);
+  }, n));
+#if defined(__GLIBC__)
+  report("memrchr", "char", "64KiB", "libc", measure([&]() { do_not_optimize(memrchr(p, 0, n)); }, n));
+#endif
+  report("memrchr", "char", "64KiB", "scan", measure([&]() { do_not_optimize(scan_memrchr(p, 0, n)); }, n));
+}
+
+int main() {
+  report_header();
+  bench_long();
+  for(size_t gap : {4, 16, 64}) {
+    bench_fields(gap);
+  }
+  return 0;
+}
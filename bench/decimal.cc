@@ -0,0 +1,76 @@
+#include <decimal.hh>
+#include "bench.hh"
+
+#include <charconv>
+#include <cinttypes>
+#include <cstdio>
+
+using namespace std;
+
+//Digit counting by division, as in the logging and JSON writers
+template <typename T>
+static size_t loop_size(T x) {
+  typedef typename std::make_unsigned<T>::type U;
+  U u = x < 0 ? U(U(0) - U(x)) : U(x);
+  size_t n = 1 + (x < 0);
+  for(; u >= 10; u /= 10) {
+    ++n;
+  }
+  return n;
+}
+
+static int format(char* p, size_t n, uint32_t x) { return snprintf(p, n, "%" PRIu32, x); }
+static int format(char* p, size_t n, uint64_t x) { return snprintf(p, n, "%" PRIu64, x); }
+static int format(char* p, size_t n, int64_t x) { return snprintf(p, n, "%" PRId64, x); }
+
+//Random values of every number of digits, or of the full width
+template <typename T>
+static void bench_type(const char* input) {
+  std::vector<T> in = random_inputs<T>(1 << 12);
+  if(input[0] == 'm') {
+    for(size_t i = 0; i < in.size(); ++i) {
+      in[i] = T(shar(in[i], int(i % (sizeof(T) * CHAR_BIT))));
+    }
+  }
+  char buf[64];
+
+  report("decimal_size", type_name<T>(), input, "loop", measure([&]() {
+    size_t n = 0;
+    for(T x : in) n += loop_size(x);
+    do_not_optimize(n);
+  }, in.size()));
+  report("decimal_size", type_name<T>(), input, "ilog10", measure([&]() {
+    size_t n = 0;
+    for(T x : in) n += decimal_size(x);
+    do_not_optimize(n);
+  }, in.size()));
+
+  report("to_decimal", type_name<T>(), input, "snprintf", measure([&]() {
+    for(T x : in) {
+      do_not_optimize(format(buf, sizeof(buf), x));
+      clobber(buf);
+    }
+  }, in.size()));
+  report("to_decimal", type_name<T>(), input, "to_chars", measure([&]() {
+    for(T x : in) {
+      do_not_optimize(std::to_chars(buf, buf + sizeof(buf), x).ptr);
+      clobber(buf);
+    }
+  }, in.size()));
+  report("to_decimal", type_name<T>(), input, "to_decimal", measure([&]() {
+    for(T x : in) {
+      do_not_optimize(to_decimal(x, buf));
+      clobber(buf);
+    }
+  }, in.size()));
+}
+
+int main() {
+  report_header();
+  for(const char* input : {"full", "mixed"}) {
+    bench_type<uint32_t>(input);
+    bench_type<uint64_t>(input);
+    bench_type<int64_t>(input);
+  }
+  return 0;
+}
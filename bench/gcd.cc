@@ -0,0 +1,84 @@
+#include <bitops.hh>
+#include "bench.hh"
+
+#include <numeric>
+
+using namespace std;
+
+//Euclid's algorithm, one division per step
+template <typename T>
+static T euclid(T a, T b) {
+  while(b != 0) {
+    T t = T(a % b);
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+//ns per pair of 4096 pairs. The std::gcd of <numeric> is named with its own template arguments,
+//gcd(a, b) of 2 T picks the one in bitops.hh.
+template <typename T>
+static void bench_type() {
+  const size_t n = 1 << 12;
+  std::vector<T> a = random_inputs<T>(n);
+  std::vector<T> b = random_inputs<T>(2 * n);
+  b.erase(b.begin(), b.begin() + n);
+  std::vector<T> out(n);
+
+  //Random values, and values with a common factor of 2^k
+  for(const char* input : {"random", "shared_pow2"}) {
+    if(input[0] == 's') {
+      for(size_t i = 0; i < n; ++i) {
+        int k = int(a[i] % (sizeof(T) * CHAR_BIT / 2));
+        a[i] = shll(T(shlr(a[i], k) | 1u), k);
+        b[i] = shll(T(shlr(b[i], k) | 1u), k);
+      }
+    }
+    report("gcd", type_name<T>(), input, "euclid", measure([&]() {
+      for(size_t i = 0; i < n; ++i) out[i] = euclid(a[i], b[i]);
+      clobber(out.data());
+    }, n));
+    report("gcd", type_name<T>(), input, "std_gcd", measure([&]() {
+      for(size_t i = 0; i < n; ++i) out[i] = std::gcd<T, T>(a[i], b[i]);
+      clobber(out.data());
+    }, n));
+    report("gcd", type_name<T>(), input, "binary", measure([&]() {
+      for(size_t i = 0; i < n; ++i) out[i] = gcd(a[i], b[i]);
+      clobber(out.data());
+    }, n));
+    report("gcd", type_name<T>(), input, "batch", measure([&]() {
+      gcd(a.data(), b.data(), out.data(), n);
+      clobber(out.data());
+    }, n));
+  }
+
+  report("lcm", type_name<T>(), "shared_pow2", "std_lcm", measure([&]() {
+    for(size_t i = 0; i < n; ++i) out[i] = std::lcm<T, T>(a[i], b[i]);
+    clobber(out.data());
+  }, n));
+  report("lcm", type_name<T>(), "shared_pow2", "batch", measure([&]() {
+    lcm(a.data(), b.data(), out.data(), n);
+    clobber(out.data());
+  }, n));
+
+  report("isqrt", type_name<T>(), "random", "newton", measure([&]() {
+    for(size_t i = 0; i < n; ++i) out[i] = bitops_detail::isqrt_newton(a[i]);
+    clobber(out.data());
+  }, n));
+  report("isqrt", type_name<T>(), "random", "isqrt", measure([&]() {
+    for(size_t i = 0; i < n; ++i) out[i] = isqrt(a[i]);
+    clobber(out.data());
+  }, n));
+  report("isqrt", type_name<T>(), "random", "batch", measure([&]() {
+    isqrt(a.data(), out.data(), n);
+    clobber(out.data());
+  }, n));
+}
+
+int main() {
+  report_header();
+  bench_type<uint32_t>();
+  bench_type<uint64_t>();
+  return 0;
+}
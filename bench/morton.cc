@@ -0,0 +1,59 @@
+#include <bitops.hh>
+#include "bench.hh"
+
+using namespace std;
+
+//Encoding n points one at a time against the batch encoder
+template <typename T>
+void bench_morton() {
+  //Not a power of 2, so that the arrays do not alias in the L1 cache
+  const size_t n = 1000;
+  std::vector<T> xs = random_inputs<T>(n, 1);
+  std::vector<T> ys = random_inputs<T>(n, 2);
+  std::vector<T> zs = random_inputs<T>(n, 3);
+  std::vector<T> out(n);
+
+  report("morton2", type_name<T>(), "random", "scalar", measure([&]() {
+    for(size_t i = 0; i < n; ++i) out[i] = morton2(xs[i], ys[i]);
+    clobber(out.data());
+  }, n));
+  report("morton2", type_name<T>(), "random", "batch", measure([&]() {
+    morton2(xs.data(), ys.data(), out.data(), n);
+    clobber(out.data());
+  }, n));
+  report("morton2_decode", type_name<T>(), "random", "scalar", measure([&]() {
+    for(size_t i = 0; i < n; ++i) {
+      xs[i] = morton2_x(out[i]);
+      ys[i] = morton2_y(out[i]);
+    }
+    clobber(xs.data());
+    clobber(ys.data());
+  }, n));
+
+  report("morton3", type_name<T>(), "random", "scalar", measure([&]() {
+    for(size_t i = 0; i < n; ++i) out[i] = morton3(xs[i], ys[i], zs[i]);
+    clobber(out.data());
+  }, n));
+  report("morton3", type_name<T>(), "random", "batch", measure([&]() {
+    morton3(xs.data(), ys.data(), zs.data(), out.data(), n);
+    clobber(out.data());
+  }, n));
+  report("morton3_decode", type_name<T>(), "random", "scalar", measure([&]() {
+    for(size_t i = 0; i < n; ++i) {
+      xs[i] = morton3_x(out[i]);
+      ys[i] = morton3_y(out[i]);
+      zs[i] = morton3_z(out[i]);
+    }
+    clobber(xs.data());
+    clobber(ys.data());
+    clobber(zs.data());
+  }, n));
+}
+
+int main() {
+  report_header();
+  bench_morton<uint16_t>();
+  bench_morton<uint32_t>();
+  bench_morton<uint64_t>();
+  return 0;
+}
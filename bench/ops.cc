@@ -0,0 +1,254 @@
+#include <bitops.hh>
+#include "bench.hh"
+
+#include <array>
+#include <type_traits>
+
+using namespace std;
+
+//Times every function over every integer type and input distribution, both as a
+//stream of independent calls (throughput) and as a chain where each call needs the
+//result of the previous one (latency). Pass a substring of the benchmark names as
+//the first argument to run only some of them.
+
+//Number of elements per call, not a power of 2 so that the arrays do not alias in the L1 cache
+static const size_t n = 1000;
+
+//Times f(x, y) where x and y are drawn from the same distribution
+template <typename T, typename F>
+void bench_op(const bench_filter& filter, const char* name, F f) {
+  if(!filter(name)) {
+    return;
+  }
+  for(input_kind kind : {input_random, input_sparse, input_dense}) {
+    std::vector<T> xs = make_inputs<T>(n, kind, 1);
+    std::vector<T> ys = make_inputs<T>(n, kind, 2);
+    std::vector<T> out(n);
+    const T* x = xs.data();
+    const T* y = ys.data();
+    T* o = out.data();
+
+    report(name, type_name<T>(), input_name(kind), "throughput", measure([=]() {
+      for(size_t i = 0; i < n; ++i) {
+        o[i] = T(f(x[i], y[i]));
+      }
+      clobber(o);
+    }, n, 3, 5));
+
+    //The result is fed back through an and with an opaque 0, which keeps the input
+    //distribution. The identity benchmark measures the cost of the chain itself.
+    report(name, type_name<T>(), input_name(kind), "latency", measure([=]() {
+      T zero = opaque(T(0));
+      T acc = 0;
+      for(size_t i = 0; i < n; ++i) {
+        acc = T(f(T(x[i] | (acc & zero)), y[i]));
+      }
+      do_not_optimize(acc);
+    }, n, 3, 5));
+  }
+}
+
+template <typename T>
+void bench_scalar(const bench_filter& filter) {
+  typedef typename std::make_unsigned<T>::type U;
+  constexpr int nbits = int(sizeof(T) * CHAR_BIT);
+  //A bit index or shift amount taken from y
+  auto s = [](T y) { return int(U(y) % nbits); };
+
+  bench_op<T>(filter, "identity", [](T x, T) { return x; });
+
+  bench_op<T>(filter, "shll", [=](T x, T y) { return shll(x, s(y)); });
+  bench_op<T>(filter, "shlr", [=](T x, T y) { return shlr(x, s(y)); });
+  bench_op<T>(filter, "shal", [=](T x, T y) { return shal(x, s(y)); });
+  bench_op<T>(filter, "shar", [=](T x, T y) { return shar(x, s(y)); });
+  bench_op<T>(filter, "rotl", [=](T x, T y) { return rotl(x, s(y)); });
+  bench_op<T>(filter, "rotr", [=](T x, T y) { return rotr(x, s(y)); });
+
+  bench_op<T>(filter, "cntt0", [](T x, T) { return cntt0(x); });
+  bench_op<T>(filter, "cntl0", [](T x, T) { return cntl0(x); });
+  bench_op<T>(filter, "cntt1", [](T x, T) { return cntt1(x); });
+  bench_op<T>(filter, "cntl1", [](T x, T) { return cntl1(x); });
+  bench_op<T>(filter, "popcount", [](T x, T) { return popcount(x); });
+  bench_op<T>(filter, "parity", [](T x, T) { return parity(x); });
+
+  bench_op<T>(filter, "rstls1b", [](T x, T) { return rstls1b(x); });
+  bench_op<T>(filter, "setls0b", [](T x, T) { return setls0b(x); });
+  bench_op<T>(filter, "isols1b", [](T x, T) { return isols1b(x); });
+  bench_op<T>(filter, "isols0b", [](T x, T) { return isols0b(x); });
+  bench_op<T>(filter, "rstt1", [](T x, T) { return rstt1(x); });
+  bench_op<T>(filter, "sett0", [](T x, T) { return sett0(x); });
+  bench_op<T>(filter, "maskt0", [](T x, T) { return maskt0(x); });
+  bench_op<T>(filter, "maskt1", [](T x, T) { return maskt1(x); });
+  bench_op<T>(filter, "maskt0ls1b", [](T x, T) { return maskt0ls1b(x); });
+  bench_op<T>(filter, "maskt1ls0b", [](T x, T) { return maskt1ls0b(x); });
+
+  bench_op<T>(filter, "reverse_bits", [](T x, T) { return reverse_bits(x); });
+  bench_op<T>(filter, "reverse_bits_in_bytes", [](T x, T) { return reverse_bits(x, 1, 8); });
+  bench_op<T>(filter, "reverse_nibbles", [](T x, T) { return reverse_bits(x, 4); });
+  bench_op<T>(filter, "reverse_bytes", [](T x, T) { return reverse_bytes(x); });
+  bench_op<T>(filter, "reverse_bits_fixed", [](T x, T) { return reverse_bits<1>(x); });
+  bench_op<T>(filter, "reverse_bits_in_bytes_fixed", [](T x, T) { return reverse_bits<1, 8>(x); });
+  bench_op<T>(filter, "reverse_nibbles_fixed", [](T x, T) { return reverse_bits<4>(x); });
+  bench_op<T>(filter, "reverse_bytes_fixed", [](T x, T) { return reverse_bytes<1>(x); });
+
+  bench_op<T>(filter, "setbit", [=](T x, T y) { return setbit(x, s(y)); });
+  bench_op<T>(filter, "rstbit", [=](T x, T y) { return rstbit(x, s(y)); });
+  bench_op<T>(filter, "flipbit", [=](T x, T y) { return flipbit(x, s(y)); });
+  bench_op<T>(filter, "testbit", [=](T x, T y) { return testbit(x, s(y)); });
+  bench_op<T>(filter, "rstbitsge", [=](T x, T y) { return rstbitsge(x, s(y)); });
+  bench_op<T>(filter, "rstbitsle", [=](T x, T y) { return rstbitsle(x, s(y)); });
+  bench_op<T>(filter, "setbitsge", [=](T x, T y) { return setbitsge(x, s(y)); });
+  bench_op<T>(filter, "setbitsle", [=](T x, T y) { return setbitsle(x, s(y)); });
+  bench_op<T>(filter, "flipbitsge", [=](T x, T y) { return flipbitsge(x, s(y)); });
+  bench_op<T>(filter, "flipbitsle", [=](T x, T y) { return flipbitsle(x, s(y)); });
+
+  bench_op<T>(filter, "satadd", [](T x, T y) { return satadd(x, y); });
+  bench_op<T>(filter, "satsub", [](T x, T y) { return satsub(x, y); });
+
+  bench_op<T>(filter, "ispow2", [](T x, T) { return ispow2(x); });
+  //Keep the result representable
+  bench_op<T>(filter, "ceilp2", [](T x, T) { return ceilp2(shlr(x, 2)); });
+  bench_op<T>(filter, "floorp2", [](T x, T) { return floorp2(x); });
+  bench_op<T>(filter, "align_up", [=](T x, T y) { return align_up(x, size_t(1) << (s(y) % 8)); });
+  bench_op<T>(filter, "align_down", [=](T x, T y) { return align_down(x, size_t(1) << (s(y) % 8)); });
+  bench_op<T>(filter, "is_aligned", [=](T x, T y) { return is_aligned(x, size_t(1) << (s(y) % 8)); });
+
+  bench_op<T>(filter, "outer_pshuffle", [](T x, T) { return outer_pshuffle(x); });
+  bench_op<T>(filter, "outer_punshuffle", [](T x, T) { return outer_punshuffle(x); });
+  bench_op<T>(filter, "inner_pshuffle", [](T x, T) { return inner_pshuffle(x); });
+  bench_op<T>(filter, "inner_punshuffle", [](T x, T) { return inner_punshuffle(x); });
+
+  //The mask comes from y, so its density follows the input distribution
+  bench_op<T>(filter, "deposit_bits", [](T x, T y) { return deposit_bits(x, y); });
+  bench_op<T>(filter, "extract_bits", [](T x, T y) { return extract_bits(x, y); });
+  bench_op<T>(filter, "deposit_bits_runtime", [](T x, T y) { return deposit_bits_runtime(x, y); });
+  bench_op<T>(filter, "extract_bits_runtime", [](T x, T y) { return extract_bits_runtime(x, y); });
+}
+
+//Times f(xs, ys, out) over arrays of n elements
+template <typename T, typename F>
+void bench_array_op(const bench_filter& filter, const char* name, F f) {
+  if(!filter(name)) {
+    return;
+  }
+  for(input_kind kind : {input_random, input_sparse, input_dense}) {
+    std::vector<T> xs = make_inputs<T>(n, kind, 1);
+    std::vector<T> ys = make_inputs<T>(n, kind, 2);
+    std::vector<T> out(n);
+    report(name, type_name<T>(), input_name(kind), "throughput", measure([&]() {
+      f(xs.data(), ys.data(), out.data());
+      clobber(out.data());
+    }, n));
+  }
+}
+
+template <typename T>
+void bench_array(const bench_filter& filter) {
+  std::vector<uint32_t> positions(n * sizeof(T) * CHAR_BIT + 16);
+
+  bench_array_op<T>(filter, "popcount_array", [](const T* x, const T*, T* out) { out[0] = T(popcount(x, n)); });
+  bench_array_op<T>(filter, "reverse_bits_array", [](const T* x, const T*, T* out) { reverse_bits(x, out, n); });
+  bench_array_op<T>(filter, "reverse_bytes_array", [](const T* x, const T*, T* out) { reverse_bytes(x, out, n); });
+  bench_array_op<T>(filter, "satadd_array", [](const T* x, const T* y, T* out) { satadd(x, y, out, n); });
+  bench_array_op<T>(filter, "satsub_array", [](const T* x, const T* y, T* out) { satsub(x, y, out, n); });
+  bench_array_op<T>(filter, "decode_bit_positions", [&](const T* x, const T*, T* out) {
+    out[0] = T(decode_bit_positions(x, n, positions.data()));
+  });
+  bench_array_op<T>(filter, "bit_positions_array", [](const T* x, const T*, T* out) {
+    size_t sum = 0;
+    for(size_t i : bit_positions(x, n)) sum += i;
+    out[0] = T(sum);
+  });
+}
+
+//Random words for the 128 bit and multiword integers, with the same distributions as make_inputs
+template <size_t N>
+void fill_words(std::array<uint64_t, N>& x, const uint64_t* w) {
+  std::copy(w, w + N, x.begin());
+}
+
+//Mixes v into the low word of x
+template <size_t N>
+std::array<uint64_t, N> mix(std::array<uint64_t, N> x, int v) {
+  x[0] |= uint64_t(v);
+  return x;
+}
+
+#if defined(__SIZEOF_INT128__)
+void fill_words(unsigned __int128& x, const uint64_t* w) {
+  x = (unsigned __int128)w[1] << 64 | w[0];
+}
+
+unsigned __int128 mix(unsigned __int128 x, int v) {
+  return x | uint64_t(v);
+}
+#endif
+
+//Times f(x, s) where s is a shift amount, like bench_op but for the wide types.
+//The latency chain goes through the popcount of the result, like in bench_op.
+template <typename T, typename F>
+void bench_wide_op(const bench_filter& filter, const char* name, const char* type, F f) {
+  if(!filter(name)) {
+    return;
+  }
+  constexpr size_t nwords = sizeof(T) / sizeof(uint64_t);
+  for(input_kind kind : {input_random, input_sparse, input_dense}) {
+    std::vector<uint64_t> words = make_inputs<uint64_t>(n * nwords, kind, 1);
+    std::vector<int> shifts(n);
+    std::vector<T> xs(n);
+    std::vector<decltype(f(xs[0], 0))> out(n);
+    for(size_t i = 0; i < n; ++i) {
+      fill_words(xs[i], &words[i * nwords]);
+      shifts[i] = int(words[i * nwords] % (nwords * 64));
+    }
+    const T* x = xs.data();
+    const int* s = shifts.data();
+    auto* o = out.data();
+
+    report(name, type, input_name(kind), "throughput", measure([=]() {
+      for(size_t i = 0; i < n; ++i) {
+        o[i] = f(x[i], s[i]);
+      }
+      clobber(o);
+    }, n, 3, 5));
+
+    report(name, type, input_name(kind), "latency", measure([=]() {
+      int zero = opaque(0);
+      int acc = 0;
+      for(size_t i = 0; i < n; ++i) {
+        acc = int(popcount(f(mix(x[i], acc & zero), s[i])));
+      }
+      do_not_optimize(acc);
+    }, n, 3, 5));
+  }
+}
+
+template <typename T>
+void bench_wide(const bench_filter& filter, const char* type) {
+  bench_wide_op<T>(filter, "cntt0", type, [](const T& x, int) { return cntt0(x); });
+  bench_wide_op<T>(filter, "cntl0", type, [](const T& x, int) { return cntl0(x); });
+  bench_wide_op<T>(filter, "popcount", type, [](const T& x, int) { return popcount(x); });
+  bench_wide_op<T>(filter, "shll", type, [](const T& x, int s) { return shll(x, s); });
+  bench_wide_op<T>(filter, "shlr", type, [](const T& x, int s) { return shlr(x, s); });
+  bench_wide_op<T>(filter, "rotl", type, [](const T& x, int s) { return rotl(x, s); });
+  bench_wide_op<T>(filter, "rotr", type, [](const T& x, int s) { return rotr(x, s); });
+  bench_wide_op<T>(filter, "reverse_bits", type, [](const T& x, int) { return reverse_bits(x); });
+  bench_wide_op<T>(filter, "ceilp2", type, [](const T& x, int) { return ceilp2(x); });
+}
+
+int main(int argc, char** argv) {
+  bench_filter filter;
+  if(argc > 1) {
+    filter.substr = argv[1];
+  }
+  report_header();
+  for_each_int_type([&](auto t) { bench_scalar<decltype(t)>(filter); });
+  for_each_int_type([&](auto t) { bench_array<decltype(t)>(filter); });
+#if defined(__SIZEOF_INT128__)
+  bench_wide<unsigned __int128>(filter, "uint128");
+#endif
+  bench_wide<std::array<uint64_t, 2>>(filter, "uint64x2");
+  bench_wide<std::array<uint64_t, 4>>(filter, "uint64x4");
+  bench_wide<std::array<uint64_t, 8>>(filter, "uint64x8");
+  return 0;
+}
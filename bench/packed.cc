@@ -0,0 +1,53 @@
+#include <packed_array.hh>
+#include "bench.hh"
+
+#include <string>
+
+using namespace std;
+
+//Unpacks one value at a time with shlr and an rstbitsge mask
+template <typename T>
+static void naive_unpack(const uint64_t* in, size_t n, int width, T* out) {
+  for(size_t i = 0; i < n; ++i) {
+    size_t bit = i * size_t(width);
+    int s = int(bit % 64);
+    uint64_t x = shlr(in[bit / 64], s);
+    if(s + width > 64) {
+      x |= shll(in[bit / 64 + 1], 64 - s);
+    }
+    out[i] = T(width == 64 ? x : rstbitsge(x, width));
+  }
+}
+
+template <typename T>
+static void bench_width(int width) {
+  const size_t n = 1 << 16;
+  std::vector<T> src = random_inputs<T>(n);
+  std::vector<T> dst(n);
+  std::vector<uint64_t> words(packed_words(n, width) + 1);
+  std::string input = "width_" + std::to_string(width);
+
+  report("pack_bits", type_name<T>(), input.c_str(), "runtime_width", measure([&]() {
+    pack_bits(src.data(), n, opaque(width), words.data());
+    clobber(words.data());
+  }, n));
+  report("unpack_bits", type_name<T>(), input.c_str(), "naive", measure([&]() {
+    naive_unpack(words.data(), n, opaque(width), dst.data());
+    clobber(dst.data());
+  }, n));
+  report("unpack_bits", type_name<T>(), input.c_str(), "runtime_width", measure([&]() {
+    unpack_bits(words.data(), n, opaque(width), dst.data());
+    clobber(dst.data());
+  }, n));
+}
+
+int main() {
+  report_header();
+  for(int width : {1, 3, 7, 12, 17, 25, 32}) {
+    bench_width<uint32_t>(width);
+  }
+  for(int width : {33, 48, 64}) {
+    bench_width<uint64_t>(width);
+  }
+  return 0;
+}
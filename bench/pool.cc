@@ -0,0 +1,65 @@
+#include <pool_allocator.hh>
+#include "bench.hh"
+
+#include <cstdlib>
+
+using namespace std;
+
+//Sizes whose size class is uniformly distributed over [min_class, max_class]
+static std::vector<size_t> size_mix(size_t n, int min_class, int max_class) {
+  std::vector<size_t> sizes(n);
+  std::vector<uint64_t> r = random_inputs<uint64_t>(n, 1);
+  for(size_t i = 0; i < n; ++i) {
+    int c = min_class + int(r[i] % uint64_t(max_class - min_class + 1));
+    size_t size = size_class_pool::class_size(c);
+    sizes[i] = size - size_t(r[i] >> 32) % (size / 2);
+  }
+  return sizes;
+}
+
+//Frees and replaces one block of a window of live blocks per item.
+//Each new block is written to, as a real user would.
+template <typename Alloc, typename Free>
+void bench_alloc(const char* type, const std::vector<size_t>& sizes, const char* mode, Alloc alloc, Free dealloc) {
+  const size_t window = 1000;
+  std::vector<void*> live(window);
+  for(size_t i = 0; i < window; ++i) {
+    live[i] = alloc(sizes[i]);
+  }
+  size_t next = window;
+  report("alloc_free", type, "window1000", mode, measure([&]() {
+    for(size_t i = 0; i < window; ++i) {
+      dealloc(live[i], sizes[(next - window) % sizes.size()]);
+      size_t size = sizes[next % sizes.size()];
+      live[i] = alloc(size);
+      static_cast<char*>(live[i])[0] = char(i);
+      ++next;
+    }
+    clobber(live.data());
+  }, window));
+  for(size_t i = 0; i < window; ++i) {
+    dealloc(live[i], sizes[(next - window + i) % sizes.size()]);
+  }
+}
+
+static void bench_mix(const char* type, int min_class, int max_class) {
+  //Not a multiple of the window, so that the sizes of a slot change between passes
+  std::vector<size_t> sizes = size_mix(100003, min_class, max_class);
+  bench_alloc(type, sizes, "malloc",
+      [](size_t n) { return std::malloc(n); },
+      [](void* p, size_t) { std::free(p); });
+  bench_alloc(type, sizes, "malloc_ceilp2",
+      [](size_t n) { return std::malloc(ceilp2(n)); },
+      [](void* p, size_t) { std::free(p); });
+  bench_alloc(type, sizes, "size_class_pool",
+      [](size_t n) { return size_class_pool::allocate(n); },
+      [](void* p, size_t n) { size_class_pool::deallocate(p, n); });
+}
+
+int main() {
+  report_header();
+  bench_mix("16B-64KiB", 0, size_class_pool::num_classes - 1);
+  bench_mix("16B-256B", 0, 4);
+  bench_mix("4KiB-64KiB", 8, size_class_pool::num_classes - 1);
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include <roaring_bitmap.hh>
+#include "bench.hh"
+
+using namespace std;
+
+//2^24 values wide: sparse values in array containers, dense values in bitmap containers, or long runs
+static roaring_bitmap make(const char* input, uint64_t s) {
+  roaring_bitmap b;
+  const uint32_t range = 1 << 24;
+  if(input[0] == 'r') {
+    for(uint32_t x = 0; x < range;) {
+      s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+      uint32_t len = uint32_t(s % 1000);
+      for(uint32_t i = 0; i < len; ++i) {
+        b.set(x + i);
+      }
+      x += len + uint32_t(s >> 40) % 1000;
+    }
+    b.run_optimize();
+    return b;
+  }
+  size_t n = input[0] == 's' ? range / 256 : range / 4;
+  for(size_t i = 0; i < n; ++i) {
+    s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+    b.set(uint32_t(s % range));
+  }
+  return b;
+}
+
+static void bench_input(const char* input) {
+  roaring_bitmap a = make(input, 0x9E3779B97F4A7C15ULL);
+  roaring_bitmap b = make(input, 0x2545F4914F6CDD1DULL);
+  std::vector<unsigned char> buf(a.serialized_size());
+  a.serialize(buf.data());
+  roaring_view v(buf.data(), buf.size());
+  size_t items = a.count() + b.count();
+
+  report("roaring", "uint32_t", input, "and", measure([&]() {
+    do_not_optimize((a & b).count());
+  }, items));
+  report("roaring", "uint32_t", input, "or", measure([&]() {
+    do_not_optimize((a | b).count());
+  }, items));
+
+  std::vector<uint32_t> q = random_inputs<uint32_t>(1 << 16);
+  for(auto& x : q) {
+    x &= (1 << 24) - 1;
+  }
+  report("roaring", "uint32_t", input, "test", measure([&]() {
+    size_t n = 0;
+    for(uint32_t x : q) n += a.test(x);
+    do_not_optimize(n);
+  }, q.size()));
+  report("roaring", "uint32_t", input, "view_test", measure([&]() {
+    size_t n = 0;
+    for(uint32_t x : q) n += v.test(x);
+    do_not_optimize(n);
+  }, q.size()));
+  report("roaring", "uint32_t", input, "for_each", measure([&]() {
+    uint32_t n = 0;
+    a.for_each([&](uint32_t x) { n += x; });
+    do_not_optimize(n);
+  }, a.count()));
+}
+
+int main() {
+  report_header();
+  for(const char* input : {"sparse", "dense", "runs"}) {
+    bench_input(input);
+  }
+  return 0;
+}
@@ -0,0 +1,65 @@
+#include <summary_bitmap.hh>
+#include "bench.hh"
+
+using namespace std;
+
+//First set bit >= i by scanning the words with cntt0
+static size_t flat_find_next(const std::vector<uint64_t>& words, size_t i) {
+  size_t w = i / 64;
+  uint64_t x = shlr(words[w], int(i % 64));
+  if(x != 0) {
+    return i + size_t(cntt0(x));
+  }
+  while(++w < words.size()) {
+    if(words[w] != 0) {
+      return w * 64 + size_t(cntt0(words[w]));
+    }
+  }
+  return size_t(summary_bitmap::npos);
+}
+
+//Random find_next queries over 10^7 bits with one bit set per spacing bits on average
+static void bench_find_next(const char* input, size_t spacing) {
+  const size_t nbits = 10000000;
+  const size_t n = 1000;
+  summary_bitmap b(nbits);
+  std::vector<uint64_t> words((nbits + 63) / 64);
+  std::vector<uint64_t> r = random_inputs<uint64_t>(nbits / spacing, 1);
+  for(uint64_t x : r) {
+    size_t i = size_t(x % nbits);
+    b.set(i);
+    words[i / 64] = setbit(words[i / 64], int(i % 64));
+  }
+  std::vector<uint64_t> q = random_inputs<uint64_t>(n, 2);
+  for(auto& x : q) {
+    x %= nbits;
+  }
+
+  report("find_next", "10^7 bits", input, "flat", measure([&]() {
+    size_t acc = 0;
+    for(size_t i = 0; i < n; ++i) acc += flat_find_next(words, size_t(q[i]));
+    do_not_optimize(acc);
+  }, n));
+  report("find_next", "10^7 bits", input, "summary_bitmap", measure([&]() {
+    size_t acc = 0;
+    for(size_t i = 0; i < n; ++i) acc += b.find_next(size_t(q[i]));
+    do_not_optimize(acc);
+  }, n));
+  report("find_prev", "10^7 bits", input, "summary_bitmap", measure([&]() {
+    size_t acc = 0;
+    for(size_t i = 0; i < n; ++i) acc += b.find_prev(size_t(q[i]));
+    do_not_optimize(acc);
+  }, n));
+  report("set_reset", "10^7 bits", input, "summary_bitmap", measure([&]() {
+    for(size_t i = 0; i < n; ++i) b.set(size_t(q[i]));
+    for(size_t i = 0; i < n; ++i) b.reset(size_t(q[i]));
+  }, 2 * n));
+}
+
+int main() {
+  report_header();
+  bench_find_next("1_per_64", 64);
+  bench_find_next("1_per_10^4", 10000);
+  bench_find_next("1_per_10^6", 1000000);
+  return 0;
+}
@@ -0,0 +1,59 @@
+#include <bitops.hh>
+#include "bench.hh"
+
+using namespace std;
+
+//Bit at a time transposition
+template <typename T>
+static void naive(const T* src, T* dst, size_t nblocks) {
+  constexpr size_t n = sizeof(T) * CHAR_BIT;
+  for(size_t b = 0; b < nblocks; ++b, src += n, dst += n) {
+    for(size_t j = 0; j < n; ++j) {
+      T x = 0;
+      for(size_t i = 0; i < n; ++i) {
+        x |= shll(T(shlr(src[i], int(j)) & 1u), int(i));
+      }
+      dst[j] = x;
+    }
+  }
+}
+
+static void transpose(const uint32_t* src, uint32_t* dst, size_t n) { transpose32(src, dst, n); }
+static void transpose(const uint64_t* src, uint64_t* dst, size_t n) { transpose64(src, dst, n); }
+
+//ns per block of 1024 blocks
+template <typename T>
+static void bench_type() {
+  constexpr size_t n = sizeof(T) * CHAR_BIT;
+  const size_t nblocks = 1024;
+  std::vector<T> src = random_inputs<T>(n * nblocks);
+  std::vector<T> dst(src.size());
+
+  report("transpose", type_name<T>(), "random", "naive", measure([&]() {
+    naive(src.data(), dst.data(), nblocks);
+    clobber(dst.data());
+  }, nblocks));
+  report("transpose", type_name<T>(), "random", "delta_swap", measure([&]() {
+    for(size_t b = 0; b < nblocks; ++b) {
+      bitops_detail::transpose_block(src.data() + n * b, dst.data() + n * b);
+    }
+    clobber(dst.data());
+  }, nblocks));
+  report("transpose", type_name<T>(), "random", "batch", measure([&]() {
+    transpose(src.data(), dst.data(), nblocks);
+    clobber(dst.data());
+  }, nblocks));
+}
+
+int main() {
+  report_header();
+  std::vector<uint64_t> in = random_inputs<uint64_t>(1 << 12);
+  report("transpose8", "uint64_t", "random", "throughput", measure([&]() {
+    uint64_t x = 0;
+    for(uint64_t v : in) x ^= transpose8(v);
+    do_not_optimize(x);
+  }, in.size()));
+  bench_type<uint32_t>();
+  bench_type<uint64_t>();
+  return 0;
+}
@@ -0,0 +1,66 @@
+#include <varint.hh>
+#include "bench.hh"
+
+using namespace std;
+
+//Decodes one byte at a time
+template <typename T>
+static size_t naive_decode(const unsigned char* p, T* out, size_t n) {
+  const unsigned char* start = p;
+  for(size_t i = 0; i < n; ++i) {
+    T x = 0;
+    int s = 0;
+    while(*p & 0x80) {
+      x |= T(T(*p++ & 0x7F) << s);
+      s += 7;
+    }
+    out[i] = x | T(T(*p++) << s);
+  }
+  return size_t(p - start);
+}
+
+//Values of up to maxbits significant bits
+template <typename T>
+static void bench_decode(const char* input, int maxbits) {
+  const size_t n = 1 << 16;
+  std::vector<T> src = random_inputs<T>(n);
+  std::vector<uint64_t> r = random_inputs<uint64_t>(n, 1);
+  for(size_t i = 0; i < n; ++i) {
+    src[i] = shlr(src[i], int(sizeof(T) * CHAR_BIT) - 1 - int(r[i] % uint64_t(maxbits)));
+  }
+  std::vector<unsigned char> buf(n * varint_max_size<T>());
+  varint_writer w(buf.data(), buf.size());
+  std::vector<T> dst(n);
+
+  report("varint_encode", type_name<T>(), input, "writer", measure([&]() {
+    w = varint_writer(buf.data(), buf.size());
+    w.write(src.data(), n);
+    clobber(buf.data());
+  }, n));
+  size_t nbytes = size_t(w.data() - buf.data());
+  report("varint_decode", type_name<T>(), input, "naive", measure([&]() {
+    do_not_optimize(naive_decode(buf.data(), dst.data(), n));
+    clobber(dst.data());
+  }, n));
+  report("varint_decode", type_name<T>(), input, "single", measure([&]() {
+    varint_reader rd(buf.data(), nbytes);
+    for(size_t i = 0; i < n; ++i) rd.read(dst[i]);
+    clobber(dst.data());
+  }, n));
+  report("varint_decode", type_name<T>(), input, "batch", measure([&]() {
+    varint_reader rd(buf.data(), nbytes);
+    do_not_optimize(rd.read(dst.data(), n));
+    clobber(dst.data());
+  }, n));
+}
+
+int main() {
+  report_header();
+  bench_decode<uint32_t>("7_bits", 7);
+  bench_decode<uint32_t>("14_bits", 14);
+  bench_decode<uint32_t>("28_bits", 28);
+  bench_decode<uint32_t>("32_bits", 32);
+  bench_decode<uint64_t>("28_bits", 28);
+  bench_decode<uint64_t>("64_bits", 64);
+  return 0;
+}
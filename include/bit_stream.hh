@@ -0,0 +1,188 @@
+#ifndef BIT_STREAM_HH
+#define BIT_STREAM_HH
+
+#include "bitops.hh"
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace std {
+
+////////////////////////////////////
+//Bit streams
+////////////////////////////////////
+
+//Order of the bits of a stream within each byte.
+//lsb_first streams fill bytes from bit 0 and fields are read least significant bit first, as in deflate.
+//msb_first streams fill bytes from bit 7 and fields are read most significant bit first, as in JPEG.
+enum class bit_order { lsb_first, msb_first };
+
+namespace bitops_detail {
+
+//Loads and stores the 8 bytes at p as a word whose first bit is bit 0 or bit 63
+template <bit_order Order>
+  inline uint64_t load_bits(const void* p) noexcept {
+    return Order == bit_order::lsb_first ? load_le<uint64_t>(p) : load_be<uint64_t>(p);
+  }
+
+template <bit_order Order>
+  inline void store_bits(void* p, uint64_t w) noexcept {
+    if(Order == bit_order::lsb_first) {
+      store_le(p, w);
+    } else {
+      store_be(p, w);
+    }
+  }
+
+} //namespace bitops_detail
+
+//Reads fields of up to 56 bits from a buffer of any alignment.
+//A 64 bit buffer holds the next bits, bit 0 or bit 63 first. refill() tops it up with one unaligned
+//word load: the whole word is merged at the current bit count and the pointer advances by the
+//number of whole bytes that fit, so there are no loops or branches on the number of bits.
+//Reading past the end returns zero bits, overrun() tells if that happened.
+template <bit_order Order>
+class bit_reader {
+  public:
+    //Maximum number of bits of a field
+    static constexpr int max_bits = 56;
+
+    bit_reader() noexcept = default;
+    bit_reader(const void* p, size_t n) noexcept
+      : _begin(static_cast<const unsigned char*>(p)), _p(_begin), _end(_begin + n) {}
+
+    //Fills the buffer to at least max_bits bits
+    void refill() noexcept {
+      int bytes = (63 - _nbits) >> 3;
+      uint64_t w;
+      if(_end - _p >= 8) {
+        w = bitops_detail::load_bits<Order>(_p);
+        _p += bytes;
+      } else {
+        refill_tail(w, bytes);
+      }
+      _buf |= Order == bit_order::lsb_first ? shll(w, _nbits) : shlr(w, _nbits);
+      _nbits += 8 * bytes;
+    }
+
+    //Number of buffered bits
+    int available() const noexcept { return _nbits; }
+
+    //Returns the next n bits, undefined if n > available()
+    uint64_t peek(int n) const noexcept {
+      return Order == bit_order::lsb_first ? rstbitsge(_buf, n) : shlr(shlr(_buf, 1), 63 - n);
+    }
+
+    //Skips the next n bits, undefined if n > available()
+    void consume(int n) noexcept {
+      _buf = Order == bit_order::lsb_first ? shlr(_buf, n) : shll(_buf, n);
+      _nbits -= n;
+    }
+
+    //Returns the next n bits and skips them, refilling first if needed. Undefined if n > max_bits
+    uint64_t read(int n) noexcept {
+      if(_nbits < n) {
+        refill();
+      }
+      uint64_t x = peek(n);
+      consume(n);
+      return x;
+    }
+
+    //Number of bits read
+    size_t tell() const noexcept { return size_t(_p - _begin + _pad) * 8 - size_t(_nbits); }
+
+    //Returns true if more bits were read than the buffer holds
+    bool overrun() const noexcept { return tell() > size_t(_end - _begin) * 8; }
+
+  private:
+    //Loads the last bytes zero padded, the bytes past the end count towards _pad
+    void refill_tail(uint64_t& w, int bytes) noexcept {
+      unsigned char b[8] = {};
+      size_t left = size_t(_end - _p);
+      std::memcpy(b, _p, left);
+      w = bitops_detail::load_bits<Order>(b);
+      size_t n = std::min(size_t(bytes), left);
+      _p += n;
+      _pad += size_t(bytes) - n;
+    }
+
+    const unsigned char* _begin = nullptr;
+    const unsigned char* _p = nullptr;
+    const unsigned char* _end = nullptr;
+    size_t _pad = 0;
+    uint64_t _buf = 0;
+    int _nbits = 0;
+};
+
+//Writes fields of up to 56 bits to a buffer of any alignment.
+//Fields are merged into a 64 bit buffer and each write stores the whole buffer with one unaligned
+//word store, then advances by the number of whole bytes in it. At most 7 bits stay buffered.
+//Writes past the end of the buffer are dropped, overflow() tells if that happened.
+template <bit_order Order>
+class bit_writer {
+  public:
+    //Maximum number of bits of a field
+    static constexpr int max_bits = 56;
+
+    bit_writer() noexcept = default;
+    bit_writer(void* p, size_t n) noexcept
+      : _begin(static_cast<unsigned char*>(p)), _p(_begin), _end(_begin + n) {}
+
+    //Appends the low n bits of x, undefined if n > max_bits
+    void write(uint64_t x, int n) noexcept {
+      x = rstbitsge(x, n);
+      _buf |= Order == bit_order::lsb_first ? shll(x, _nbits) : shll(shll(x, 1), 63 - _nbits - n);
+      _nbits += n;
+      int bytes = _nbits >> 3;
+      if(_end - _p >= 8) {
+        bitops_detail::store_bits<Order>(_p, _buf);
+        _p += bytes;
+      } else {
+        store_tail(bytes);
+      }
+      _buf = Order == bit_order::lsb_first ? shlr(_buf, 8 * bytes) : shll(_buf, 8 * bytes);
+      _nbits &= 7;
+    }
+
+    //Writes out the buffered bits, zero padding the last byte, and returns the number of bytes written
+    size_t flush() noexcept {
+      if(_nbits != 0) {
+        write(0, 8 - _nbits);
+      }
+      return size();
+    }
+
+    //Number of whole bytes written
+    size_t size() const noexcept { return size_t(_p - _begin); }
+
+    //Number of bits written
+    size_t tell() const noexcept { return size() * 8 + size_t(_nbits); }
+
+    //Returns true if bits were dropped at the end of the buffer
+    bool overflow() const noexcept { return _overflow; }
+
+  private:
+    //Stores the whole bytes which fit before the end
+    void store_tail(int bytes) noexcept {
+      unsigned char b[8];
+      bitops_detail::store_bits<Order>(b, _buf);
+      size_t left = size_t(_end - _p);
+      size_t n = std::min(size_t(bytes), left);
+      std::memcpy(_p, b, n);
+      _p += n;
+      _overflow |= n < size_t(bytes);
+    }
+
+    unsigned char* _begin = nullptr;
+    unsigned char* _p = nullptr;
+    unsigned char* _end = nullptr;
+    uint64_t _buf = 0;
+    int _nbits = 0;
+    bool _overflow = false;
+};
+
+} //namespace std
+
+#endif
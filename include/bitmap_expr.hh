@@ -0,0 +1,312 @@
+#ifndef BITMAP_EXPR_HH
+#define BITMAP_EXPR_HH
+
+#include "bitops.hh"
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace std {
+
+////////////////////////////////////
+//Bitmap expressions
+////////////////////////////////////
+
+//Operators of a bitmap expression, bit_andnot is l & ~r
+enum class bitmap_op { bit_and, bit_or, bit_xor, bit_andnot };
+
+namespace bitops_detail {
+
+//Operations of the expression kernels. Each kernel computes Outer(Inner(a, b), c),
+//bitmap_first_op returns its left operand so that Inner = bitmap_first_op applies Outer alone.
+struct bitmap_first_op {
+  static constexpr uint64_t apply(uint64_t a, uint64_t) noexcept { return a; }
+#if defined(BITOPS_RUNTIME_DISPATCH)
+  BITOPS_TARGET("avx2") static __m256i apply(__m256i a, __m256i) noexcept { return a; }
+#endif
+};
+
+struct bitmap_and_op {
+  static constexpr uint64_t apply(uint64_t a, uint64_t b) noexcept { return a & b; }
+#if defined(BITOPS_RUNTIME_DISPATCH)
+  BITOPS_TARGET("avx2") static __m256i apply(__m256i a, __m256i b) noexcept { return _mm256_and_si256(a, b); }
+#endif
+};
+
+struct bitmap_or_op {
+  static constexpr uint64_t apply(uint64_t a, uint64_t b) noexcept { return a | b; }
+#if defined(BITOPS_RUNTIME_DISPATCH)
+  BITOPS_TARGET("avx2") static __m256i apply(__m256i a, __m256i b) noexcept { return _mm256_or_si256(a, b); }
+#endif
+};
+
+struct bitmap_xor_op {
+  static constexpr uint64_t apply(uint64_t a, uint64_t b) noexcept { return a ^ b; }
+#if defined(BITOPS_RUNTIME_DISPATCH)
+  BITOPS_TARGET("avx2") static __m256i apply(__m256i a, __m256i b) noexcept { return _mm256_xor_si256(a, b); }
+#endif
+};
+
+struct bitmap_andnot_op {
+  static constexpr uint64_t apply(uint64_t a, uint64_t b) noexcept { return a & ~b; }
+#if defined(BITOPS_RUNTIME_DISPATCH)
+  BITOPS_TARGET("avx2") static __m256i apply(__m256i a, __m256i b) noexcept { return _mm256_andnot_si256(b, a); }
+#endif
+};
+
+//bitmap_andnot_op with the operands swapped, ~a & b
+struct bitmap_notand_op {
+  static constexpr uint64_t apply(uint64_t a, uint64_t b) noexcept { return ~a & b; }
+#if defined(BITOPS_RUNTIME_DISPATCH)
+  BITOPS_TARGET("avx2") static __m256i apply(__m256i a, __m256i b) noexcept { return _mm256_andnot_si256(a, b); }
+#endif
+};
+
+//dst[i] = Outer(Inner(a[i], b[i]), c[i]) for n words, dst may be any of a, b and c
+typedef void (*bitmap_kernel)(const uint64_t* a, const uint64_t* b, const uint64_t* c, uint64_t* dst, size_t n);
+
+template <typename Outer, typename Inner>
+  inline void bitmap_kernel_scalar(const uint64_t* a, const uint64_t* b, const uint64_t* c, uint64_t* dst, size_t n) {
+    for(size_t i = 0; i < n; ++i) {
+      dst[i] = Outer::apply(Inner::apply(a[i], b[i]), c[i]);
+    }
+  }
+
+#if defined(BITOPS_RUNTIME_DISPATCH)
+template <typename Outer, typename Inner>
+  BITOPS_TARGET("avx2") inline void bitmap_kernel_avx2(const uint64_t* a, const uint64_t* b, const uint64_t* c, uint64_t* dst, size_t n) {
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4) {
+      __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+      __m256i vc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), Outer::apply(Inner::apply(va, vb), vc));
+    }
+    bitmap_kernel_scalar<Outer, Inner>(a + i, b + i, c + i, dst + i, n - i);
+  }
+
+//One VPTERNLOGQ per vector, its truth table is the kernel applied to the bit patterns of the 3 inputs
+template <typename Outer, typename Inner>
+  BITOPS_TARGET("avx512f") inline void bitmap_kernel_avx512(const uint64_t* a, const uint64_t* b, const uint64_t* c, uint64_t* dst, size_t n) {
+    constexpr int imm = int(Outer::apply(Inner::apply(0xF0, 0xCC), 0xAA) & 0xFF);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+      __m512i va = _mm512_loadu_si512(a + i);
+      __m512i vb = _mm512_loadu_si512(b + i);
+      __m512i vc = _mm512_loadu_si512(c + i);
+      _mm512_storeu_si512(dst + i, _mm512_ternarylogic_epi64(va, vb, vc, imm));
+    }
+    bitmap_kernel_scalar<Outer, Inner>(a + i, b + i, c + i, dst + i, n - i);
+  }
+#endif
+
+template <typename Outer, typename Inner>
+  inline bitmap_kernel select_bitmap_kernel() noexcept {
+#if defined(BITOPS_RUNTIME_DISPATCH)
+    if(has_avx512f()) {
+      return bitmap_kernel_avx512<Outer, Inner>;
+    }
+    if(has_avx2()) {
+      return bitmap_kernel_avx2<Outer, Inner>;
+    }
+#endif
+    return bitmap_kernel_scalar<Outer, Inner>;
+  }
+
+//Kernel op codes, bitmap_op followed by notand, and first for Inner
+enum bitmap_kernel_op { kernel_and, kernel_or, kernel_xor, kernel_andnot, kernel_notand, kernel_first };
+
+template <typename Outer>
+  inline bitmap_kernel select_bitmap_kernel(int inner) noexcept {
+    switch(inner) {
+      case kernel_and: return select_bitmap_kernel<Outer, bitmap_and_op>();
+      case kernel_or: return select_bitmap_kernel<Outer, bitmap_or_op>();
+      case kernel_xor: return select_bitmap_kernel<Outer, bitmap_xor_op>();
+      case kernel_andnot: return select_bitmap_kernel<Outer, bitmap_andnot_op>();
+      default: return select_bitmap_kernel<Outer, bitmap_first_op>();
+    }
+  }
+
+inline bitmap_kernel select_bitmap_kernel(int outer, int inner) noexcept {
+  switch(outer) {
+    case kernel_and: return select_bitmap_kernel<bitmap_and_op>(inner);
+    case kernel_or: return select_bitmap_kernel<bitmap_or_op>(inner);
+    case kernel_xor: return select_bitmap_kernel<bitmap_xor_op>(inner);
+    case kernel_andnot: return select_bitmap_kernel<bitmap_andnot_op>(inner);
+    default: return select_bitmap_kernel<bitmap_notand_op>(inner);
+  }
+}
+
+} //namespace bitops_detail
+
+//An expression of AND, OR, XOR and ANDNOT over bitmaps of the same number of uint64_t words.
+//Nodes are added with input() and apply(), which return their index.
+//
+//An expression is evaluated in one pass over the inputs, in chunks of chunk_words words.
+//The operators run chunk by chunk on temporaries which stay in the L1 cache, so each input is read
+//from memory once and the result is written at most once. The popcount of the result may be
+//computed from each chunk of it in the same pass, with or without storing the result.
+//Each operator is fused with one operator below it into a kernel of 3 inputs.
+//x86_64 AVX-512: one vpternlogq per vector for each pair of operators
+//x86_64 AVX2: vpand, vpor, vpxor, vpandn
+class bitmap_expr {
+  public:
+    //Words per chunk of the evaluation
+    static constexpr size_t chunk_words = 256;
+
+    bitmap_expr() noexcept = default;
+
+    //Expression over bitmaps of nwords words
+    explicit bitmap_expr(size_t nwords) noexcept : _nwords(nwords) {}
+
+    //Number of words of each bitmap
+    size_t size() const noexcept { return _nwords; }
+
+    //Adds the bitmap at words, which must stay valid while the expression is evaluated
+    int input(const uint64_t* words) {
+      _nodes.push_back(node{ words, bitmap_op::bit_and, -1, -1 });
+      return int(_nodes.size() - 1);
+    }
+
+    //Adds the node l op r, undefined if l or r is not a node of this expression.
+    //Each node may be an operand of one other node only.
+    int apply(bitmap_op op, int l, int r) {
+      _nodes.push_back(node{ nullptr, op, l, r });
+      return int(_nodes.size() - 1);
+    }
+
+    //Stores node root to the size() words at out
+    void evaluate(int root, uint64_t* out) const {
+      run<true, false>(root, out);
+    }
+
+    //Returns the number of 1 bits of node root without storing it
+    size_t count(int root) const {
+      return run<false, true>(root, nullptr);
+    }
+
+    //Stores node root to out and returns its number of 1 bits
+    size_t evaluate_count(int root, uint64_t* out) const {
+      return run<true, true>(root, out);
+    }
+
+  private:
+    struct node {
+      const uint64_t* words;
+      bitmap_op op;
+      int l;
+      int r;
+    };
+
+    //An input bitmap if slot is -1, else a temporary chunk
+    struct operand {
+      const uint64_t* words;
+      int slot;
+    };
+
+    struct instr {
+      bitops_detail::bitmap_kernel kernel;
+      operand a, b, c;
+      int dst;
+    };
+
+    struct program {
+      std::vector<instr> code;
+      std::vector<int> free;
+      int nslots = 0;
+
+      int alloc() {
+        if(free.empty()) {
+          return nslots++;
+        }
+        int s = free.back();
+        free.pop_back();
+        return s;
+      }
+      void release(const operand& o) {
+        if(o.slot >= 0) {
+          free.push_back(o.slot);
+        }
+      }
+    };
+
+    bool is_input(int i) const noexcept { return _nodes[size_t(i)].l < 0; }
+
+    //Emits the kernels of node i, fusing it with its left or else its right operand if that is an operator
+    operand compile(int i, program& p) const {
+      const node& n = _nodes[size_t(i)];
+      if(is_input(i)) {
+        return operand{ n.words, -1 };
+      }
+      int outer = int(n.op);
+      int inner = bitops_detail::kernel_first;
+      int fused = -1;
+      int other = n.r;
+      if(!is_input(n.l)) {
+        fused = n.l;
+      } else if(!is_input(n.r)) {
+        //l op r is r op' l, ANDNOT becomes NOTAND
+        fused = n.r;
+        other = n.l;
+        outer = n.op == bitmap_op::bit_andnot ? bitops_detail::kernel_notand : outer;
+      }
+      instr in;
+      if(fused >= 0) {
+        const node& f = _nodes[size_t(fused)];
+        inner = int(f.op);
+        in.a = compile(f.l, p);
+        in.b = compile(f.r, p);
+      } else {
+        in.a = compile(n.l, p);
+        in.b = in.a;
+      }
+      in.c = compile(other, p);
+      in.kernel = bitops_detail::select_bitmap_kernel(outer, inner);
+      p.release(in.a);
+      if(fused >= 0) {
+        p.release(in.b);
+      }
+      p.release(in.c);
+      in.dst = p.alloc();
+      p.code.push_back(in);
+      return operand{ nullptr, in.dst };
+    }
+
+    template <bool Store, bool Count>
+      size_t run(int root, uint64_t* out) const {
+        program p;
+        operand res = compile(root, p);
+        std::vector<uint64_t> tmp(size_t(p.nslots) * chunk_words);
+        auto words = [&](const operand& o, size_t off) -> const uint64_t* {
+          return o.slot < 0 ? o.words + off : tmp.data() + size_t(o.slot) * chunk_words;
+        };
+        size_t c = 0;
+        for(size_t off = 0; off < _nwords; off += chunk_words) {
+          size_t n = std::min(size_t(chunk_words), _nwords - off);
+          const uint64_t* r = words(res, off);
+          for(size_t k = 0; k < p.code.size(); ++k) {
+            const instr& in = p.code[k];
+            //The last kernel writes the result straight to out
+            uint64_t* dst = Store && k + 1 == p.code.size() ? out + off : tmp.data() + size_t(in.dst) * chunk_words;
+            in.kernel(words(in.a, off), words(in.b, off), words(in.c, off), dst, n);
+            r = dst;
+          }
+          if(Store && p.code.empty()) {
+            std::memcpy(out + off, r, n * sizeof(uint64_t));
+          }
+          if(Count) {
+            c += popcount(r, n);
+          }
+        }
+        return c;
+      }
+
+    std::vector<node> _nodes;
+    size_t _nwords = 0;
+};
+
+} //namespace std
+
+#endif
@@ -7,25 +7,177 @@
 #define constexpr14
 #endif
 
+//BITOPS_CONSTANT_EVALUATED() is true during constant evaluation. Intrinsics which are not constexpr
+//may only be used by constexpr functions when this is available.
+//Before C++14 the constexpr14 functions are never constant evaluated.
+#if !defined(__cpp_constexpr) || __cpp_constexpr < 201304
+#define BITOPS_CONSTANT_EVALUATED() false
+#elif defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define BITOPS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#endif
+
+//Runtime dispatch compiles kernels for newer instruction sets with the target attribute
+//and selects them after checking cpuid. Define BITOPS_NO_RUNTIME_DISPATCH to disable.
+#if !defined(BITOPS_NO_RUNTIME_DISPATCH) && (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define BITOPS_RUNTIME_DISPATCH 1
+#define BITOPS_TARGET(isa) __attribute__((target(isa)))
+#else
+#define BITOPS_TARGET(isa)
+#endif
+
+//PDEP and PEXT are microcoded on AMD cpus before Zen 3, so they are only used unconditionally
+//when compiling for another target.
+#if defined(__BMI2__) && defined(__x86_64__) && defined(BITOPS_CONSTANT_EVALUATED) \
+  && !defined(__znver1__) && !defined(__znver2__) && !defined(__bdver4__)
+#define BITOPS_PDEP 1
+#endif
+
+//Byte order of the target, little endian unless the compiler says otherwise
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define BITOPS_BIG_ENDIAN 1
+#endif
+
+//BITOPS_UNROLL(n) unrolls the loop which follows n times where the compiler supports it
+#define BITOPS_PRAGMA(x) _Pragma(#x)
+#if defined(__clang__)
+#define BITOPS_UNROLL(n) BITOPS_PRAGMA(unroll n)
+#elif defined(__GNUC__) && __GNUC__ >= 8
+#define BITOPS_UNROLL(n) BITOPS_PRAGMA(GCC unroll n)
+#else
+#define BITOPS_UNROLL(n)
+#endif
+
 #include <cstdint>
 #include <cstddef>
 #include <climits>
 #include <limits>
 #include <type_traits>
 #include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <iterator>
+#include <array>
+
+#if defined(BITOPS_RUNTIME_DISPATCH) || defined(BITOPS_PDEP)
+#include <immintrin.h>
+#endif
+#if defined(BITOPS_RUNTIME_DISPATCH)
+#include <cpuid.h>
+#endif
 
 namespace std {
 
 //This implementation makes the following platform assumptions:
 //* signed right shift is an arithmetic shift
 //* CHAR_BIT == 8
-//* Native integer types are exactly 8, 16, 32, and 64 bits wide. No support is added for larger types.
+//* Native integer types are exactly 8, 16, 32, and 64 bits wide, plus the 128 bit integers of gcc and clang.
 //* Signed numbers are implemented using 2's compliment
 //
 //The implementation is not designed to be efficient. The purpose is only to prove that each proposed function is implementable.
+//The exception is the counting functions, which use compiler builtins when available (see BITOPS_NO_BUILTINS).
 //A real implementation may use techniques such as SFINAE, static_assert, overloading, and/or = delete to limit the set of overloads.
 //These have been omitted here to improve readability.
 
+////////////////////////////////////
+//Runtime cpu feature detection
+////////////////////////////////////
+
+namespace bitops_detail {
+
+//Instruction set extensions used by the runtime dispatched functions
+struct cpu_features {
+  bool bmi2 = false;
+  //bmi2 and PDEP/PEXT are not microcoded
+  bool fast_pdep = false;
+  bool ssse3 = false;
+  bool avx2 = false;
+  bool avx512f = false;
+  bool avx512bw = false;
+  bool avx512vpopcntdq = false;
+};
+
+#if defined(BITOPS_RUNTIME_DISPATCH)
+//Runs once, kept out of line so it does not weigh on the fast path of each dispatching function
+__attribute__((noinline, cold)) inline cpu_features detect_cpu_features() noexcept {
+  cpu_features f;
+  __builtin_cpu_init();
+  f.bmi2 = __builtin_cpu_supports("bmi2");
+  f.ssse3 = __builtin_cpu_supports("ssse3");
+  f.avx2 = __builtin_cpu_supports("avx2");
+  f.avx512f = __builtin_cpu_supports("avx512f");
+  f.avx512bw = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+  f.avx512vpopcntdq = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq");
+
+  unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+  bool amd = __get_cpuid(0, &eax, &ebx, &ecx, &edx) && ebx == 0x68747541; //"Auth"enticAMD
+  int family = 0;
+  if(__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    family = (eax >> 8) & 0xF;
+    if(family == 0xF) { family += (eax >> 20) & 0xFF; }
+  }
+  //AMD implements PDEP/PEXT in microcode before Zen 3 (family 0x19)
+  f.fast_pdep = f.bmi2 && !(amd && family < 0x19);
+  return f;
+}
+#else
+inline cpu_features detect_cpu_features() noexcept {
+  return cpu_features();
+}
+#endif
+
+//Features of the cpu we are running on, detected once
+inline const cpu_features& cpu() noexcept {
+  static const cpu_features f = detect_cpu_features();
+  return f;
+}
+
+//The has_ functions are constant when the target has the feature at compile time
+inline bool has_avx2() noexcept {
+#if defined(__AVX2__)
+  return true;
+#else
+  return cpu().avx2;
+#endif
+}
+
+inline bool has_fast_pdep() noexcept {
+#if defined(BITOPS_PDEP)
+  return true;
+#else
+  return cpu().fast_pdep;
+#endif
+}
+
+inline bool has_avx512vpopcntdq() noexcept {
+#if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+  return true;
+#else
+  return cpu().avx512vpopcntdq;
+#endif
+}
+
+} //namespace bitops_detail
+
+namespace bitops_detail {
+
+//std::make_unsigned, std::make_signed and std::is_integral, extended to the 128 bit
+//integers which the standard traits only know about in the gnu++ language modes
+template <typename Integral> struct make_unsigned : std::make_unsigned<Integral> {};
+template <typename Integral> struct make_signed : std::make_signed<Integral> {};
+template <typename T> struct is_integral : std::is_integral<T> {};
+#if defined(__SIZEOF_INT128__)
+template <> struct make_unsigned<__int128> { typedef unsigned __int128 type; };
+template <> struct make_unsigned<unsigned __int128> { typedef unsigned __int128 type; };
+template <> struct make_signed<__int128> { typedef __int128 type; };
+template <> struct make_signed<unsigned __int128> { typedef __int128 type; };
+template <> struct is_integral<__int128> : std::true_type {};
+template <> struct is_integral<unsigned __int128> : std::true_type {};
+#endif
+
+} //namespace bitops_detail
+
 ////////////////////////////////////
 //Explicit shifts
 ////////////////////////////////////
@@ -35,7 +187,7 @@ namespace std {
 //Included for symmetry
 template <typename Integral>
   constexpr Integral shll(Integral x, int s) noexcept {
-    return Integral(typename std::make_unsigned<Integral>::type(x) << s);
+    return Integral(typename bitops_detail::make_unsigned<Integral>::type(x) << s);
   }
 
 //Logical right shift, undefined if s < 0 or x > sizeof(x) * CHAR_BIT
@@ -43,7 +195,7 @@ template <typename Integral>
 //Included for symmetry, also can right shift a signed number easily without a cast to unsigned
 template <typename Integral>
   constexpr Integral shlr(Integral x, int s) noexcept {
-    return Integral(typename std::make_unsigned<Integral>::type(x) >> s);
+    return Integral(typename bitops_detail::make_unsigned<Integral>::type(x) >> s);
   }
 
 //Arithmetic left shift, undefined if s < 0 or x > sizeof(x) * CHAR_BIT
@@ -59,39 +211,62 @@ template <typename Integral>
 template <typename Integral>
   constexpr Integral shar(Integral x, int s) noexcept {
     //Assumes signed right shift is arithmetic. If it is not the platform will need to implement this another way.
-    return Integral(typename std::make_signed<Integral>::type(x) >> s);
+    return Integral(typename bitops_detail::make_signed<Integral>::type(x) >> s);
   }
 
 //Circular left shift (rotate), undefined if s < 0 or x > sizeof(x) * CHAR_BIT
 //Just about every processor in existance has this, including the PDP-11 (1969) and yet C or C++ never included a way to get at this instruction.
 template <typename Integral>
   constexpr Integral rotl(Integral x, int s) noexcept {
-    return (x << s) | shlr(x, (sizeof(x)*CHAR_BIT-s));
+    return Integral(shll(x, s & int(sizeof(x)*CHAR_BIT-1)) | shlr(x, -s & int(sizeof(x)*CHAR_BIT-1)));
   }
 
 //Circular right shift (rotate), undefined if s < 0 or x > sizeof(x) * CHAR_BIT
 //Just about every processor in existance has this, including the PDP-11 (1969) and yet C or C++ never included a way to get at this instruction.
 template <typename Integral>
   constexpr Integral rotr(Integral x, int s) noexcept {
-    return shlr(x, s) | ( x << (sizeof(x)*CHAR_BIT-s));
+    return Integral(shlr(x, s & int(sizeof(x)*CHAR_BIT-1)) | shll(x, -s & int(sizeof(x)*CHAR_BIT-1)));
   }
 
 ////////////////////////////////////
 //Zero and One Counting algorithms
 ////////////////////////////////////
 
-//Returns the number of trailing zeros in x, or sizeof(x) * CHAR_BIT if x is 0
-//i386 bsf, cmov
-//x86_64 w/ BMI1: tzcnt
-//Alpha: cttz
-//MIPS: CLZ
-//gcc: x == 0 ? sizeof(x) * CHAR_BIT :__builtin_ctz(x)
-//Applications: SSE2 strlen, Howard Hinnant's gcd example
+//Each counting function has a portable constexpr implementation in bitops_detail
+//and, where the compiler provides one, a builtin backed implementation. The gcc and clang
+//builtins can be evaluated in constant expressions and lower to tzcnt, lzcnt, popcnt, etc..
+//when the target supports them, so the public functions remain constexpr either way.
+//Define BITOPS_NO_BUILTINS to force the portable implementations.
+#if !defined(BITOPS_NO_BUILTINS) && (defined(__GNUC__) || defined(__clang__))
+#define BITOPS_BUILTIN_CTZ 1
+#define BITOPS_BUILTIN_CLZ 1
+#define BITOPS_BUILTIN_PARITY 1
+//Without a popcnt instruction __builtin_popcount becomes a libgcc call, which is slower than the inline SWAR code.
+#if defined(__POPCNT__) || !(defined(__i386__) || defined(__x86_64__))
+#define BITOPS_BUILTIN_POPCOUNT 1
+#endif
+#define BITOPS_BUILTIN_BSWAP 1
+//clang only, lowers to RBIT on ARM
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_bitreverse64)
+#define BITOPS_BUILTIN_BITREVERSE 1
+#endif
+#endif
+#endif
+
+namespace bitops_detail {
+
+//Converts x to its unsigned counterpart without sign extension
 template <typename Integral>
-  constexpr14 int cntt0(Integral x) noexcept {
+  constexpr typename bitops_detail::make_unsigned<Integral>::type to_unsigned(Integral x) noexcept {
+    return typename bitops_detail::make_unsigned<Integral>::type(x);
+  }
+
+template <typename Integral>
+  constexpr14 int cntt0_portable(Integral x) noexcept {
     constexpr int nbits = int(sizeof(x) * CHAR_BIT);
     if(x == 0) { return nbits; }
-    Integral n = 0;
+    int n = 1;
     if(sizeof(x) > 1) {
       if(sizeof(x) > 2) {
         if(sizeof(x) > 4) {
@@ -103,7 +278,115 @@ template <typename Integral>
     }
     if((x & Integral(0xFUL)) == 0) { n = n + 4; x = shlr(x, 4); }
     if((x & Integral(0x3UL)) == 0) { n = n + 2; x = shlr(x, 2); }
-    return n - (x & 1);
+    return n - int(x & 1);
+  }
+
+template <typename Integral>
+  constexpr14 int cntl0_portable(Integral x) noexcept {
+    constexpr int nbits = int(sizeof(x) * CHAR_BIT);
+    if(x == 0) { return nbits; }
+    int n = 1;
+    if(sizeof(x) > 1) {
+      if(sizeof(x) > 2) {
+        if(sizeof(x) > 4) {
+          if((shlr(x, nbits-32)) == 0) { n = n + 32; x = shll(x, 32); }
+        }
+        if((shlr(x, nbits-16)) == 0) { n = n + 16; x = shll(x, 16); }
+      }
+      if((shlr(x, nbits-8)) == 0) { n = n + 8; x = shll(x, 8); }
+    }
+    if((shlr(x, nbits-4)) == 0) { n = n + 4; x = shll(x, 4); }
+    if((shlr(x, nbits-2)) == 0) { n = n + 2; x = shll(x, 2); }
+    return n - int(shlr(x, nbits-1));
+  }
+
+template <typename Integral>
+  constexpr14 int popcount_portable(Integral v) noexcept {
+    //Unsigned, so that the partial sums of signed types can not overflow
+    typedef typename bitops_detail::make_unsigned<Integral>::type U;
+    U x = to_unsigned(v);
+    x = (x & U(0x5555555555555555UL)) + (shlr(x, 1) & U(0x5555555555555555UL));
+    x = (x & U(0x3333333333333333UL)) + (shlr(x, 2) & U(0x3333333333333333UL));
+    x = (x & U(0x0F0F0F0F0F0F0F0FUL)) + (shlr(x, 4) & U(0x0F0F0F0F0F0F0F0FUL));
+    if(sizeof(x) > 1) {
+      x = (x & U(0x00FF00FF00FF00FFUL)) + (shlr(x, 8) & U(0x00FF00FF00FF00FFUL));
+      if(sizeof(x) > 2) {
+        x = (x & U(0x0000FFFF0000FFFFUL)) + (shlr(x, 16) & U(0x0000FFFF0000FFFFUL));
+        if(sizeof(x) > 4) {
+          x = (x & U(0x00000000FFFFFFFFUL)) + (shlr(x, 32) & U(0x00000000FFFFFFFFUL));
+        }
+      }
+    }
+    return int(x);
+  }
+
+template <typename Integral>
+  constexpr14 int parity_portable(Integral x) noexcept {
+    x = x ^ shlr(x, 1);
+    x = x ^ shlr(x, 2);
+    x = x ^ shlr(x, 4);
+    if(sizeof(x) > 1) {
+      x = x ^ shlr(x, 8);
+      if(sizeof(x) > 2) {
+        x = x ^ shlr(x, 16);
+        if(sizeof(x) > 4) {
+          x = x ^ shlr(x, 32);
+        }
+      }
+    }
+    return int(x & 1);
+  }
+
+#if defined(BITOPS_BUILTIN_CTZ)
+template <typename Integral>
+  constexpr int cntt0_builtin(Integral x) noexcept {
+    return x == 0 ? int(sizeof(x) * CHAR_BIT)
+      : sizeof(x) <= sizeof(unsigned) ? __builtin_ctz(unsigned(to_unsigned(x)))
+      : __builtin_ctzll((unsigned long long)(to_unsigned(x)));
+  }
+#endif
+
+#if defined(BITOPS_BUILTIN_CLZ)
+template <typename Integral>
+  constexpr int cntl0_builtin(Integral x) noexcept {
+    return x == 0 ? int(sizeof(x) * CHAR_BIT)
+      : sizeof(x) <= sizeof(unsigned) ? __builtin_clz(unsigned(to_unsigned(x))) - int((sizeof(unsigned) - sizeof(x)) * CHAR_BIT)
+      : __builtin_clzll((unsigned long long)(to_unsigned(x)));
+  }
+#endif
+
+#if defined(BITOPS_BUILTIN_POPCOUNT)
+template <typename Integral>
+  constexpr int popcount_builtin(Integral x) noexcept {
+    return sizeof(x) <= sizeof(unsigned) ? __builtin_popcount(unsigned(to_unsigned(x)))
+      : __builtin_popcountll((unsigned long long)(to_unsigned(x)));
+  }
+#endif
+
+#if defined(BITOPS_BUILTIN_PARITY)
+template <typename Integral>
+  constexpr int parity_builtin(Integral x) noexcept {
+    return sizeof(x) <= sizeof(unsigned) ? __builtin_parity(unsigned(to_unsigned(x)))
+      : __builtin_parityll((unsigned long long)(to_unsigned(x)));
+  }
+#endif
+
+} //namespace bitops_detail
+
+//Returns the number of trailing zeros in x, or sizeof(x) * CHAR_BIT if x is 0
+//i386 bsf, cmov
+//x86_64 w/ BMI1: tzcnt
+//Alpha: cttz
+//MIPS: CLZ
+//gcc: x == 0 ? sizeof(x) * CHAR_BIT :__builtin_ctz(x)
+//Applications: SSE2 strlen, Howard Hinnant's gcd example
+template <typename Integral>
+  constexpr14 int cntt0(Integral x) noexcept {
+#if defined(BITOPS_BUILTIN_CTZ)
+    return bitops_detail::cntt0_builtin(x);
+#else
+    return bitops_detail::cntt0_portable(x);
+#endif
   }
 
 //Returns the number of leading zeroes in x, or sizeof(x) * CHAR_BIT if x is 0
@@ -116,24 +399,30 @@ template <typename Integral>
 //gcc: x == 0 ? sizeof(x) * CHAR_BIT :__builtin_clz(x)
 template <typename Integral>
   constexpr14 int cntl0(Integral x) noexcept {
-    constexpr int nbits = int(sizeof(x) * CHAR_BIT);
-    if(x == 0) { return nbits; }
-    Integral n = 1;
-    if(sizeof(x) > 1) {
-      if(sizeof(x) > 2) {
-        if(sizeof(x) > 4) {
-          if((shlr(x, nbits-32)) == 0) { n = n + 32; x = x << 32; }
-        }
-        if((shlr(x, nbits-16)) == 0) { n = n + 16; x = x << 16; }
-      }
-      if((shlr(x, nbits-8)) == 0) { n = n + 8; x = x << 8; }
-    }
-    if((shlr(x, nbits-4)) == 0) { n = n + 4; x = x << 4; }
-    if((shlr(x, nbits-2)) == 0) { n = n + 2; x = x << 2; }
-    n = n - (shlr(x, 31));
-    return n;
+#if defined(BITOPS_BUILTIN_CLZ)
+    return bitops_detail::cntl0_builtin(x);
+#else
+    return bitops_detail::cntl0_portable(x);
+#endif
   }
 
+#if defined(__SIZEOF_INT128__)
+//128 bit integers are counted in their 64 bit halves, testing the half which decides the result first
+inline constexpr14 int cntt0(unsigned __int128 x) noexcept {
+  return uint64_t(x) != 0 ? cntt0(uint64_t(x)) : 64 + cntt0(uint64_t(x >> 64));
+}
+inline constexpr14 int cntt0(__int128 x) noexcept {
+  return cntt0((unsigned __int128)x);
+}
+
+inline constexpr14 int cntl0(unsigned __int128 x) noexcept {
+  return uint64_t(x >> 64) != 0 ? cntl0(uint64_t(x >> 64)) : 64 + cntl0(uint64_t(x));
+}
+inline constexpr14 int cntl0(__int128 x) noexcept {
+  return cntl0((unsigned __int128)x);
+}
+#endif
+
 //Returns the number of leading 1 bits in x.
 //ARMv8: CLS
 //Blackfin: SIGNBITS
@@ -143,13 +432,13 @@ template <typename Integral>
 //gcc: __builtin_clrsb(x)
 template <typename Integral>
   constexpr14 int cntl1(Integral x) noexcept {
-    return cntl0(~x);
+    return cntl0(Integral(~x));
   }
 
 //Returns the number of trailing 1 bits in x.
 template <typename Integral>
   constexpr14 int cntt1(Integral x) noexcept {
-    return cntt0(~x);
+    return cntt0(Integral(~x));
   }
 
 //Returns the number of 1 bits in x.
@@ -162,57 +451,77 @@ template <typename Integral>
 //gcc: __builtin_popcount(x)
 template <typename Integral>
   constexpr14 int popcount(Integral x) noexcept {
-    x = (x & Integral(0x5555555555555555UL)) + (shlr(x, 1) & Integral(0x5555555555555555UL));
-    x = (x & Integral(0x3333333333333333UL)) + (shlr(x, 2) & Integral(0x3333333333333333UL));
-    x = (x & Integral(0x0F0F0F0F0F0F0F0FUL)) + (shlr(x, 4) & Integral(0x0F0F0F0F0F0F0F0FUL));
-    if(sizeof(x) > 1) {
-      x = (x & Integral(0x00FF00FF00FF00FFUL)) + (shlr(x, 8) & Integral(0x00FF00FF00FF00FFUL));
-      if(sizeof(x) > 2) {
-        x = (x & Integral(0x0000FFFF0000FFFFUL)) + (shlr(x, 16) & Integral(0x0000FFFF0000FFFFUL));
-        if(sizeof(x) > 4) {
-          x = (x & Integral(0x00000000FFFFFFFFUL)) + (shlr(x, 32) & Integral(0x00000000FFFFFFFFUL));
-        }
-      }
-    }
-    return x;
+#if defined(BITOPS_BUILTIN_POPCOUNT)
+    return bitops_detail::popcount_builtin(x);
+#else
+    return bitops_detail::popcount_portable(x);
+#endif
   }
 
 //Returns the number of 1 bits in x mod 2
 //gcc: __builtin_parity(x)
 template <typename Integral>
   constexpr14 int parity(Integral x) noexcept {
-    x = x ^ shlr(x, 1);
-    x = x ^ shlr(x, 2);
-    x = x ^ shlr(x, 4);
-    if(sizeof(x) > 1) {
-      x = x ^ shlr(x, 8);
-      if(sizeof(x) > 2) {
-        x = x ^ shlr(x, 16);
-        if(sizeof(x) > 4) {
-          x = x ^ shlr(x, 32);
-        }
-      }
-    }
-    return x;
+#if defined(BITOPS_BUILTIN_PARITY)
+    return bitops_detail::parity_builtin(x);
+#else
+    return bitops_detail::parity_portable(x);
+#endif
   }
 
+#if defined(__SIZEOF_INT128__)
+inline constexpr14 int popcount(unsigned __int128 x) noexcept {
+  return popcount(uint64_t(x)) + popcount(uint64_t(x >> 64));
+}
+inline constexpr14 int popcount(__int128 x) noexcept {
+  return popcount((unsigned __int128)x);
+}
+
+inline constexpr14 int parity(unsigned __int128 x) noexcept {
+  return parity(uint64_t(x) ^ uint64_t(x >> 64));
+}
+inline constexpr14 int parity(__int128 x) noexcept {
+  return parity((unsigned __int128)x);
+}
+#endif
+
 ////////////////////////////////////
 //Rightmost bit manipulation
 ////////////////////////////////////
 
+namespace bitops_detail {
+
+//x + 1, x - 1 and -x wrapping around like the unsigned operations, where the signed ones would overflow
+template <typename Integral>
+  constexpr Integral inc(Integral x) noexcept {
+    return Integral(to_unsigned(x) + 1u);
+  }
+
+template <typename Integral>
+  constexpr Integral dec(Integral x) noexcept {
+    return Integral(to_unsigned(x) - 1u);
+  }
+
+template <typename Integral>
+  constexpr Integral neg(Integral x) noexcept {
+    return Integral(0u - to_unsigned(x));
+  }
+
+} //namespace bitops_detail
+
 //Reset least siginificant 1 bit
 //Resets the least siginificant 1 bit of x. Returns 0 if x is 0.
 //x86_64 BMI1: BLSR
 template <typename Integral>
   constexpr Integral rstls1b(Integral x) {
-    return x & (x-1);
+    return x & bitops_detail::dec(x);
   }
 
 //Set the least significant 0 bit
 //x86_64 AMD TBM: BLCS
 template <typename Integral>
   constexpr Integral setls0b(Integral x) {
-    return x | (x + 1);
+    return x | bitops_detail::inc(x);
   }
 
 //Isolate least siginificant 1 bit
@@ -221,39 +530,39 @@ template <typename Integral>
 //x86_64 AMD TBM: BLSIC, NOT
 template <typename Integral>
   constexpr Integral isols1b(Integral x) {
-    return x & -x;
+    return x & bitops_detail::neg(x);
   }
 
 //Set the least significant zero bit to 1 and all of the rest to 0.
 template <typename Integral>
   constexpr Integral isols0b(Integral x) {
-    return (~x) & (x + 1);
+    return (~x) & bitops_detail::inc(x);
   }
 
 //Reset the trailing 1's in x
 //x86_64 AMD TBM: BLCFILL
 template <typename Integral>
   constexpr Integral rstt1(Integral x) {
-    return x & (x + 1);
+    return x & bitops_detail::inc(x);
   }
 
 //Set all of the trailing 0's in x
 //x86_64 AMD TBM: BLSFILL
 template <typename Integral>
   constexpr Integral sett0(Integral x) {
-    return x | (x - 1);
+    return x | bitops_detail::dec(x);
   }
 
 //Returns a mask with all of the trailing 0's set.
 template <typename Integral>
   constexpr Integral maskt0(Integral x) {
-    return (~x) & (x-1);
+    return (~x) & bitops_detail::dec(x);
   }
 
 //Returns a mask with all of the trailing 1's set.
 template <typename Integral>
   constexpr Integral maskt1(Integral x) {
-    return ~((~x) | (x + 1));
+    return ~((~x) | bitops_detail::inc(x));
   }
 
 //Returns a mask with all of the trailing 0's  and the least significant 1 bit set.
@@ -261,20 +570,46 @@ template <typename Integral>
 //x86_64 AMD TBM: TZMSK
 template <typename Integral>
   constexpr Integral maskt0ls1b(Integral x) {
-    return (x-1) ^ x;
+    return bitops_detail::dec(x) ^ x;
   }
 
 //Returns a mask with all of the trailing 1's and the least significant 0 bit set.
 template <typename Integral>
   constexpr Integral maskt1ls0b(Integral x) {
-    return x ^ (x + 1);
+    return x ^ bitops_detail::inc(x);
   }
 
 ////////////////////////////////////
 //Bit and Byte reversal algorithms
 ////////////////////////////////////
 
+namespace bitops_detail {
+
+//reverse_bits moves bit i of x to bit i ^ k, this returns k.
+template <typename Integral>
+  constexpr int reverse_bits_xor(int subword_bits, int group_subwords) noexcept {
+    return (int(sizeof(Integral) * CHAR_BIT) / subword_bits < group_subwords ?
+        int(sizeof(Integral) * CHAR_BIT) / subword_bits : group_subwords) * subword_bits - subword_bits;
+  }
+
+//Moves bit i of x to bit i ^ k, one swap stage for each bit of k
+template <typename Integral>
+  constexpr14 Integral reverse_bits_by_xor(Integral x, int k) noexcept {
+    if(k & 1) x = shll(x & Integral(0x5555555555555555UL), 1) | shlr(x & Integral(0xAAAAAAAAAAAAAAAAUL), 1);
+    if(k & 2) x = shll(x & Integral(0x3333333333333333UL), 2) | shlr(x & Integral(0xCCCCCCCCCCCCCCCCUL), 2);
+    if(k & 4) x = shll(x & Integral(0x0F0F0F0F0F0F0F0FUL), 4) | shlr(x & Integral(0xF0F0F0F0F0F0F0F0UL), 4);
+    //sizeof comparisons added to help compiler remove these checks for small integers
+    if(sizeof(x) > 1 && k & 8) x = shll(x & Integral(0x00FF00FF00FF00FFUL), 8) | shlr(x & Integral(0xFF00FF00FF00FF00UL), 8);
+    if(sizeof(x) > 2 && k & 16) x = shll(x & Integral(0x0000FFFF0000FFFFUL), 16) | shlr(x & Integral(0xFFFF0000FFFF0000UL), 16);
+    if(sizeof(x) > 4 && k & 32) x = shll(x & Integral(0x00000000FFFFFFFFUL), 32) | shlr(x & Integral(0xFFFFFFFF00000000UL), 32);
+    return x;
+  }
+
+} //namespace bitops_detail
+
 //Reverse each group of blocks of bits in x.
+//Each group is subword_bits * group_subwords bits wide, groups wider than x are clamped to the width of x.
+//By default there is one group covering all of x.
 //
 //bits_per_block == 1: reverses the bits of x
 //ARMv7: RBIT
@@ -294,38 +629,158 @@ template <typename Integral>
 template <typename Integral>
   constexpr14 auto reverse_bits(Integral x,
       int subword_bits = 1,
-      int group_subwords = 1)
+      int group_subwords = int(sizeof(Integral) * CHAR_BIT))
   noexcept -> typename std::enable_if<std::is_unsigned<Integral>::value, Integral>::type {
-    int group_sz = int(sizeof(Integral) * CHAR_BIT) / group_subwords;
-    int k = group_sz - subword_bits;
-    if(k & 1) x = shll(x & Integral(0x5555555555555555UL), 1) | shlr(x & Integral(0xAAAAAAAAAAAAAAAAUL), 1);
-    if(k & 2) x = shll(x & Integral(0x3333333333333333UL), 2) | shlr(x & Integral(0xCCCCCCCCCCCCCCCCUL), 2);
-    if(k & 4) x = shll(x & Integral(0x0F0F0F0F0F0F0F0FUL), 4) | shlr(x & Integral(0xF0F0F0F0F0F0F0F0UL), 4);
-    //sizeof comparisons added to help compiler remove these checks for small integers
-    if(sizeof(x) > 1 && k & 8) x = shll(x & Integral(0x00FF00FF00FF00FFUL), 8) | shlr(x & Integral(0xFF00FF00FF00FF00UL), 8);
-    if(sizeof(x) > 2 && k & 16) x = shll(x & Integral(0x0000FFFF0000FFFFUL), 16) | shlr(x & Integral(0xFFFF0000FFFF0000UL), 16);
-    if(sizeof(x) > 4 && k & 32) x = shll(x & Integral(0x00000000FFFFFFFFUL), 32) | shlr(x & Integral(0xFFFFFFFF00000000UL), 32);
-    return x;
+    return bitops_detail::reverse_bits_by_xor(x, bitops_detail::reverse_bits_xor<Integral>(subword_bits, group_subwords));
   }
 
 //Signed version calls unsigned to avoid sign extension issues
 template <typename Integral>
   constexpr14 auto reverse_bits(Integral x,
       int subword_bits = 1,
-      int group_subwords = 1)
+      int group_subwords = int(sizeof(Integral) * CHAR_BIT))
   noexcept -> typename std::enable_if<std::is_signed<Integral>::value, Integral>::type {
-    return Integral(reverse_bits(typename std::make_unsigned<Integral>::type(x), subword_bits, group_subwords));
+    return Integral(reverse_bits(typename bitops_detail::make_unsigned<Integral>::type(x), subword_bits, group_subwords));
   }
 
+#if defined(__SIZEOF_INT128__)
+//128 bit integers reverse both 64 bit halves, swapping them when the groups are wider than 64 bits
+inline constexpr14 unsigned __int128 reverse_bits(unsigned __int128 x,
+    int subword_bits = 1,
+    int group_subwords = 128) noexcept {
+  int k = bitops_detail::reverse_bits_xor<unsigned __int128>(subword_bits, group_subwords);
+  uint64_t lo = bitops_detail::reverse_bits_by_xor(uint64_t(x), k & 63);
+  uint64_t hi = bitops_detail::reverse_bits_by_xor(uint64_t(x >> 64), k & 63);
+  return k & 64 ? (unsigned __int128)lo << 64 | hi : (unsigned __int128)hi << 64 | lo;
+}
+inline constexpr14 __int128 reverse_bits(__int128 x,
+    int subword_bits = 1,
+    int group_subwords = 128) noexcept {
+  return __int128(reverse_bits((unsigned __int128)x, subword_bits, group_subwords));
+}
+#endif
 
 //Byte reversal, simple wrapper around reverse_bits
 template <typename Integral>
-  constexpr14 Integral reverse_bytes(Integral x,
-      int bytes_per_block=1,
-      int blocks_per_group = sizeof(Integral)) noexcept {
+  constexpr14 auto reverse_bytes(Integral x,
+      int bytes_per_block = 1,
+      int blocks_per_group = sizeof(Integral))
+  noexcept -> typename std::enable_if<bitops_detail::is_integral<Integral>::value, Integral>::type {
     return reverse_bits(x, CHAR_BIT * bytes_per_block, blocks_per_group);
   }
 
+namespace bitops_detail {
+
+//Masks the lower half of each 2 * s bit block
+constexpr uint64_t reverse_stage_mask(int s) noexcept {
+  return s == 1 ? 0x5555555555555555ULL :
+    s == 2 ? 0x3333333333333333ULL :
+    s == 4 ? 0x0F0F0F0F0F0F0F0FULL :
+    s == 8 ? 0x00FF00FF00FF00FFULL :
+    s == 16 ? 0x0000FFFF0000FFFFULL : 0x00000000FFFFFFFFULL;
+}
+
+//Instructions needed by the swap stages for the bits of k. The stage swapping the two halves
+//of x is a rotate, each other stage is two ands, two shifts and an or.
+template <typename Integral>
+  constexpr int reverse_stages_cost(int k, int s = 1) noexcept {
+    return s >= int(sizeof(Integral) * CHAR_BIT) ? 0 :
+      (k & s ? (2 * s == int(sizeof(Integral) * CHAR_BIT) ? 1 : 5) : 0) + reverse_stages_cost<Integral>(k, 2 * s);
+  }
+
+//A byte swap is one instruction doing all of the byte stages, use it when the stages left after it are cheaper.
+//Reversing the bytes within 16 or 32 bit groups becomes a byte swap and a rotate this way (ARMv6 REV16, ARMv8 REV32).
+template <typename Integral>
+  constexpr bool reverse_bits_use_bswap(int k) noexcept {
+    return sizeof(Integral) > 1 && sizeof(Integral) <= 8 &&
+      1 + reverse_stages_cost<Integral>(k ^ (int(sizeof(Integral) * CHAR_BIT) - 8)) < reverse_stages_cost<Integral>(k);
+  }
+
+//Applies the swap stages for the bits of K from S upwards, the stages not in K are not compiled in
+template <int K, int S, typename Integral>
+  constexpr auto reverse_stages(Integral x) noexcept
+  -> typename std::enable_if<(S >= int(sizeof(Integral) * CHAR_BIT)), Integral>::type {
+    return x;
+  }
+template <int K, int S, typename Integral>
+  constexpr auto reverse_stages(Integral x) noexcept
+  -> typename std::enable_if<(S < int(sizeof(Integral) * CHAR_BIT)), Integral>::type {
+    return reverse_stages<K, 2 * S>(!(K & S) ? x :
+        2 * S == int(sizeof(Integral) * CHAR_BIT) ? rotl(x, S) :
+        Integral(shll(Integral(x & Integral(reverse_stage_mask(S))), S) | (shlr(x, S) & Integral(reverse_stage_mask(S)))));
+  }
+
+//Reverses the bytes of a 16, 32 or 64 bit x
+template <typename Integral>
+  constexpr Integral bswap(Integral x) noexcept {
+#if defined(BITOPS_BUILTIN_BSWAP)
+    return Integral(sizeof(x) == 2 ? __builtin_bswap16(uint16_t(x)) :
+        sizeof(x) == 4 ? __builtin_bswap32(uint32_t(x)) : __builtin_bswap64(uint64_t(x)));
+#else
+    return reverse_stages<int(sizeof(Integral) * CHAR_BIT) - 8, 8>(x);
+#endif
+  }
+
+//Reverses the bits of x
+template <typename Integral>
+  constexpr Integral bitreverse(Integral x) noexcept {
+#if defined(BITOPS_BUILTIN_BITREVERSE)
+    return Integral(sizeof(x) == 1 ? __builtin_bitreverse8(uint8_t(x)) :
+        sizeof(x) == 2 ? __builtin_bitreverse16(uint16_t(x)) :
+        sizeof(x) == 4 ? __builtin_bitreverse32(uint32_t(x)) : __builtin_bitreverse64(uint64_t(x)));
+#else
+    return reverse_stages<int(sizeof(Integral) * CHAR_BIT) - 1, 1>(x);
+#endif
+  }
+
+//Moves bit i of the unsigned x to bit i ^ K using the cheapest instruction sequence
+template <int K, typename Integral>
+  constexpr Integral reverse_bits_fixed(Integral x) noexcept {
+#if defined(BITOPS_BUILTIN_BITREVERSE)
+    return K == int(sizeof(Integral) * CHAR_BIT) - 1 ? bitreverse(x) :
+#else
+    return
+#endif
+      reverse_bits_use_bswap<Integral>(K) ? reverse_stages<K ^ (int(sizeof(Integral) * CHAR_BIT) - 8), 1>(bswap(x)) :
+      reverse_stages<K, 1>(x);
+  }
+
+#if defined(__SIZEOF_INT128__)
+template <int K>
+  constexpr unsigned __int128 reverse_bits_fixed(unsigned __int128 x) noexcept {
+    return K & 64 ?
+      (unsigned __int128)reverse_bits_fixed<K & 63>(uint64_t(x)) << 64 | reverse_bits_fixed<K & 63>(uint64_t(x >> 64)) :
+      (unsigned __int128)reverse_bits_fixed<K & 63>(uint64_t(x >> 64)) << 64 | reverse_bits_fixed<K & 63>(uint64_t(x));
+  }
+#endif
+
+} //namespace bitops_detail
+
+//reverse_bits with the block sizes as template arguments, only the swap stages needed are compiled in
+//and the common patterns become single instructions whether or not the call is inlined:
+//reverse_bits<8>(x): bswap, REV
+//reverse_bits<8, 2>(x): REV16
+//reverse_bits<8, 4>(x): REV32
+//reverse_bits<1>(x): bswap and the 3 stages within each byte, RBIT with clang
+//As in the runtime form, groups wider than x are clamped to the width of x and by default
+//there is one group covering all of x.
+template <int SubwordBits, int GroupSubwords = 128, typename Integral>
+  constexpr auto reverse_bits(Integral x) noexcept
+  -> typename std::enable_if<bitops_detail::is_integral<Integral>::value, Integral>::type {
+    static_assert(SubwordBits > 0 && (SubwordBits & (SubwordBits - 1)) == 0, "SubwordBits must be a power of 2");
+    static_assert(SubwordBits <= int(sizeof(Integral) * CHAR_BIT), "SubwordBits must not be wider than x");
+    static_assert(GroupSubwords > 0 && (GroupSubwords & (GroupSubwords - 1)) == 0, "GroupSubwords must be a power of 2");
+    return Integral(bitops_detail::reverse_bits_fixed<bitops_detail::reverse_bits_xor<Integral>(SubwordBits, GroupSubwords)>(
+          bitops_detail::to_unsigned(x)));
+  }
+
+//Byte reversal with the block sizes as template arguments, reverse_bytes<1>(x) is a byte swap.
+template <int BytesPerBlock, int BlocksPerGroup = 16, typename Integral>
+  constexpr auto reverse_bytes(Integral x) noexcept
+  -> typename std::enable_if<bitops_detail::is_integral<Integral>::value, Integral>::type {
+    return reverse_bits<CHAR_BIT * BytesPerBlock, BlocksPerGroup>(x);
+  }
+
 ////////////////////////////////////
 //Single bit manipulation
 ////////////////////////////////////
@@ -333,25 +788,25 @@ template <typename Integral>
 //Sets bit b in x, undefined behavior if b < 0 or b >= sizeof(x) * CHAR_BIT
 template <typename Integral>
   constexpr Integral setbit(Integral x, int b) noexcept {
-    return x | (Integral(1) << b);
+    return x | shll(Integral(1), b);
   }
 
 //Resets bit b in x, undefined behavior if b < 0 or b >= sizeof(x) * CHAR_BIT
 template <typename Integral>
   constexpr Integral rstbit(Integral x, int b) noexcept {
-    return x & ~(Integral(1) << b);
+    return x & ~shll(Integral(1), b);
   }
 
 //Flips bit b in x, undefined behavior if b < 0 or b >= sizeof(x) * CHAR_BIT
 template <typename Integral>
   constexpr Integral flipbit(Integral x, int b) noexcept {
-    return x ^ (Integral(1) << b);
+    return x ^ shll(Integral(1), b);
   }
 
 //Return whether or not bit b is set in x, undefined behavior if b < 0 or b >= sizeof(x) * CHAR_BIT
 template <typename Integral>
   constexpr bool testbit(Integral x, int b) noexcept {
-    return x & (Integral(1) << b);
+    return x & shll(Integral(1), b);
   }
 
 ////////////////////////////////////
@@ -362,37 +817,37 @@ template <typename Integral>
 //x86_64 w/ BMI2: BZHI
 template <typename Integral>
   constexpr Integral rstbitsge(Integral x, int b) noexcept {
-    return x & ((Integral(1) << b)-1);
+    return x & (bitops_detail::dec(shll(Integral(1), b)));
   }
 
 //Resets all bits < position b, nop if b > sizeof(x) * CHAR_BIT
 template <typename Integral>
   constexpr Integral rstbitsle(Integral x, int b) noexcept {
-    return x & ~((Integral(1) << (b+1))-1);
+    return x & ~(shlr(Integral(~Integral(0)), int(sizeof(x) * CHAR_BIT) - 1 - b));
   }
 
 //Set all bits >= position b, nop if b > sizeof(x) * CHAR_BIT
 template <typename Integral>
   constexpr Integral setbitsge(Integral x, int b) noexcept {
-    return x | ~((Integral(1) << b)-1);
+    return x | ~(bitops_detail::dec(shll(Integral(1), b)));
   }
 
 //Sets all bits < position b, nop if b > sizeof(x) * CHAR_BIT
 template <typename Integral>
   constexpr Integral setbitsle(Integral x, int b) noexcept {
-    return x | ((Integral(1) << (b+1))-1);
+    return x | (shlr(Integral(~Integral(0)), int(sizeof(x) * CHAR_BIT) - 1 - b));
   }
 
 //Flip all bits >= position b, nop if b > sizeof(x) * CHAR_BIT
 template <typename Integral>
   constexpr Integral flipbitsge(Integral x, int b) noexcept {
-    return x ^ ~((Integral(1) << b)-1);
+    return x ^ ~(bitops_detail::dec(shll(Integral(1), b)));
   }
 
 //Flip all bits < position b, nop if b > sizeof(x) * CHAR_BIT
 template <typename Integral>
   constexpr Integral flipbitsle(Integral x, int b) noexcept {
-    return x ^ ((Integral(1) << (b+1))-1);
+    return x ^ (shlr(Integral(~Integral(0)), int(sizeof(x) * CHAR_BIT) - 1 - b));
   }
 
 ////////////////////////////////////
@@ -412,7 +867,7 @@ template <typename Integral>
 //Application: Extending a 2d image size to a power of 2 for 3d graphics libraries (OpenGL/DirectX)
 template <typename Integral>
 constexpr14 Integral ceilp2(Integral x) noexcept {
-  x = x-1;
+  x = bitops_detail::dec(x);
   x |= shlr(x, 1);
   x |= shlr(x, 2);
   x |= shlr(x, 4);
@@ -422,11 +877,24 @@ constexpr14 Integral ceilp2(Integral x) noexcept {
       x |= shlr(x, 16);
       if(sizeof(x) > 4) {
         x |= shlr(x, 32);
+        if(sizeof(x) > 8) {
+          x |= shlr(x, 64);
+        }
       }
     }
   }
-  return x + 1;
+  return bitops_detail::inc(x);
+}
+
+#if defined(__SIZEOF_INT128__)
+//One count instead of seven double word shift steps
+inline constexpr14 unsigned __int128 ceilp2(unsigned __int128 x) noexcept {
+  return x <= 1 ? x : cntl0(x - 1) == 0 ? 0 : (unsigned __int128)1 << (128 - cntl0(x - 1));
 }
+inline constexpr14 __int128 ceilp2(__int128 x) noexcept {
+  return __int128(ceilp2((unsigned __int128)x));
+}
+#endif
 
 //Round down to the previous power of 2
 //Application: See ceilp2
@@ -441,33 +909,58 @@ constexpr14 Integral floorp2(Integral x) noexcept {
       x |= shlr(x, 16);
       if(sizeof(x) > 4) {
         x |= shlr(x, 32);
+        if(sizeof(x) > 8) {
+          x |= shlr(x, 64);
+        }
       }
     }
   }
   return x - shlr(x, 1);
 }
 
+//Returns floor(log2(x)), the index of the most significant 1 bit, or -1 if x is 0. Undefined if x < 0.
+//Application: Bucket index of a size class, number of bits needed to store x, first step of ilog10
+template <typename Integral>
+  constexpr14 int ilog2(Integral x) noexcept {
+    return int(sizeof(x) * CHAR_BIT) - 1 - cntl0(x);
+  }
+
 ////////////////////////////////////
 //Saturated Arithmetic
 ////////////////////////////////////
 
 //Perform saturated addition on l and r.
+//The result saturates to the max or min of decltype(l + r), depending on the sign of r.
 //ARMv7 DSP extensions: QADD
 template <typename IntegralL, typename IntegralR>
   constexpr auto satadd(IntegralL l, IntegralR r) noexcept -> decltype(l + r) {
     typedef decltype(l + r) LR;
-    return LR(l) > std::numeric_limits<LR>::max() - LR(r) ? std::numeric_limits<LR>::max() : l + r;
+    return LR(r) > 0 ?
+      (LR(l) > std::numeric_limits<LR>::max() - LR(r) ? std::numeric_limits<LR>::max() : LR(l) + LR(r)) :
+      (LR(l) < std::numeric_limits<LR>::min() - LR(r) ? std::numeric_limits<LR>::min() : LR(l) + LR(r));
   }
 
 //Perform saturated subtraction on l and r.
+//The result saturates to the min or max of decltype(l - r), depending on the sign of r.
 //ARMv7 DSP extensions: QSUB
 template <typename IntegralL, typename IntegralR>
   constexpr auto satsub(IntegralL l, IntegralR r) noexcept -> decltype(l - r) {
-    typedef decltype(l + r) LR;
-    return LR(l) < std::numeric_limits<LR>::min() + LR(r) ? std::numeric_limits<LR>::min() : l - r;
+    typedef decltype(l - r) LR;
+    return LR(r) > 0 ?
+      (LR(l) < std::numeric_limits<LR>::min() + LR(r) ? std::numeric_limits<LR>::min() : LR(l) - LR(r)) :
+      (LR(l) > std::numeric_limits<LR>::max() + LR(r) ? std::numeric_limits<LR>::max() : LR(l) - LR(r));
   }
 
+namespace bitops_detail {
 
+//Clamps x to the range of Integral
+template <typename Integral, typename Wide>
+  constexpr Integral saturate(Wide x) noexcept {
+    return x > Wide(std::numeric_limits<Integral>::max()) ? std::numeric_limits<Integral>::max() :
+      x < Wide(std::numeric_limits<Integral>::min()) ? std::numeric_limits<Integral>::min() : Integral(x);
+  }
+
+} //namespace bitops_detail
 
 ////////////////////////////////////
 //Pointer and size alignment helpers
@@ -478,7 +971,7 @@ template <typename Integral>
 constexpr bool is_aligned(Integral t, size_t a) noexcept {
   return ((t & (a-1)) == 0);
 }
-bool is_aligned(void* t, size_t a) noexcept {
+inline bool is_aligned(void* t, size_t a) noexcept {
   return is_aligned(uintptr_t(t), a);
 }
 
@@ -487,7 +980,7 @@ template <typename Integral>
 constexpr Integral align_up(Integral val, size_t a) noexcept {
   return ((val + (a -1)) & -a);
 }
-void* align_up(void* val, size_t a) noexcept {
+inline void* align_up(void* val, size_t a) noexcept {
   return (void*)align_up(uintptr_t(val), a);
 }
 
@@ -496,7 +989,7 @@ template <typename Integral>
 constexpr Integral align_down(Integral val, size_t a) noexcept {
   return val & -a;
 }
-void* align_down(void* val, size_t a) noexcept {
+inline void* align_down(void* val, size_t a) noexcept {
   return (void*)align_down(uintptr_t(val), a);
 }
 
@@ -563,21 +1056,96 @@ constexpr14 Integral inner_punshuffle(Integral x) noexcept {
 //Bits Deposit and Extract
 ///////////////////////////////////
 
+namespace bitops_detail {
+
+//Number of power of 2 steps needed to move a bit across an Integral
+template <typename Integral>
+  constexpr int log2_nbits() noexcept {
+    return sizeof(Integral) == 1 ? 3 : sizeof(Integral) == 2 ? 4 : sizeof(Integral) == 4 ? 5 : 6;
+  }
+
+//Computes mv[i], the bits of mask which move right by 2^i places when the bits of mask are compressed.
+//The same masks drive both compress and expand.
+//Hacker's Delight 7-4
+template <typename Integral>
+  constexpr14 void compress_masks(Integral mask, Integral* mv) noexcept {
+    constexpr int nbits = int(sizeof(mask) * CHAR_BIT);
+    //Count the 0's to the right of each bit
+    Integral mk = shll(Integral(~mask), 1);
+    for(int i = 0; i < log2_nbits<Integral>(); ++i) {
+      //Parallel suffix of mk
+      Integral mp = mk;
+      for(int s = 1; s < nbits; s += s) { mp = mp ^ shll(mp, s); }
+      mv[i] = mp & mask;
+      mask = (mask ^ mv[i]) | shlr(mv[i], 1 << i);
+      mk = mk & Integral(~mp);
+    }
+  }
+
+//Parallel bits extract using precomputed move masks, the cost does not depend on the mask.
+template <typename Integral>
+  constexpr14 Integral compress(Integral x, Integral mask, const Integral* mv) noexcept {
+    x = x & mask;
+    for(int i = 0; i < log2_nbits<Integral>(); ++i) {
+      Integral t = x & mv[i];
+      x = (x ^ t) | shlr(t, 1 << i);
+    }
+    return x;
+  }
+
+//Parallel bits deposit using precomputed move masks, the cost does not depend on the mask.
+//Hacker's Delight 7-5
+template <typename Integral>
+  constexpr14 Integral expand(Integral x, Integral mask, const Integral* mv) noexcept {
+    for(int i = log2_nbits<Integral>() - 1; i >= 0; --i) {
+      x = (x & Integral(~mv[i])) | (shll(x, 1 << i) & mv[i]);
+    }
+    return x & mask;
+  }
+
+template <typename Integral>
+  constexpr14 Integral deposit_bits_portable(Integral x, Integral mask) noexcept {
+    typedef typename bitops_detail::make_unsigned<Integral>::type U;
+    U mv[log2_nbits<Integral>()] = {};
+    compress_masks(U(mask), mv);
+    return Integral(expand(U(x), U(mask), mv));
+  }
+
+template <typename Integral>
+  constexpr14 Integral extract_bits_portable(Integral x, Integral mask) noexcept {
+    typedef typename bitops_detail::make_unsigned<Integral>::type U;
+    U mv[log2_nbits<Integral>()] = {};
+    compress_masks(U(mask), mv);
+    return Integral(compress(U(x), U(mask), mv));
+  }
+
+#if defined(BITOPS_PDEP) || defined(BITOPS_RUNTIME_DISPATCH)
+template <typename Integral>
+  BITOPS_TARGET("bmi2") inline Integral deposit_bits_pdep(Integral x, Integral mask) noexcept {
+    return sizeof(x) <= 4 ? Integral(_pdep_u32(unsigned(to_unsigned(x)), unsigned(to_unsigned(mask))))
+      : Integral(_pdep_u64(uint64_t(to_unsigned(x)), uint64_t(to_unsigned(mask))));
+  }
+
+template <typename Integral>
+  BITOPS_TARGET("bmi2") inline Integral extract_bits_pext(Integral x, Integral mask) noexcept {
+    return sizeof(x) <= 4 ? Integral(_pext_u32(unsigned(to_unsigned(x)), unsigned(to_unsigned(mask))))
+      : Integral(_pext_u64(uint64_t(to_unsigned(x)), uint64_t(to_unsigned(mask))));
+  }
+#endif
+
+} //namespace bitops_detail
+
 //Parallel Bits Deposit
 //x    HGFEDCBA
 //mask 01100100
 //res  0CB00A00
 //x86_64 BMI2: PDEP
 template <typename Integral>
-constexpr14 Integral deposit_bits(Integral x, Integral mask) {
-  Integral res = 0;
-  for(Integral bb = 1; mask != 0; bb += bb) {
-    if(x & bb) {
-      res |= mask & (-mask);
-    }
-    mask &= (mask - 1);
-  }
-  return res;
+constexpr14 Integral deposit_bits(Integral x, Integral mask) noexcept {
+#if defined(BITOPS_PDEP)
+  if(!BITOPS_CONSTANT_EVALUATED()) { return bitops_detail::deposit_bits_pdep(x, mask); }
+#endif
+  return bitops_detail::deposit_bits_portable(x, mask);
 }
 
 //Parallel Bits Extract
@@ -586,17 +1154,1659 @@ constexpr14 Integral deposit_bits(Integral x, Integral mask) {
 //res  00000GFC
 //x86_64 BMI2: PEXT
 template <typename Integral>
-constexpr14 Integral extract_bits(Integral x, Integral mask) {
-  Integral res = 0;
-  for(Integral bb = 1; mask != 0; bb += bb) {
-    if(x & mask & -mask) {
-      res |= bb;
+constexpr14 Integral extract_bits(Integral x, Integral mask) noexcept {
+#if defined(BITOPS_PDEP)
+  if(!BITOPS_CONSTANT_EVALUATED()) { return bitops_detail::extract_bits_pext(x, mask); }
+#endif
+  return bitops_detail::extract_bits_portable(x, mask);
+}
+
+//A mask for deposit_bits and extract_bits with its bit movements precomputed.
+//Without PDEP and PEXT, analyzing the mask is most of the work, so use this when
+//the same mask is applied to many values.
+template <typename Integral>
+class bits_mask {
+  public:
+    typedef Integral value_type;
+
+    constexpr14 explicit bits_mask(Integral mask) noexcept : _mask(mask), _mv() {
+#if defined(BITOPS_PDEP)
+      if(!BITOPS_CONSTANT_EVALUATED()) { return; }
+#endif
+      bitops_detail::compress_masks(U(mask), _mv);
+    }
+
+    constexpr Integral mask() const noexcept { return _mask; }
+
+    constexpr14 Integral deposit(Integral x) const noexcept {
+#if defined(BITOPS_PDEP)
+      if(!BITOPS_CONSTANT_EVALUATED()) { return bitops_detail::deposit_bits_pdep(x, _mask); }
+#endif
+      return Integral(bitops_detail::expand(U(x), U(_mask), _mv));
+    }
+
+    constexpr14 Integral extract(Integral x) const noexcept {
+#if defined(BITOPS_PDEP)
+      if(!BITOPS_CONSTANT_EVALUATED()) { return bitops_detail::extract_bits_pext(x, _mask); }
+#endif
+      return Integral(bitops_detail::compress(U(x), U(_mask), _mv));
+    }
+
+  private:
+    typedef typename bitops_detail::make_unsigned<Integral>::type U;
+
+    Integral _mask;
+    U _mv[bitops_detail::log2_nbits<Integral>()];
+};
+
+template <typename Integral>
+constexpr14 Integral deposit_bits(Integral x, const bits_mask<Integral>& mask) noexcept {
+  return mask.deposit(x);
+}
+
+template <typename Integral>
+constexpr14 Integral extract_bits(Integral x, const bits_mask<Integral>& mask) noexcept {
+  return mask.extract(x);
+}
+
+//deposit_bits which checks the cpu at runtime, for binaries which must run well on cpus
+//both with and without a fast PDEP instruction.
+template <typename Integral>
+Integral deposit_bits_runtime(Integral x, Integral mask) noexcept {
+#if defined(BITOPS_PDEP) || defined(BITOPS_RUNTIME_DISPATCH)
+  if(bitops_detail::has_fast_pdep()) { return bitops_detail::deposit_bits_pdep(x, mask); }
+#endif
+  return bitops_detail::deposit_bits_portable(x, mask);
+}
+
+//extract_bits which checks the cpu at runtime, for binaries which must run well on cpus
+//both with and without a fast PEXT instruction.
+template <typename Integral>
+Integral extract_bits_runtime(Integral x, Integral mask) noexcept {
+#if defined(BITOPS_PDEP) || defined(BITOPS_RUNTIME_DISPATCH)
+  if(bitops_detail::has_fast_pdep()) { return bitops_detail::extract_bits_pext(x, mask); }
+#endif
+  return bitops_detail::extract_bits_portable(x, mask);
+}
+
+///////////////////////////////////
+//Array operations
+///////////////////////////////////
+
+//These apply the functions above to every element of an array. Arrays may have any
+//alignment; the unaligned head and tail are handled with the scalar functions and the
+//aligned body with vector kernels selected at runtime (see BITOPS_RUNTIME_DISPATCH).
+
+namespace bitops_detail {
+
+inline size_t popcount_scalar(const unsigned char* p, size_t n) noexcept {
+  size_t c = 0;
+  for(; n >= sizeof(uint64_t); p += sizeof(uint64_t), n -= sizeof(uint64_t)) {
+    uint64_t w;
+    std::memcpy(&w, p, sizeof(w));
+    c += popcount(w);
+  }
+  for(; n > 0; ++p, --n) {
+    c += popcount(*p);
+  }
+  return c;
+}
+
+#if defined(BITOPS_RUNTIME_DISPATCH)
+//Per 64 bit lane popcount using a nibble lookup table
+BITOPS_TARGET("avx2") inline __m256i popcount_epi64_avx2(__m256i v) noexcept {
+  const __m256i lookup = _mm256_setr_epi8(
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low = _mm256_set1_epi8(0x0F);
+  __m256i lo = _mm256_and_si256(v, low);
+  __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+  __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+  return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+}
+
+//Carry save adder: h:l = a + b + c
+BITOPS_TARGET("avx2") inline void csa_avx2(__m256i& h, __m256i& l, __m256i a, __m256i b, __m256i c) noexcept {
+  __m256i u = _mm256_xor_si256(a, b);
+  h = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(u, c));
+  l = _mm256_xor_si256(u, c);
+}
+
+//Harley-Seal popcount of nvec 32 byte aligned vectors
+//Mula, Kurz, Lemire: Faster Population Counts Using AVX2 Instructions
+BITOPS_TARGET("avx2") inline size_t popcount_avx2(const unsigned char* p, size_t nvec) noexcept {
+  const __m256i* v = reinterpret_cast<const __m256i*>(p);
+  __m256i total = _mm256_setzero_si256();
+  __m256i ones = _mm256_setzero_si256();
+  __m256i twos = _mm256_setzero_si256();
+  __m256i fours = _mm256_setzero_si256();
+  __m256i eights = _mm256_setzero_si256();
+  __m256i sixteens, twosA, twosB, foursA, foursB, eightsA, eightsB;
+  size_t i = 0;
+  for(; i + 16 <= nvec; i += 16) {
+    csa_avx2(twosA, ones, ones, _mm256_load_si256(v + i), _mm256_load_si256(v + i + 1));
+    csa_avx2(twosB, ones, ones, _mm256_load_si256(v + i + 2), _mm256_load_si256(v + i + 3));
+    csa_avx2(foursA, twos, twos, twosA, twosB);
+    csa_avx2(twosA, ones, ones, _mm256_load_si256(v + i + 4), _mm256_load_si256(v + i + 5));
+    csa_avx2(twosB, ones, ones, _mm256_load_si256(v + i + 6), _mm256_load_si256(v + i + 7));
+    csa_avx2(foursB, twos, twos, twosA, twosB);
+    csa_avx2(eightsA, fours, fours, foursA, foursB);
+    csa_avx2(twosA, ones, ones, _mm256_load_si256(v + i + 8), _mm256_load_si256(v + i + 9));
+    csa_avx2(twosB, ones, ones, _mm256_load_si256(v + i + 10), _mm256_load_si256(v + i + 11));
+    csa_avx2(foursA, twos, twos, twosA, twosB);
+    csa_avx2(twosA, ones, ones, _mm256_load_si256(v + i + 12), _mm256_load_si256(v + i + 13));
+    csa_avx2(twosB, ones, ones, _mm256_load_si256(v + i + 14), _mm256_load_si256(v + i + 15));
+    csa_avx2(foursB, twos, twos, twosA, twosB);
+    csa_avx2(eightsB, fours, fours, foursA, foursB);
+    csa_avx2(sixteens, eights, eights, eightsA, eightsB);
+    total = _mm256_add_epi64(total, popcount_epi64_avx2(sixteens));
+  }
+  total = _mm256_slli_epi64(total, 4);
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_epi64_avx2(eights), 3));
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_epi64_avx2(fours), 2));
+  total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount_epi64_avx2(twos), 1));
+  total = _mm256_add_epi64(total, popcount_epi64_avx2(ones));
+  for(; i < nvec; ++i) {
+    total = _mm256_add_epi64(total, popcount_epi64_avx2(_mm256_load_si256(v + i)));
+  }
+  return size_t(_mm256_extract_epi64(total, 0)) + size_t(_mm256_extract_epi64(total, 1))
+    + size_t(_mm256_extract_epi64(total, 2)) + size_t(_mm256_extract_epi64(total, 3));
+}
+
+//Popcount of nvec 64 byte aligned vectors with VPOPCNTQ
+BITOPS_TARGET("avx512f,avx512vpopcntdq") inline size_t popcount_avx512(const unsigned char* p, size_t nvec) noexcept {
+  const __m512i* v = reinterpret_cast<const __m512i*>(p);
+  //Independent accumulators to hide the latency of VPOPCNTQ
+  __m512i a0 = _mm512_setzero_si512();
+  __m512i a1 = _mm512_setzero_si512();
+  __m512i a2 = _mm512_setzero_si512();
+  __m512i a3 = _mm512_setzero_si512();
+  size_t i = 0;
+  for(; i + 4 <= nvec; i += 4) {
+    a0 = _mm512_add_epi64(a0, _mm512_popcnt_epi64(_mm512_load_si512(v + i)));
+    a1 = _mm512_add_epi64(a1, _mm512_popcnt_epi64(_mm512_load_si512(v + i + 1)));
+    a2 = _mm512_add_epi64(a2, _mm512_popcnt_epi64(_mm512_load_si512(v + i + 2)));
+    a3 = _mm512_add_epi64(a3, _mm512_popcnt_epi64(_mm512_load_si512(v + i + 3)));
+  }
+  for(; i < nvec; ++i) {
+    a0 = _mm512_add_epi64(a0, _mm512_popcnt_epi64(_mm512_load_si512(v + i)));
+  }
+  a0 = _mm512_add_epi64(_mm512_add_epi64(a0, a1), _mm512_add_epi64(a2, a3));
+  alignas(64) uint64_t lanes[8];
+  _mm512_store_si512(lanes, a0);
+  size_t c = 0;
+  for(uint64_t l : lanes) { c += l; }
+  return c;
+}
+#endif
+
+inline size_t popcount_bytes(const unsigned char* p, size_t n) noexcept {
+#if defined(BITOPS_RUNTIME_DISPATCH)
+  size_t vsz = has_avx512vpopcntdq() ? 64 : has_avx2() ? 32 : 0;
+  if(vsz != 0 && n >= 2 * vsz) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(align_up(uintptr_t(p), vsz));
+    const unsigned char* e = reinterpret_cast<const unsigned char*>(align_down(uintptr_t(p + n), vsz));
+    size_t c = popcount_scalar(p, size_t(b - p)) + popcount_scalar(e, size_t(p + n - e));
+    if(vsz == 64) {
+      return c + popcount_avx512(b, size_t(e - b) / 64);
+    }
+    return c + popcount_avx2(b, size_t(e - b) / 32);
+  }
+#endif
+  return popcount_scalar(p, n);
+}
+
+} //namespace bitops_detail
+
+//Returns the number of 1 bits in the n integers starting at p.
+//x86_64 AVX512_VPOPCNTDQ: vpopcntq
+//x86_64 AVX2: Harley-Seal carry save adders with a vpshufb nibble lookup
+//Application: bitmap cardinality
+template <typename Integral>
+  auto popcount(const Integral* p, size_t n) noexcept
+  -> typename std::enable_if<std::is_integral<Integral>::value, size_t>::type {
+    return bitops_detail::popcount_bytes(reinterpret_cast<const unsigned char*>(p), n * sizeof(Integral));
+  }
+
+namespace bitops_detail {
+
+inline bool has_ssse3() noexcept {
+#if defined(__SSSE3__)
+  return true;
+#else
+  return cpu().ssse3;
+#endif
+}
+
+//Computes the byte shuffle which reverse_bytes(x, bytes_per_block, blocks_per_group)
+//applies to each Integral in a 16 byte vector. ctl[i] is the source byte of byte i.
+template <typename Integral>
+  inline void reverse_bytes_control(unsigned char* ctl, int bytes_per_block, int blocks_per_group) noexcept {
+    unsigned char idx[sizeof(Integral)];
+    for(size_t i = 0; i < sizeof(Integral); ++i) { idx[i] = (unsigned char)i; }
+    Integral x;
+    std::memcpy(&x, idx, sizeof(x));
+    x = reverse_bytes(x, bytes_per_block, blocks_per_group);
+    std::memcpy(idx, &x, sizeof(x));
+    for(size_t i = 0; i < 16; ++i) { ctl[i] = (unsigned char)(i - i % sizeof(Integral) + idx[i % sizeof(Integral)]); }
+  }
+
+#if defined(BITOPS_RUNTIME_DISPATCH)
+//Shuffles the bytes of each 16 byte vector with ctl. Returns the number of bytes processed.
+BITOPS_TARGET("ssse3") inline size_t shuffle_bytes_ssse3(const unsigned char* src, unsigned char* dst, size_t n, const unsigned char* ctl) noexcept {
+  const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctl));
+  size_t i = 0;
+  for(; i + 16 <= n; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_shuffle_epi8(v, c));
+  }
+  return i;
+}
+
+BITOPS_TARGET("avx2") inline size_t shuffle_bytes_avx2(const unsigned char* src, unsigned char* dst, size_t n, const unsigned char* ctl) noexcept {
+  const __m256i c = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctl)));
+  size_t i = 0;
+  for(; i + 64 <= n; i += 64) {
+    __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 32));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_shuffle_epi8(v0, c));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 32), _mm256_shuffle_epi8(v1, c));
+  }
+  for(; i + 32 <= n; i += 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_shuffle_epi8(v, c));
+  }
+  return i;
+}
+#endif
+
+} //namespace bitops_detail
+
+//Stores reverse_bytes(src[i], bytes_per_block, blocks_per_group) to dst[i] for each of the n integers at src.
+//src and dst may be the same array but must not otherwise overlap.
+//x86_64 SSSE3: pshufb
+//x86_64 AVX2: vpshufb
+//Application: Converting arrays between big and little endian
+template <typename Integral>
+  auto reverse_bytes(const Integral* src, Integral* dst, size_t n,
+      int bytes_per_block = 1,
+      int blocks_per_group = sizeof(Integral))
+  noexcept -> typename std::enable_if<std::is_integral<Integral>::value>::type {
+    size_t i = 0;
+#if defined(BITOPS_RUNTIME_DISPATCH)
+    size_t nbytes = n * sizeof(Integral);
+    if(sizeof(Integral) > 1 && nbytes >= 16 && bitops_detail::has_ssse3()) {
+      unsigned char ctl[16];
+      bitops_detail::reverse_bytes_control<Integral>(ctl, bytes_per_block, blocks_per_group);
+      const unsigned char* s = reinterpret_cast<const unsigned char*>(src);
+      unsigned char* d = reinterpret_cast<unsigned char*>(dst);
+      if(bitops_detail::has_avx2()) {
+        i = bitops_detail::shuffle_bytes_avx2(s, d, nbytes, ctl);
+      }
+      i += bitops_detail::shuffle_bytes_ssse3(s + i, d + i, nbytes - i, ctl);
+      i /= sizeof(Integral);
+    }
+#endif
+    //Unaligned tail, or the whole array without a vector byte shuffle (ARM REV, etc..)
+    for(; i < n; ++i) {
+      dst[i] = reverse_bytes(src[i], bytes_per_block, blocks_per_group);
+    }
+  }
+
+//In place version of reverse_bytes for arrays.
+template <typename Integral>
+  auto reverse_bytes(Integral* p, size_t n,
+      int bytes_per_block = 1,
+      int blocks_per_group = sizeof(Integral))
+  noexcept -> typename std::enable_if<std::is_integral<Integral>::value>::type {
+    reverse_bytes(static_cast<const Integral*>(p), p, n, bytes_per_block, blocks_per_group);
+  }
+
+namespace bitops_detail {
+
+//reverse_bits splits into a byte permutation and a permutation of the bits within each byte.
+//Computes the byte shuffle for a 16 byte vector of Integral in ctl, and the 16 entry tables
+//giving the permuted bits of the low and high nibble of a byte in lut_lo and lut_hi.
+template <typename Integral>
+  inline void reverse_bits_control(unsigned char* ctl, unsigned char* lut_lo, unsigned char* lut_hi,
+      int subword_bits, int group_subwords) noexcept {
+    int k = reverse_bits_xor<Integral>(subword_bits, group_subwords);
+    for(int i = 0; i < 16; ++i) {
+      ctl[i] = (unsigned char)(i ^ (k >> 3));
+      unsigned lo = 0, hi = 0;
+      for(int b = 0; b < 4; ++b) {
+        if(testbit(i, b)) {
+          lo = setbit(lo, b ^ (k & 7));
+          hi = setbit(hi, (b + 4) ^ (k & 7));
+        }
+      }
+      lut_lo[i] = (unsigned char)lo;
+      lut_hi[i] = (unsigned char)hi;
+    }
+  }
+
+#if defined(BITOPS_RUNTIME_DISPATCH)
+//Shuffles the bytes of each 16 byte vector with ctl, and then maps each nibble through lut_lo and lut_hi.
+//Returns the number of bytes processed.
+BITOPS_TARGET("ssse3") inline size_t shuffle_bits_ssse3(const unsigned char* src, unsigned char* dst, size_t n,
+    const unsigned char* ctl, const unsigned char* lut_lo, const unsigned char* lut_hi) noexcept {
+  const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctl));
+  const __m128i tlo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lut_lo));
+  const __m128i thi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lut_hi));
+  const __m128i low = _mm_set1_epi8(0x0F);
+  size_t i = 0;
+  for(; i + 16 <= n; i += 16) {
+    __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), c);
+    __m128i lo = _mm_shuffle_epi8(tlo, _mm_and_si128(v, low));
+    __m128i hi = _mm_shuffle_epi8(thi, _mm_and_si128(_mm_srli_epi16(v, 4), low));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(lo, hi));
+  }
+  return i;
+}
+
+BITOPS_TARGET("avx2") inline size_t shuffle_bits_avx2(const unsigned char* src, unsigned char* dst, size_t n,
+    const unsigned char* ctl, const unsigned char* lut_lo, const unsigned char* lut_hi) noexcept {
+  const __m256i c = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctl)));
+  const __m256i tlo = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lut_lo)));
+  const __m256i thi = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lut_hi)));
+  const __m256i low = _mm256_set1_epi8(0x0F);
+  size_t i = 0;
+  for(; i + 32 <= n; i += 32) {
+    __m256i v = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)), c);
+    __m256i lo = _mm256_shuffle_epi8(tlo, _mm256_and_si256(v, low));
+    __m256i hi = _mm256_shuffle_epi8(thi, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_or_si256(lo, hi));
+  }
+  return i;
+}
+#endif
+
+} //namespace bitops_detail
+
+//Stores reverse_bits(src[i], subword_bits, group_subwords) to dst[i] for each of the n integers at src.
+//src and dst may be the same array but must not otherwise overlap.
+//x86_64 SSSE3: pshufb byte shuffle and nibble lookup table
+//x86_64 AVX2: vpshufb byte shuffle and nibble lookup table
+//Application: FFT bit reversal, serial protocols which send the least significant bit first
+template <typename Integral>
+  auto reverse_bits(const Integral* src, Integral* dst, size_t n,
+      int subword_bits = 1,
+      int group_subwords = int(sizeof(Integral) * CHAR_BIT))
+  noexcept -> typename std::enable_if<std::is_integral<Integral>::value>::type {
+    size_t i = 0;
+#if defined(BITOPS_RUNTIME_DISPATCH)
+    size_t nbytes = n * sizeof(Integral);
+    if(nbytes >= 16 && bitops_detail::has_ssse3()) {
+      unsigned char ctl[16], lut_lo[16], lut_hi[16];
+      bitops_detail::reverse_bits_control<Integral>(ctl, lut_lo, lut_hi, subword_bits, group_subwords);
+      const unsigned char* s = reinterpret_cast<const unsigned char*>(src);
+      unsigned char* d = reinterpret_cast<unsigned char*>(dst);
+      if(bitops_detail::has_avx2()) {
+        i = bitops_detail::shuffle_bits_avx2(s, d, nbytes, ctl, lut_lo, lut_hi);
+      }
+      i += bitops_detail::shuffle_bits_ssse3(s + i, d + i, nbytes - i, ctl, lut_lo, lut_hi);
+      i /= sizeof(Integral);
+    }
+#endif
+    for(; i < n; ++i) {
+      dst[i] = reverse_bits(src[i], subword_bits, group_subwords);
+    }
+  }
+
+//In place version of reverse_bits for arrays.
+template <typename Integral>
+  auto reverse_bits(Integral* p, size_t n,
+      int subword_bits = 1,
+      int group_subwords = int(sizeof(Integral) * CHAR_BIT))
+  noexcept -> typename std::enable_if<std::is_integral<Integral>::value>::type {
+    reverse_bits(static_cast<const Integral*>(p), p, n, subword_bits, group_subwords);
+  }
+
+namespace bitops_detail {
+
+//Vector saturated arithmetic for the types with native instructions.
+template <typename Integral>
+  struct satarith_simd : std::false_type {};
+
+#if defined(BITOPS_RUNTIME_DISPATCH)
+template <>
+  struct satarith_simd<int8_t> : std::true_type {
+    static __m128i add(__m128i a, __m128i b) noexcept { return _mm_adds_epi8(a, b); }
+    static __m128i sub(__m128i a, __m128i b) noexcept { return _mm_subs_epi8(a, b); }
+    BITOPS_TARGET("avx2") static __m256i add(__m256i a, __m256i b) noexcept { return _mm256_adds_epi8(a, b); }
+    BITOPS_TARGET("avx2") static __m256i sub(__m256i a, __m256i b) noexcept { return _mm256_subs_epi8(a, b); }
+  };
+
+template <>
+  struct satarith_simd<uint8_t> : std::true_type {
+    static __m128i add(__m128i a, __m128i b) noexcept { return _mm_adds_epu8(a, b); }
+    static __m128i sub(__m128i a, __m128i b) noexcept { return _mm_subs_epu8(a, b); }
+    BITOPS_TARGET("avx2") static __m256i add(__m256i a, __m256i b) noexcept { return _mm256_adds_epu8(a, b); }
+    BITOPS_TARGET("avx2") static __m256i sub(__m256i a, __m256i b) noexcept { return _mm256_subs_epu8(a, b); }
+  };
+
+template <>
+  struct satarith_simd<int16_t> : std::true_type {
+    static __m128i add(__m128i a, __m128i b) noexcept { return _mm_adds_epi16(a, b); }
+    static __m128i sub(__m128i a, __m128i b) noexcept { return _mm_subs_epi16(a, b); }
+    BITOPS_TARGET("avx2") static __m256i add(__m256i a, __m256i b) noexcept { return _mm256_adds_epi16(a, b); }
+    BITOPS_TARGET("avx2") static __m256i sub(__m256i a, __m256i b) noexcept { return _mm256_subs_epi16(a, b); }
+  };
+
+template <>
+  struct satarith_simd<uint16_t> : std::true_type {
+    static __m128i add(__m128i a, __m128i b) noexcept { return _mm_adds_epu16(a, b); }
+    static __m128i sub(__m128i a, __m128i b) noexcept { return _mm_subs_epu16(a, b); }
+    BITOPS_TARGET("avx2") static __m256i add(__m256i a, __m256i b) noexcept { return _mm256_adds_epu16(a, b); }
+    BITOPS_TARGET("avx2") static __m256i sub(__m256i a, __m256i b) noexcept { return _mm256_subs_epu16(a, b); }
+  };
+
+//dst[i] = a[i] +/- b[i] for as many whole vectors as fit in n. Returns the number of elements processed.
+template <bool Sub, typename Integral>
+  BITOPS_TARGET("avx2") inline size_t satarith_avx2(const Integral* a, const Integral* b, Integral* dst, size_t n) noexcept {
+    typedef satarith_simd<Integral> ops;
+    constexpr size_t w = sizeof(__m256i) / sizeof(Integral);
+    size_t i = 0;
+    for(; i + w <= n; i += w) {
+      __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), Sub ? ops::sub(va, vb) : ops::add(va, vb));
+    }
+    return i;
+  }
+
+template <bool Sub, typename Integral>
+  inline size_t satarith_sse2(const Integral* a, const Integral* b, Integral* dst, size_t n) noexcept {
+    typedef satarith_simd<Integral> ops;
+    constexpr size_t w = sizeof(__m128i) / sizeof(Integral);
+    size_t i = 0;
+    for(; i + w <= n; i += w) {
+      __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+      __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), Sub ? ops::sub(va, vb) : ops::add(va, vb));
+    }
+    return i;
+  }
+
+//Saturated sum of the nsrc streams at src for as many whole vectors as fit in n.
+//Each vector of dst is accumulated in a register, so memory is only read once.
+template <typename Integral>
+  BITOPS_TARGET("avx2") inline size_t satsum_avx2(const Integral* const* src, size_t nsrc, Integral* dst, size_t n) noexcept {
+    typedef satarith_simd<Integral> ops;
+    constexpr size_t w = sizeof(__m256i) / sizeof(Integral);
+    size_t i = 0;
+    for(; i + 2 * w <= n; i += 2 * w) {
+      __m256i acc0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src[0] + i));
+      __m256i acc1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src[0] + i + w));
+      for(size_t k = 1; k < nsrc; ++k) {
+        acc0 = ops::add(acc0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src[k] + i)));
+        acc1 = ops::add(acc1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src[k] + i + w)));
+      }
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), acc0);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + w), acc1);
+    }
+    return i;
+  }
+
+template <typename Integral>
+  inline size_t satsum_sse2(const Integral* const* src, size_t nsrc, Integral* dst, size_t n) noexcept {
+    typedef satarith_simd<Integral> ops;
+    constexpr size_t w = sizeof(__m128i) / sizeof(Integral);
+    size_t i = 0;
+    for(; i + w <= n; i += w) {
+      __m128i acc = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src[0] + i));
+      for(size_t k = 1; k < nsrc; ++k) {
+        acc = ops::add(acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(src[k] + i)));
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), acc);
+    }
+    return i;
+  }
+
+template <bool Sub, typename Integral>
+  inline size_t satarith_vec(const Integral* a, const Integral* b, Integral* dst, size_t n, std::true_type) noexcept {
+    size_t i = has_avx2() ? satarith_avx2<Sub>(a, b, dst, n) : 0;
+    return i + satarith_sse2<Sub>(a + i, b + i, dst + i, n - i);
+  }
+
+template <typename Integral>
+  inline size_t satsum_vec(const Integral* const* src, size_t nsrc, Integral* dst, size_t n, std::true_type) noexcept {
+    return has_avx2() ? satsum_avx2(src, nsrc, dst, n) : satsum_sse2(src, nsrc, dst, n);
+  }
+#endif
+
+template <bool Sub, typename Integral>
+  inline size_t satarith_vec(const Integral*, const Integral*, Integral*, size_t, std::false_type) noexcept {
+    return 0;
+  }
+
+template <typename Integral>
+  inline size_t satsum_vec(const Integral* const*, size_t, Integral*, size_t, std::false_type) noexcept {
+    return 0;
+  }
+
+} //namespace bitops_detail
+
+//Stores a[i] + b[i], saturated to the range of Integral, to dst[i] for each of the n integers at a and b.
+//dst may be a or b.
+//x86_64 SSE2: paddsb, paddsw, paddusb, paddusw
+//x86_64 AVX2: vpaddsb, vpaddsw, vpaddusb, vpaddusw
+//ARMv7 NEON: VQADD
+//Application: audio mixing, image processing
+template <typename Integral>
+  auto satadd(const Integral* a, const Integral* b, Integral* dst, size_t n) noexcept
+  -> typename std::enable_if<std::is_integral<Integral>::value>::type {
+    size_t i = bitops_detail::satarith_vec<false>(a, b, dst, n, bitops_detail::satarith_simd<Integral>());
+    //Counting the remainder, gcc can not tell that i <= n and warns of an overflowing i with -march=native
+    for(size_t k = 0, r = n - i; k < r; ++k) {
+      dst[i + k] = bitops_detail::saturate<Integral>(satadd(a[i + k], b[i + k]));
+    }
+  }
+
+//Stores a[i] - b[i], saturated to the range of Integral, to dst[i] for each of the n integers at a and b.
+//dst may be a or b.
+//x86_64 SSE2: psubsb, psubsw, psubusb, psubusw
+//x86_64 AVX2: vpsubsb, vpsubsw, vpsubusb, vpsubusw
+//ARMv7 NEON: VQSUB
+template <typename Integral>
+  auto satsub(const Integral* a, const Integral* b, Integral* dst, size_t n) noexcept
+  -> typename std::enable_if<std::is_integral<Integral>::value>::type {
+    size_t i = bitops_detail::satarith_vec<true>(a, b, dst, n, bitops_detail::satarith_simd<Integral>());
+    //Counting the remainder, gcc can not tell that i <= n and warns of an overflowing i with -march=native
+    for(size_t k = 0, r = n - i; k < r; ++k) {
+      dst[i + k] = bitops_detail::saturate<Integral>(satsub(a[i + k], b[i + k]));
+    }
+  }
+
+//Accumulates the nsrc arrays of n integers at src[0], src[1], .. with saturated addition and stores the result to dst.
+//The result is the same as repeatedly calling satadd(dst, src[k], dst, n), but each array is read in a single pass.
+//dst may be one of the sources. If nsrc is 0, dst is filled with 0.
+//Application: mixing many audio channels
+template <typename Integral>
+  auto satadd(const Integral* const* src, size_t nsrc, Integral* dst, size_t n) noexcept
+  -> typename std::enable_if<std::is_integral<Integral>::value>::type {
+    if(nsrc == 0) {
+      std::fill(dst, dst + n, Integral(0));
+      return;
+    }
+    size_t i = bitops_detail::satsum_vec(src, nsrc, dst, n, bitops_detail::satarith_simd<Integral>());
+    for(; i < n; ++i) {
+      Integral acc = src[0][i];
+      for(size_t k = 1; k < nsrc; ++k) {
+        acc = bitops_detail::saturate<Integral>(satadd(acc, src[k][i]));
+      }
+      dst[i] = acc;
+    }
+  }
+
+///////////////////////////////////
+//Bit position iteration
+///////////////////////////////////
+
+//Iterates over the positions of the 1 bits of an integer, from least to most significant.
+//Each step is a cntt0 and rstls1b with no per bit branching.
+template <typename Integral>
+class bit_positions_iterator {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef int value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const int* pointer;
+    typedef int reference;
+
+    constexpr bit_positions_iterator() noexcept : _x(0) {}
+    constexpr explicit bit_positions_iterator(Integral x) noexcept : _x(U(x)) {}
+
+    constexpr14 int operator*() const noexcept { return cntt0(_x); }
+    constexpr14 bit_positions_iterator& operator++() noexcept { _x = rstls1b(_x); return *this; }
+    constexpr14 bit_positions_iterator operator++(int) noexcept { bit_positions_iterator t = *this; ++*this; return t; }
+
+    constexpr bool operator==(const bit_positions_iterator& o) const noexcept { return _x == o._x; }
+    constexpr bool operator!=(const bit_positions_iterator& o) const noexcept { return _x != o._x; }
+
+  private:
+    typedef typename bitops_detail::make_unsigned<Integral>::type U;
+    U _x;
+};
+
+template <typename Integral>
+class bit_positions_range {
+  public:
+    typedef bit_positions_iterator<Integral> iterator;
+
+    constexpr explicit bit_positions_range(Integral x) noexcept : _x(x) {}
+
+    constexpr iterator begin() const noexcept { return iterator(_x); }
+    constexpr iterator end() const noexcept { return iterator(); }
+    constexpr14 size_t size() const noexcept { return size_t(popcount(_x)); }
+    constexpr bool empty() const noexcept { return _x == 0; }
+
+  private:
+    Integral _x;
+};
+
+//Returns a range over the positions of the 1 bits of x
+//for(int i : bit_positions(x)) is the same as for(; x != 0; x = rstls1b(x)) { int i = cntt0(x); }
+//Application: sparse bitmap iteration, move generation in bitboard chess engines
+template <typename Integral>
+  constexpr bit_positions_range<Integral> bit_positions(Integral x) noexcept {
+    return bit_positions_range<Integral>(x);
+  }
+
+//Iterates over the positions of the 1 bits of an array of integers, where bit b of
+//element i is position i * sizeof(Integral) * CHAR_BIT + b. Zero elements are skipped.
+template <typename Integral>
+class array_bit_positions_iterator {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef size_t value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const size_t* pointer;
+    typedef size_t reference;
+
+    array_bit_positions_iterator() noexcept = default;
+    array_bit_positions_iterator(const Integral* p, const Integral* end) noexcept
+      : _p(p), _end(end) { skip(); }
+
+    size_t operator*() const noexcept { return _base - nbits + size_t(cntt0(_x)); }
+    array_bit_positions_iterator& operator++() noexcept { _x = rstls1b(_x); skip(); return *this; }
+    array_bit_positions_iterator operator++(int) noexcept { array_bit_positions_iterator t = *this; ++*this; return t; }
+
+    bool operator==(const array_bit_positions_iterator& o) const noexcept { return _p == o._p && _x == o._x; }
+    bool operator!=(const array_bit_positions_iterator& o) const noexcept { return !(*this == o); }
+
+  private:
+    typedef typename bitops_detail::make_unsigned<Integral>::type U;
+    static constexpr size_t nbits = sizeof(Integral) * CHAR_BIT;
+
+    //Loads elements until one with a 1 bit is found or the array ends
+    void skip() noexcept {
+      while(_x == 0 && _p != _end) {
+        _x = U(*_p++);
+        _base += nbits;
+      }
+    }
+
+    const Integral* _p = nullptr;
+    const Integral* _end = nullptr;
+    U _x = 0;
+    //Position of the first bit of the element after _x
+    size_t _base = 0;
+};
+
+template <typename Integral>
+class array_bit_positions_range {
+  public:
+    typedef array_bit_positions_iterator<Integral> iterator;
+
+    array_bit_positions_range(const Integral* p, size_t n) noexcept : _p(p), _n(n) {}
+
+    iterator begin() const noexcept { return iterator(_p, _p + _n); }
+    iterator end() const noexcept { return iterator(_p + _n, _p + _n); }
+
+  private:
+    const Integral* _p;
+    size_t _n;
+};
+
+//Returns a range over the positions of the 1 bits of the n integers at p
+template <typename Integral>
+  array_bit_positions_range<Integral> bit_positions(const Integral* p, size_t n) noexcept {
+    return array_bit_positions_range<Integral>(p, n);
+  }
+
+namespace bitops_detail {
+
+inline bool has_avx512f() noexcept {
+#if defined(__AVX512F__)
+  return true;
+#else
+  return cpu().avx512f;
+#endif
+}
+
+//Writes the positions of the 1 bits of w, plus base, to out 8 at a time without
+//branching on each bit (Langdale, Lemire: Parsing Gigabytes of JSON per Second).
+//Writes up to 7 scratch entries past the returned count.
+template <typename Integral>
+  inline size_t decode_bit_positions_word(Integral w, uint32_t base, uint32_t* out) noexcept {
+    typedef typename bitops_detail::make_unsigned<Integral>::type U;
+    U x = U(w);
+    int c = popcount(x);
+    for(int i = 0; i < c; i += 8) {
+      out[i + 0] = base + uint32_t(cntt0(x)); x = rstls1b(x);
+      out[i + 1] = base + uint32_t(cntt0(x)); x = rstls1b(x);
+      out[i + 2] = base + uint32_t(cntt0(x)); x = rstls1b(x);
+      out[i + 3] = base + uint32_t(cntt0(x)); x = rstls1b(x);
+      out[i + 4] = base + uint32_t(cntt0(x)); x = rstls1b(x);
+      out[i + 5] = base + uint32_t(cntt0(x)); x = rstls1b(x);
+      out[i + 6] = base + uint32_t(cntt0(x)); x = rstls1b(x);
+      out[i + 7] = base + uint32_t(cntt0(x)); x = rstls1b(x);
+    }
+    return size_t(c);
+  }
+
+#if defined(BITOPS_RUNTIME_DISPATCH)
+//Decodes nwords little endian 64 bit words with vpcompressd, 16 positions per step.
+//Writes up to 15 scratch entries past the returned count.
+BITOPS_TARGET("avx512f") inline size_t decode_bit_positions_avx512(const unsigned char* p, size_t nwords, uint32_t* out) noexcept {
+  const __m512i iota = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m512i sixteen = _mm512_set1_epi32(16);
+  size_t count = 0;
+  for(size_t i = 0; i < nwords; ++i) {
+    uint64_t w;
+    std::memcpy(&w, p + i * sizeof(w), sizeof(w));
+    if(w == 0) { continue; }
+    __m512i pos = _mm512_add_epi32(_mm512_set1_epi32(int(i * 64)), iota);
+    for(int k = 0; k < 64; k += 16) {
+      __mmask16 m = __mmask16(shlr(w, k));
+      _mm512_storeu_si512(out + count, _mm512_maskz_compress_epi32(m, pos));
+      count += size_t(popcount(uint16_t(m)));
+      pos = _mm512_add_epi32(pos, sixteen);
+    }
+  }
+  return count;
+}
+#endif
+
+} //namespace bitops_detail
+
+//Writes the positions of the 1 bits of the n integers at p to out, and returns the number of positions written.
+//Positions are numbered as in bit_positions(p, n) and must fit in uint32_t.
+//Entries past the returned count may be used as scratch space, so out must have room for popcount(p, n) + 16 entries.
+//x86_64 AVX512F: vpcompressd
+//Application: converting a filter bitmap to a selection vector in a query engine
+template <typename Integral>
+  auto decode_bit_positions(const Integral* p, size_t n, uint32_t* out) noexcept
+  -> typename std::enable_if<std::is_integral<Integral>::value, size_t>::type {
+    constexpr uint32_t nbits = uint32_t(sizeof(Integral) * CHAR_BIT);
+    size_t count = 0;
+    size_t i = 0;
+#if defined(BITOPS_RUNTIME_DISPATCH)
+    if(bitops_detail::has_avx512f()) {
+      size_t nwords = n * sizeof(Integral) / sizeof(uint64_t);
+      count = bitops_detail::decode_bit_positions_avx512(reinterpret_cast<const unsigned char*>(p), nwords, out);
+      i = nwords * sizeof(uint64_t) / sizeof(Integral);
+    }
+#endif
+    for(; i < n; ++i) {
+      count += bitops_detail::decode_bit_positions_word(p[i], uint32_t(i) * nbits, out + count);
     }
-    mask &= (mask - 1);
+    return count;
   }
-  return res;
+
+///////////////////////////////////
+//Morton codes
+///////////////////////////////////
+
+//Morton (Z-order) codes interleave the bits of 2 or 3 coordinates into one integer, so that
+//sorting by the code keeps points which are close in space close in memory.
+//Each coordinate uses the low sizeof(Integral) * CHAR_BIT / 2 (or / 3) bits, higher bits are ignored.
+//With BMI2 each coordinate is one PDEP or PEXT, otherwise shift and mask networks are used.
+
+namespace bitops_detail {
+
+//Mask applied after x | shll(x, s) when spreading the bits of x to every 2nd bit
+constexpr uint64_t morton2_mask(int s) noexcept {
+  return s == 16 ? 0x0000FFFF0000FFFFULL : s == 8 ? 0x00FF00FF00FF00FFULL : s == 4 ? 0x0F0F0F0F0F0F0F0FULL
+    : s == 2 ? 0x3333333333333333ULL : 0x5555555555555555ULL;
+}
+
+//Mask applied after x | shll(x, s) when spreading the bits of x to every 3rd bit
+constexpr uint64_t morton3_mask(int s) noexcept {
+  return s == 32 ? 0x001F00000000FFFFULL : s == 16 ? 0x001F0000FF0000FFULL : s == 8 ? 0x100F00F00F00F00FULL
+    : s == 4 ? 0x10C30C30C30C30C3ULL : 0x1249249249249249ULL;
 }
 
+//The bits of a Morton code which belong to the first of 3 coordinates
+template <typename Integral>
+  constexpr Integral morton3_bits() noexcept {
+    return rstbitsge(Integral(0x1249249249249249ULL), int(sizeof(Integral) * CHAR_BIT / 3 * 3));
+  }
+
+template <typename Integral>
+  constexpr14 Integral morton3_spread(Integral x) noexcept {
+    constexpr int nbits = int(sizeof(x) * CHAR_BIT);
+    x = rstbitsge(x, nbits / 3);
+    for(int s = nbits / 2; s >= 2; s /= 2) {
+      x = (x | shll(x, s)) & Integral(morton3_mask(s));
+    }
+    return x;
+  }
+
+template <typename Integral>
+  constexpr14 Integral morton3_compact(Integral x) noexcept {
+    constexpr int nbits = int(sizeof(x) * CHAR_BIT);
+    x = x & morton3_bits<Integral>();
+    for(int s = 2; s < nbits / 2; s *= 2) {
+      x = (x ^ shlr(x, s)) & Integral(morton3_mask(2 * s));
+    }
+    return rstbitsge(x ^ shlr(x, nbits / 2), nbits / 3);
+  }
+
+} //namespace bitops_detail
+
+//Interleaves the bits of x and y, x takes the even bits.
+//x86_64 BMI2: PDEP
+template <typename Integral>
+  constexpr14 auto morton2(Integral x, Integral y) noexcept
+  -> typename std::enable_if<std::is_unsigned<Integral>::value, Integral>::type {
+    constexpr int nbits = int(sizeof(Integral) * CHAR_BIT);
+#if defined(BITOPS_PDEP)
+    if(!BITOPS_CONSTANT_EVALUATED()) {
+      return deposit_bits(x, Integral(0x5555555555555555ULL)) | deposit_bits(y, Integral(0xAAAAAAAAAAAAAAAAULL));
+    }
+#endif
+    return outer_pshuffle(Integral(rstbitsge(x, nbits / 2) | shll(y, nbits / 2)));
+  }
+
+//Returns the x coordinate of the Morton code m
+//x86_64 BMI2: PEXT
+template <typename Integral>
+  constexpr14 auto morton2_x(Integral m) noexcept
+  -> typename std::enable_if<std::is_unsigned<Integral>::value, Integral>::type {
+#if defined(BITOPS_PDEP)
+    if(!BITOPS_CONSTANT_EVALUATED()) { return extract_bits(m, Integral(0x5555555555555555ULL)); }
+#endif
+    return rstbitsge(outer_punshuffle(m), int(sizeof(Integral) * CHAR_BIT / 2));
+  }
+
+//Returns the y coordinate of the Morton code m
+//x86_64 BMI2: PEXT
+template <typename Integral>
+  constexpr14 auto morton2_y(Integral m) noexcept
+  -> typename std::enable_if<std::is_unsigned<Integral>::value, Integral>::type {
+#if defined(BITOPS_PDEP)
+    if(!BITOPS_CONSTANT_EVALUATED()) { return extract_bits(m, Integral(0xAAAAAAAAAAAAAAAAULL)); }
+#endif
+    return shlr(outer_punshuffle(m), int(sizeof(Integral) * CHAR_BIT / 2));
+  }
+
+//Interleaves the bits of x, y and z, x takes bits 0, 3, 6, ..
+//x86_64 BMI2: PDEP
+template <typename Integral>
+  constexpr14 auto morton3(Integral x, Integral y, Integral z) noexcept
+  -> typename std::enable_if<std::is_unsigned<Integral>::value, Integral>::type {
+#if defined(BITOPS_PDEP)
+    if(!BITOPS_CONSTANT_EVALUATED()) {
+      constexpr Integral mask = bitops_detail::morton3_bits<Integral>();
+      return deposit_bits(x, mask) | deposit_bits(y, shll(mask, 1)) | deposit_bits(z, shll(mask, 2));
+    }
+#endif
+    return bitops_detail::morton3_spread(x) | shll(bitops_detail::morton3_spread(y), 1) | shll(bitops_detail::morton3_spread(z), 2);
+  }
+
+//Returns the x coordinate of the 3 dimensional Morton code m
+//x86_64 BMI2: PEXT
+template <typename Integral>
+  constexpr14 auto morton3_x(Integral m) noexcept
+  -> typename std::enable_if<std::is_unsigned<Integral>::value, Integral>::type {
+#if defined(BITOPS_PDEP)
+    if(!BITOPS_CONSTANT_EVALUATED()) { return extract_bits(m, bitops_detail::morton3_bits<Integral>()); }
+#endif
+    return bitops_detail::morton3_compact(m);
+  }
+
+//Returns the y coordinate of the 3 dimensional Morton code m
+//x86_64 BMI2: PEXT
+template <typename Integral>
+  constexpr14 auto morton3_y(Integral m) noexcept
+  -> typename std::enable_if<std::is_unsigned<Integral>::value, Integral>::type {
+#if defined(BITOPS_PDEP)
+    if(!BITOPS_CONSTANT_EVALUATED()) { return extract_bits(m, shll(bitops_detail::morton3_bits<Integral>(), 1)); }
+#endif
+    return bitops_detail::morton3_compact(shlr(m, 1));
+  }
+
+//Returns the z coordinate of the 3 dimensional Morton code m
+//x86_64 BMI2: PEXT
+template <typename Integral>
+  constexpr14 auto morton3_z(Integral m) noexcept
+  -> typename std::enable_if<std::is_unsigned<Integral>::value, Integral>::type {
+#if defined(BITOPS_PDEP)
+    if(!BITOPS_CONSTANT_EVALUATED()) { return extract_bits(m, shll(bitops_detail::morton3_bits<Integral>(), 2)); }
+#endif
+    return bitops_detail::morton3_compact(shlr(m, 2));
+  }
+
+namespace bitops_detail {
+
+#if defined(BITOPS_RUNTIME_DISPATCH)
+template <typename Integral>
+  BITOPS_TARGET("avx2") inline __m256i slli_lanes(__m256i v, int s) noexcept {
+    return sizeof(Integral) == 2 ? _mm256_slli_epi16(v, s) : sizeof(Integral) == 4 ? _mm256_slli_epi32(v, s) : _mm256_slli_epi64(v, s);
+  }
+
+template <typename Integral>
+  BITOPS_TARGET("avx2") inline __m256i set1_lanes(uint64_t x) noexcept {
+    return sizeof(Integral) == 2 ? _mm256_set1_epi16(short(x)) : sizeof(Integral) == 4 ? _mm256_set1_epi32(int(x)) : _mm256_set1_epi64x((long long)x);
+  }
+
+//One step of spreading the bits of each lane: (x | shll(x, s)) & mask
+template <typename Integral>
+  BITOPS_TARGET("avx2") inline __m256i morton_step_avx2(__m256i x, int s, uint64_t mask) noexcept {
+    return _mm256_and_si256(_mm256_or_si256(x, slli_lanes<Integral>(x, s)), set1_lanes<Integral>(mask));
+  }
+
+//The steps are written out so that every shift is an immediate
+template <typename Integral>
+  BITOPS_TARGET("avx2") inline __m256i morton2_spread_avx2(__m256i x) noexcept {
+    constexpr int nbits = int(sizeof(Integral) * CHAR_BIT);
+    x = _mm256_and_si256(x, set1_lanes<Integral>(rstbitsge(~uint64_t(0), nbits / 2)));
+    if(nbits > 32) { x = morton_step_avx2<Integral>(x, 16, morton2_mask(16)); }
+    if(nbits > 16) { x = morton_step_avx2<Integral>(x, 8, morton2_mask(8)); }
+    x = morton_step_avx2<Integral>(x, 4, morton2_mask(4));
+    x = morton_step_avx2<Integral>(x, 2, morton2_mask(2));
+    return morton_step_avx2<Integral>(x, 1, morton2_mask(1));
+  }
+
+template <typename Integral>
+  BITOPS_TARGET("avx2") inline __m256i morton3_spread_avx2(__m256i x) noexcept {
+    constexpr int nbits = int(sizeof(Integral) * CHAR_BIT);
+    x = _mm256_and_si256(x, set1_lanes<Integral>(rstbitsge(~uint64_t(0), nbits / 3)));
+    if(nbits > 32) { x = morton_step_avx2<Integral>(x, 32, morton3_mask(32)); }
+    if(nbits > 16) { x = morton_step_avx2<Integral>(x, 16, morton3_mask(16)); }
+    x = morton_step_avx2<Integral>(x, 8, morton3_mask(8));
+    x = morton_step_avx2<Integral>(x, 4, morton3_mask(4));
+    return morton_step_avx2<Integral>(x, 2, morton3_mask(2));
+  }
+
+//PDEP beats the shift network on 4 64 bit lanes
+template <typename Integral>
+  BITOPS_TARGET("bmi2") inline void morton2_bmi2(const Integral* x, const Integral* y, Integral* out, size_t n) noexcept {
+    for(size_t i = 0; i < n; ++i) {
+      out[i] = deposit_bits_pdep(x[i], Integral(0x5555555555555555ULL)) | deposit_bits_pdep(y[i], Integral(0xAAAAAAAAAAAAAAAAULL));
+    }
+  }
+
+template <typename Integral>
+  BITOPS_TARGET("bmi2") inline void morton3_bmi2(const Integral* x, const Integral* y, const Integral* z, Integral* out, size_t n) noexcept {
+    constexpr Integral mask = morton3_bits<Integral>();
+    for(size_t i = 0; i < n; ++i) {
+      out[i] = deposit_bits_pdep(x[i], mask) | deposit_bits_pdep(y[i], shll(mask, 1)) | deposit_bits_pdep(z[i], shll(mask, 2));
+    }
+  }
+
+//Encodes n points, n must be a multiple of the number of lanes
+template <typename Integral>
+  BITOPS_TARGET("avx2") inline void morton2_avx2(const Integral* x, const Integral* y, Integral* out, size_t n) noexcept {
+    constexpr size_t w = sizeof(__m256i) / sizeof(Integral);
+    for(size_t i = 0; i < n; i += w) {
+      __m256i vx = morton2_spread_avx2<Integral>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i)));
+      __m256i vy = morton2_spread_avx2<Integral>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + i)));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_or_si256(vx, slli_lanes<Integral>(vy, 1)));
+    }
+  }
+
+template <typename Integral>
+  BITOPS_TARGET("avx2") inline void morton3_avx2(const Integral* x, const Integral* y, const Integral* z, Integral* out, size_t n) noexcept {
+    constexpr size_t w = sizeof(__m256i) / sizeof(Integral);
+    for(size_t i = 0; i < n; i += w) {
+      __m256i vx = morton3_spread_avx2<Integral>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i)));
+      __m256i vy = morton3_spread_avx2<Integral>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + i)));
+      __m256i vz = morton3_spread_avx2<Integral>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(z + i)));
+      __m256i m = _mm256_or_si256(vx, _mm256_or_si256(slli_lanes<Integral>(vy, 1), slli_lanes<Integral>(vz, 2)));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), m);
+    }
+  }
+#endif
+
+} //namespace bitops_detail
+
+//Stores morton2(x[i], y[i]) to out[i] for each of the n points
+//x86_64 AVX2: shift and mask network on 16 16 bit or 8 32 bit codes at once
+//x86_64 BMI2: PDEP for 64 bit codes
+//Application: sorting points by Z-order for spatial indexes
+template <typename Integral>
+  auto morton2(const Integral* x, const Integral* y, Integral* out, size_t n) noexcept
+  -> typename std::enable_if<std::is_unsigned<Integral>::value>::type {
+    size_t i = 0;
+#if defined(BITOPS_RUNTIME_DISPATCH)
+    if(sizeof(Integral) == 8 && bitops_detail::has_fast_pdep()) {
+      bitops_detail::morton2_bmi2(x, y, out, n);
+      return;
+    }
+    if(sizeof(Integral) > 1 && bitops_detail::has_avx2()) {
+      i = n - n % (sizeof(__m256i) / sizeof(Integral));
+      bitops_detail::morton2_avx2(x, y, out, i);
+    }
+#endif
+    for(; i < n; ++i) {
+      out[i] = morton2(x[i], y[i]);
+    }
+  }
+
+//Stores morton3(x[i], y[i], z[i]) to out[i] for each of the n points
+//x86_64 AVX2: shift and mask network on 16 16 bit or 8 32 bit codes at once
+//x86_64 BMI2: PDEP for 64 bit codes
+template <typename Integral>
+  auto morton3(const Integral* x, const Integral* y, const Integral* z, Integral* out, size_t n) noexcept
+  -> typename std::enable_if<std::is_unsigned<Integral>::value>::type {
+    size_t i = 0;
+#if defined(BITOPS_RUNTIME_DISPATCH)
+    if(sizeof(Integral) == 8 && bitops_detail::has_fast_pdep()) {
+      bitops_detail::morton3_bmi2(x, y, z, out, n);
+      return;
+    }
+    if(sizeof(Integral) > 1 && bitops_detail::has_avx2()) {
+      i = n - n % (sizeof(__m256i) / sizeof(Integral));
+      bitops_detail::morton3_avx2(x, y, z, out, i);
+    }
+#endif
+    for(; i < n; ++i) {
+      out[i] = morton3(x[i], y[i], z[i]);
+    }
+  }
+
+///////////////////////////////////
+//Bit matrix transposition
+///////////////////////////////////
+
+//An n x n bit matrix is n words, bit j of word i being row i column j. transpose8 keeps an 8x8 matrix
+//in one word, row i in byte i. Transposition swaps bit j of the row with bit j of the column for each j,
+//and each of those is one delta swap of the off diagonal blocks of size 2^j, as in outer_pshuffle:
+//t = (shlr(row_k, 2^j) ^ row_k+2^j) & mask, row_k+2^j ^= t, row_k ^= shll(t, 2^j), for the rows k with bit j clear.
+//That is n / 2 * log2(n) delta swaps instead of n * n single bit moves.
+
+namespace bitops_detail {
+
+//The columns whose index has bit j clear, 0x5555... for j = 1, 0x3333... for j = 2, 0x0F0F... for j = 4 ...
+template <typename Word>
+  constexpr Word transpose_mask(int j) noexcept {
+    return Word(~Word(0) / Word(shll(Word(1), j) + 1u));
+  }
+
+//Transposes the n x n matrix at src to dst, which may be the same. The loops are unrolled,
+//so the mask and the row indexes of each delta swap are known at compile time.
+template <typename Word>
+  inline void transpose_block(const Word* src, Word* dst) noexcept {
+    constexpr int n = int(sizeof(Word) * CHAR_BIT);
+    Word m[n];
+    std::memcpy(m, src, sizeof(m));
+    constexpr int rounds = n == 64 ? 6 : n == 32 ? 5 : n == 16 ? 4 : 3;
+    BITOPS_UNROLL(6)
+    for(int r = 0; r < rounds; ++r) {
+      const int j = n / 2 >> r;
+      const Word mask = transpose_mask<Word>(j);
+      BITOPS_UNROLL(32)
+      for(int i = 0; i < n / 2; ++i) {
+        //The i-th row with bit j clear
+        const int k = (i & ~(j - 1)) * 2 + (i & (j - 1));
+        Word t = (shlr(m[k], j) ^ m[k + j]) & mask;
+        m[k + j] ^= t;
+        m[k] ^= shll(t, j);
+      }
+    }
+    std::memcpy(dst, m, sizeof(m));
+  }
+
+#if defined(BITOPS_RUNTIME_DISPATCH)
+template <typename Integral>
+  BITOPS_TARGET("avx2") inline __m256i srli_lanes(__m256i v, int s) noexcept {
+    return sizeof(Integral) == 4 ? _mm256_srli_epi32(v, s) : _mm256_srli_epi64(v, s);
+  }
+
+//Swaps the groups of Bytes bytes at odd and even positions of v
+template <int Bytes>
+  BITOPS_TARGET("avx2") inline __m256i swap_groups(__m256i v) noexcept {
+    return Bytes == 16 ? _mm256_permute4x64_epi64(v, 0x4E) : Bytes == 8 ? _mm256_shuffle_epi32(v, 0x4E) : _mm256_shuffle_epi32(v, 0xB1);
+  }
+
+//The groups of Bytes bytes at even positions of v
+template <int Bytes>
+  BITOPS_TARGET("avx2") inline __m256i even_groups() noexcept {
+    return Bytes == 16 ? _mm256_set_epi64x(0, 0, -1, -1) : Bytes == 8 ? _mm256_set_epi64x(0, -1, 0, -1) : _mm256_set1_epi64x(0xFFFFFFFF);
+  }
+
+//One delta swap step on a matrix held in vectors of 8 or 4 rows. Rows k and k + J are in different
+//vectors for J >= the number of lanes and in the same vector otherwise.
+template <typename Word, int J>
+  BITOPS_TARGET("avx2") inline void transpose_step_avx2(__m256i* v) noexcept {
+    constexpr int lanes = int(sizeof(__m256i) / sizeof(Word));
+    constexpr int nvec = int(sizeof(Word) * CHAR_BIT) / lanes;
+    const __m256i mask = set1_lanes<Word>(transpose_mask<Word>(J));
+    if(J >= lanes) {
+      constexpr int d = J / lanes;
+      for(int i = 0; i < nvec; i = (i + d + 1) & ~d) {
+        __m256i t = _mm256_and_si256(_mm256_xor_si256(srli_lanes<Word>(v[i], J), v[i + d]), mask);
+        v[i + d] = _mm256_xor_si256(v[i + d], t);
+        v[i] = _mm256_xor_si256(v[i], slli_lanes<Word>(t, J));
+      }
+    } else {
+      constexpr int bytes = J * int(sizeof(Word));
+      const __m256i sel = _mm256_and_si256(mask, even_groups<bytes>());
+      for(int i = 0; i < nvec; ++i) {
+        __m256i t = _mm256_and_si256(_mm256_xor_si256(srli_lanes<Word>(v[i], J), swap_groups<bytes>(v[i])), sel);
+        v[i] = _mm256_xor_si256(v[i], _mm256_or_si256(slli_lanes<Word>(t, J), swap_groups<bytes>(t)));
+      }
+    }
+  }
+
+BITOPS_TARGET("avx2") inline void transpose_steps_avx2(__m256i* v, uint32_t) noexcept {
+  transpose_step_avx2<uint32_t, 16>(v);
+  transpose_step_avx2<uint32_t, 8>(v);
+  transpose_step_avx2<uint32_t, 4>(v);
+  transpose_step_avx2<uint32_t, 2>(v);
+  transpose_step_avx2<uint32_t, 1>(v);
+}
+
+BITOPS_TARGET("avx2") inline void transpose_steps_avx2(__m256i* v, uint64_t) noexcept {
+  transpose_step_avx2<uint64_t, 32>(v);
+  transpose_step_avx2<uint64_t, 16>(v);
+  transpose_step_avx2<uint64_t, 8>(v);
+  transpose_step_avx2<uint64_t, 4>(v);
+  transpose_step_avx2<uint64_t, 2>(v);
+  transpose_step_avx2<uint64_t, 1>(v);
+}
+
+//The 32x32 matrix is 4 vectors and the 64x64 matrix 16, held in registers for all of the steps
+template <typename Word>
+  BITOPS_TARGET("avx2") inline void transpose_avx2(const Word* src, Word* dst, size_t nblocks) noexcept {
+    constexpr size_t nvec = sizeof(Word) * CHAR_BIT * sizeof(Word) / sizeof(__m256i);
+    for(size_t b = 0; b < nblocks; ++b) {
+      __m256i v[nvec];
+      for(size_t i = 0; i < nvec; ++i) {
+        v[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src) + nvec * b + i);
+      }
+      transpose_steps_avx2(v, Word());
+      for(size_t i = 0; i < nvec; ++i) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst) + nvec * b + i, v[i]);
+      }
+    }
+  }
+#endif
+
+template <typename Word>
+  inline void transpose_blocks(const Word* src, Word* dst, size_t nblocks) noexcept {
+#if defined(BITOPS_RUNTIME_DISPATCH)
+    if(has_avx2()) {
+      transpose_avx2(src, dst, nblocks);
+      return;
+    }
+#endif
+    constexpr size_t n = sizeof(Word) * CHAR_BIT;
+    for(size_t b = 0; b < nblocks; ++b) {
+      transpose_block(src + n * b, dst + n * b);
+    }
+  }
+
+} //namespace bitops_detail
+
+//Transposes the 8x8 bit matrix x, byte i being row i
+//Application: bitsliced processing of 8 bytes, converting between bit planes and pixels
+inline constexpr14 uint64_t transpose8(uint64_t x) noexcept {
+  uint64_t t = (x ^ shlr(x, 7)) & 0x00AA00AA00AA00AAULL;
+  x = x ^ t ^ shll(t, 7);
+  t = (x ^ shlr(x, 14)) & 0x0000CCCC0000CCCCULL;
+  x = x ^ t ^ shll(t, 14);
+  t = (x ^ shlr(x, 28)) & 0x00000000F0F0F0F0ULL;
+  x = x ^ t ^ shll(t, 28);
+  return x;
+}
+
+//Transposes each of the nblocks 32x32 bit matrices of 32 words at src to dst. src and dst may be the same.
+//x86_64 AVX2: the delta swaps on 8 rows at once
+//Application: bitsliced filters and ciphers, converting between 32 values and their 32 bit slices
+inline void transpose32(const uint32_t* src, uint32_t* dst, size_t nblocks) noexcept {
+  bitops_detail::transpose_blocks(src, dst, nblocks);
+}
+
+//Transposes the 32x32 bit matrix of the 32 words at m in place
+inline void transpose32(uint32_t* m) noexcept {
+  transpose32(m, m, 1);
+}
+
+//Transposes each of the nblocks 64x64 bit matrices of 64 words at src to dst. src and dst may be the same.
+//x86_64 AVX2: the delta swaps on 4 rows at once
+//Application: bitsliced filters and ciphers, converting between 64 values and their 64 bit slices
+inline void transpose64(const uint64_t* src, uint64_t* dst, size_t nblocks) noexcept {
+  bitops_detail::transpose_blocks(src, dst, nblocks);
+}
+
+//Transposes the 64x64 bit matrix of the 64 words at m in place
+inline void transpose64(uint64_t* m) noexcept {
+  transpose64(m, m, 1);
+}
+
+///////////////////////////////////
+//Integer arithmetic
+///////////////////////////////////
+
+namespace bitops_detail {
+
+//|x| as the unsigned type, which also holds the magnitude of the minimum
+template <typename Integral>
+  constexpr typename make_unsigned<Integral>::type magnitude(Integral x) noexcept {
+    typedef typename make_unsigned<Integral>::type U;
+    return x < Integral(0) ? U(U(0) - U(x)) : U(x);
+  }
+
+//Stein's binary gcd of u and v, both nonzero. After the common factors of 2 are taken out u and v are odd,
+//so v - u is even and cntt0 strips all of its factors of 2 at once instead of one per step.
+//cntt0(v - u) is cntt0(u - v), which starts the next count before the min and |v - u| are known.
+//The selects become cmov, a branch on u < v would be mispredicted half of the time.
+template <typename U>
+  constexpr14 U gcd_binary(U u, U v) noexcept {
+    int shift = cntt0(U(u | v));
+    u = shlr(u, cntt0(u));
+    v = shlr(v, cntt0(v));
+    while(u != v) {
+      U d = U(v - u);
+      int z = cntt0(d);
+      bool less = v < u;
+      u = less ? v : u;
+      v = shlr(less ? U(U(0) - d) : d, z);
+    }
+    return shll(u, shift);
+  }
+
+//Newton's iteration g = (g + x / g) / 2 decreases to floor(sqrt(x)) from any g >= sqrt(x). The first guess
+//2^(floor(log2(x)) / 2 + 1) from cntl0 is within a factor of 2, leaving about log2 of the width iterations.
+template <typename U>
+  constexpr14 U isqrt_newton(U x) noexcept {
+    if(x < 2) { return x; }
+    U g = shll(U(1), ilog2(x) / 2 + 1);
+    for(;;) {
+      U y = shlr(U(g + x / g), 1);
+      if(y >= g) { return g; }
+      g = y;
+    }
+  }
+
+//The double sqrt is exact below 2^53 and off by at most 1 above, where x is rounded to 53 bits
+inline uint64_t isqrt_double(uint64_t x) noexcept {
+  uint64_t r = std::min(uint64_t(std::sqrt(double(x))), uint64_t(0xFFFFFFFF));
+  if(r * r > x) {
+    --r;
+  } else if(r < 0xFFFFFFFF && (r + 1) * (r + 1) <= x) {
+    ++r;
+  }
+  return r;
+}
+
+#if defined(BITOPS_RUNTIME_DISPATCH)
+//Number of trailing zeros in each 32 bit lane, the exponent of the lowest set bit converted to float.
+//It is -127 for 0, a shift count which shifts the lane out entirely.
+BITOPS_TARGET("avx2") inline __m256i cntt0_epi32_avx2(__m256i v) noexcept {
+  __m256i low = _mm256_and_si256(v, _mm256_sub_epi32(_mm256_setzero_si256(), v));
+  __m256i e = _mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(low)), 23);
+  return _mm256_sub_epi32(_mm256_and_si256(e, _mm256_set1_epi32(0xFF)), _mm256_set1_epi32(127));
+}
+
+//gcd_binary on 8 pairs, n must be a multiple of 8. Every lane steps until the last one is done.
+//A finished lane has v == 0 and gets v = u, so that it stays at u, 0. Pairs with a 0 take a | b instead.
+//There are no 64 bit lane versions: without an unsigned 64 bit min or a lane cntt0 they lose to gcd_binary.
+BITOPS_TARGET("avx2") inline void gcd_avx2(const uint32_t* a, const uint32_t* b, uint32_t* out, size_t n) noexcept {
+  const __m256i zero = _mm256_setzero_si256();
+  for(size_t i = 0; i < n; i += 8) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    __m256i trivial = _mm256_or_si256(_mm256_cmpeq_epi32(va, zero), _mm256_cmpeq_epi32(vb, zero));
+    __m256i shift = cntt0_epi32_avx2(_mm256_or_si256(va, vb));
+    __m256i u = _mm256_srlv_epi32(va, cntt0_epi32_avx2(va));
+    __m256i v = _mm256_andnot_si256(trivial, vb);
+    while(!_mm256_testz_si256(v, v)) {
+      v = _mm256_srlv_epi32(v, cntt0_epi32_avx2(v));
+      v = _mm256_or_si256(v, _mm256_and_si256(_mm256_cmpeq_epi32(v, zero), u));
+      __m256i hi = _mm256_max_epu32(u, v);
+      u = _mm256_min_epu32(u, v);
+      v = _mm256_sub_epi32(hi, u);
+    }
+    __m256i g = _mm256_blendv_epi8(_mm256_sllv_epi32(u, shift), _mm256_or_si256(va, vb), trivial);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), g);
+  }
+}
+
+//isqrt of 8 32 bit values, n must be a multiple of 8. Unsigned to double is the signed conversion of x - 2^31
+//plus 2^31, and the double sqrt is exact for 32 bit values.
+BITOPS_TARGET("avx2") inline void isqrt_avx2(const uint32_t* x, uint32_t* out, size_t n) noexcept {
+  const __m128i bias = _mm_set1_epi32(INT32_MIN);
+  const __m256d offset = _mm256_set1_pd(2147483648.0);
+  for(size_t i = 0; i < n; i += 8) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+    __m256d lo = _mm256_add_pd(_mm256_cvtepi32_pd(_mm_xor_si128(_mm256_castsi256_si128(v), bias)), offset);
+    __m256d hi = _mm256_add_pd(_mm256_cvtepi32_pd(_mm_xor_si128(_mm256_extracti128_si256(v, 1), bias)), offset);
+    __m128i rlo = _mm256_cvttpd_epi32(_mm256_sqrt_pd(lo));
+    __m128i rhi = _mm256_cvttpd_epi32(_mm256_sqrt_pd(hi));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_inserti128_si256(_mm256_castsi128_si256(rlo), rhi, 1));
+  }
+}
+#endif
+
+} //namespace bitops_detail
+
+//Returns the greatest common divisor of |a| and |b|, 0 if both are 0. Undefined if the result does not fit in Integral.
+//Stein's binary gcd: subtractions and cntt0 instead of the divisions of Euclid's algorithm
+//Application: reducing fractions, Howard Hinnant's gcd example
+template <typename Integral>
+  constexpr14 auto gcd(Integral a, Integral b) noexcept
+  -> typename std::enable_if<bitops_detail::is_integral<Integral>::value, Integral>::type {
+    return a == 0 ? Integral(bitops_detail::magnitude(b)) : b == 0 ? Integral(bitops_detail::magnitude(a)) :
+      Integral(bitops_detail::gcd_binary(bitops_detail::magnitude(a), bitops_detail::magnitude(b)));
+  }
+
+//Returns the least common multiple of |a| and |b|, 0 if either is 0. Undefined if the result does not fit in Integral.
+//Application: common period of schedules, common denominator of fractions
+template <typename Integral>
+  constexpr14 auto lcm(Integral a, Integral b) noexcept
+  -> typename std::enable_if<bitops_detail::is_integral<Integral>::value, Integral>::type {
+    return a == 0 || b == 0 ? Integral(0) :
+      Integral(bitops_detail::magnitude(a) / bitops_detail::gcd_binary(bitops_detail::magnitude(a), bitops_detail::magnitude(b)) * bitops_detail::magnitude(b));
+  }
+
+//Returns floor(sqrt(x)). Undefined if x < 0.
+//Newton's iteration from a first guess within a factor of 2 given by cntl0. At runtime up to 64 bits
+//the double sqrt, corrected by 1 where double(x) is rounded.
+//Application: bounds of trial division, side of a square grid of n cells
+template <typename Integral>
+  constexpr14 auto isqrt(Integral x) noexcept
+  -> typename std::enable_if<bitops_detail::is_integral<Integral>::value, Integral>::type {
+#if defined(BITOPS_CONSTANT_EVALUATED)
+    if(sizeof(x) <= 8 && !BITOPS_CONSTANT_EVALUATED()) { return Integral(bitops_detail::isqrt_double(uint64_t(x))); }
+#endif
+    return Integral(bitops_detail::isqrt_newton(typename bitops_detail::make_unsigned<Integral>::type(x)));
+  }
+
+//Stores gcd(a[i], b[i]) to out[i] for each of the n pairs. out may be a or b.
+//x86_64 AVX2: binary gcd on 8 32 bit pairs at once
+template <typename Integral>
+  auto gcd(const Integral* a, const Integral* b, Integral* out, size_t n) noexcept
+  -> typename std::enable_if<std::is_unsigned<Integral>::value>::type {
+    size_t i = 0;
+#if defined(BITOPS_RUNTIME_DISPATCH)
+    if(sizeof(Integral) == 4 && bitops_detail::has_avx2()) {
+      i = n - n % 8;
+      bitops_detail::gcd_avx2(reinterpret_cast<const uint32_t*>(a), reinterpret_cast<const uint32_t*>(b), reinterpret_cast<uint32_t*>(out), i);
+    }
+#endif
+    for(; i < n; ++i) {
+      out[i] = gcd(a[i], b[i]);
+    }
+  }
+
+//Stores lcm(a[i], b[i]) to out[i] for each of the n pairs. out may be a or b.
+//The gcds are computed in blocks with the batch gcd, the divisions one at a time.
+template <typename Integral>
+  auto lcm(const Integral* a, const Integral* b, Integral* out, size_t n) noexcept
+  -> typename std::enable_if<std::is_unsigned<Integral>::value>::type {
+    Integral g[256];
+    for(size_t i = 0; i < n; i += 256) {
+      size_t m = std::min(n - i, size_t(256));
+      gcd(a + i, b + i, g, m);
+      for(size_t j = 0; j < m; ++j) {
+        out[i + j] = g[j] == 0 ? Integral(0) : Integral(a[i + j] / g[j] * b[i + j]);
+      }
+    }
+  }
+
+//Stores isqrt(x[i]) to out[i] for each of the n values. out may be x.
+//x86_64 AVX2: double sqrt of 8 32 bit values at once
+template <typename Integral>
+  auto isqrt(const Integral* x, Integral* out, size_t n) noexcept
+  -> typename std::enable_if<std::is_unsigned<Integral>::value>::type {
+    size_t i = 0;
+#if defined(BITOPS_RUNTIME_DISPATCH)
+    if(sizeof(Integral) == 4 && bitops_detail::has_avx2()) {
+      i = n - n % 8;
+      bitops_detail::isqrt_avx2(reinterpret_cast<const uint32_t*>(x), reinterpret_cast<uint32_t*>(out), i);
+    }
+#endif
+    for(; i < n; ++i) {
+      out[i] = isqrt(x[i]);
+    }
+  }
+
+///////////////////////////////////
+//Multiword integers
+///////////////////////////////////
+
+//A std::array<uint64_t, N> holds an N * 64 bit unsigned integer, word 0 being the least significant.
+//Counting scans the words from the end which decides the result and stops at the first nonzero word.
+//Shifts and rotations combine neighbouring words with double word shifts.
+
+namespace bitops_detail {
+
+//The high word of (hi:lo) << s, undefined if s < 0 or s > 63
+//x86_64: SHLD
+inline constexpr uint64_t shld(uint64_t hi, uint64_t lo, int s) noexcept {
+#if defined(__SIZEOF_INT128__)
+  return uint64_t(((unsigned __int128)hi << 64 | lo) << (s & 63) >> 64);
+#else
+  return (hi << s) | ((lo >> 1) >> (63 - s));
+#endif
+}
+
+//The low word of (hi:lo) >> s, undefined if s < 0 or s > 63
+//x86_64: SHRD
+inline constexpr uint64_t shrd(uint64_t hi, uint64_t lo, int s) noexcept {
+#if defined(__SIZEOF_INT128__)
+  return uint64_t(((unsigned __int128)hi << 64 | lo) >> (s & 63));
+#else
+  return (lo >> s) | ((hi << 1) << (63 - s));
+#endif
+}
+
+} //namespace bitops_detail
+
+template <size_t N>
+  inline int cntt0(const std::array<uint64_t, N>& x) noexcept {
+    for(size_t i = 0; i < N; ++i) {
+      if(x[i] != 0) { return int(i * 64) + cntt0(x[i]); }
+    }
+    return int(N * 64);
+  }
+
+template <size_t N>
+  inline int cntl0(const std::array<uint64_t, N>& x) noexcept {
+    for(size_t i = N; i-- > 0;) {
+      if(x[i] != 0) { return int((N - 1 - i) * 64) + cntl0(x[i]); }
+    }
+    return int(N * 64);
+  }
+
+template <size_t N>
+  inline int popcount(const std::array<uint64_t, N>& x) noexcept {
+    int n = 0;
+    for(size_t i = 0; i < N; ++i) {
+      n += popcount(x[i]);
+    }
+    return n;
+  }
+
+//Logical left shift, undefined if s < 0 or s >= N * 64
+//x86_64: SHLD for each word
+template <size_t N>
+  inline std::array<uint64_t, N> shll(const std::array<uint64_t, N>& x, int s) noexcept {
+    std::array<uint64_t, N> r;
+    const size_t q = size_t(s) / 64;
+    for(size_t i = 0; i < N; ++i) {
+      uint64_t hi = i >= q ? x[i - q] : 0;
+      uint64_t lo = i >= q + 1 ? x[i - q - 1] : 0;
+      r[i] = bitops_detail::shld(hi, lo, s % 64);
+    }
+    return r;
+  }
+
+//Logical right shift, undefined if s < 0 or s >= N * 64
+//x86_64: SHRD for each word
+template <size_t N>
+  inline std::array<uint64_t, N> shlr(const std::array<uint64_t, N>& x, int s) noexcept {
+    std::array<uint64_t, N> r;
+    const size_t q = size_t(s) / 64;
+    for(size_t i = 0; i < N; ++i) {
+      uint64_t lo = i + q < N ? x[i + q] : 0;
+      uint64_t hi = i + q + 1 < N ? x[i + q + 1] : 0;
+      r[i] = bitops_detail::shrd(hi, lo, s % 64);
+    }
+    return r;
+  }
+
+//Circular left shift, undefined if s < 0
+template <size_t N>
+  inline std::array<uint64_t, N> rotl(const std::array<uint64_t, N>& x, int s) noexcept {
+    std::array<uint64_t, N> r;
+    const size_t q = size_t(s) / 64 % N;
+    for(size_t i = 0; i < N; ++i) {
+      r[i] = bitops_detail::shld(x[(i + N - q) % N], x[(i + 2 * N - q - 1) % N], s % 64);
+    }
+    return r;
+  }
+
+//Circular right shift, undefined if s < 0
+template <size_t N>
+  inline std::array<uint64_t, N> rotr(const std::array<uint64_t, N>& x, int s) noexcept {
+    std::array<uint64_t, N> r;
+    const size_t q = size_t(s) / 64 % N;
+    for(size_t i = 0; i < N; ++i) {
+      r[i] = bitops_detail::shrd(x[(i + q + 1) % N], x[(i + q) % N], s % 64);
+    }
+    return r;
+  }
+
+//Reverses all of the bits of x
+template <size_t N>
+  inline std::array<uint64_t, N> reverse_bits(const std::array<uint64_t, N>& x) noexcept {
+    std::array<uint64_t, N> r;
+    for(size_t i = 0; i < N; ++i) {
+      r[i] = reverse_bits(x[N - 1 - i]);
+    }
+    return r;
+  }
+
+//Round up to the next power of 2, 0 if it does not fit
+template <size_t N>
+  inline std::array<uint64_t, N> ceilp2(const std::array<uint64_t, N>& x) noexcept {
+    const int nbits = int(N * 64);
+    int l = cntl0(x);
+    //0 and powers of 2 are already rounded
+    if(l == nbits || cntt0(x) == nbits - 1 - l) {
+      return x;
+    }
+    std::array<uint64_t, N> r = {};
+    if(l > 0) {
+      r[size_t(nbits - l) / 64] = uint64_t(1) << ((nbits - l) % 64);
+    }
+    return r;
+  }
+
+////////////////////////////////////
+//Endian loads and stores
+////////////////////////////////////
+
+//Loads a little endian Integral from p, which may have any alignment.
+//memcpy of a constant size is a plain load, so each of these is one load and at most a byte swap.
+//x86_64: mov
+//x86_64 MOVBE: movbe (big endian)
+//ARMv8: ldr, rev (big endian)
+template <typename Integral>
+  inline auto load_le(const void* p) noexcept
+  -> typename std::enable_if<bitops_detail::is_integral<Integral>::value, Integral>::type {
+    Integral x;
+    std::memcpy(&x, p, sizeof(x));
+#if defined(BITOPS_BIG_ENDIAN)
+    x = reverse_bytes<1>(x);
+#endif
+    return x;
+  }
+
+//Loads a big endian Integral from p, which may have any alignment
+template <typename Integral>
+  inline auto load_be(const void* p) noexcept
+  -> typename std::enable_if<bitops_detail::is_integral<Integral>::value, Integral>::type {
+    Integral x;
+    std::memcpy(&x, p, sizeof(x));
+#if !defined(BITOPS_BIG_ENDIAN)
+    x = reverse_bytes<1>(x);
+#endif
+    return x;
+  }
+
+//Stores x to p in little endian byte order, p may have any alignment
+template <typename Integral>
+  inline auto store_le(void* p, Integral x) noexcept
+  -> typename std::enable_if<bitops_detail::is_integral<Integral>::value>::type {
+#if defined(BITOPS_BIG_ENDIAN)
+    x = reverse_bytes<1>(x);
+#endif
+    std::memcpy(p, &x, sizeof(x));
+  }
+
+//Stores x to p in big endian byte order, p may have any alignment
+template <typename Integral>
+  inline auto store_be(void* p, Integral x) noexcept
+  -> typename std::enable_if<bitops_detail::is_integral<Integral>::value>::type {
+#if !defined(BITOPS_BIG_ENDIAN)
+    x = reverse_bytes<1>(x);
+#endif
+    std::memcpy(p, &x, sizeof(x));
+  }
+
+//Reads fields from a region of memory, such as a mapped file or a packet buffer, without copying it.
+//The read functions are unchecked, the try_read functions fail without moving the cursor
+//when fewer than sizeof(Integral) bytes remain.
+class byte_cursor {
+  public:
+    byte_cursor() noexcept = default;
+    byte_cursor(const void* p, size_t n) noexcept
+      : _p(static_cast<const unsigned char*>(p)), _end(_p + n) {}
+
+    //Current position
+    const unsigned char* data() const noexcept { return _p; }
+
+    //Number of bytes left
+    size_t remaining() const noexcept { return size_t(_end - _p); }
+
+    //Returns true if at least n bytes are left
+    bool has(size_t n) const noexcept { return remaining() >= n; }
+
+    //Advances by n bytes, undefined if n > remaining()
+    void skip(size_t n) noexcept { _p += n; }
+
+    //Returns the field at the current position, undefined if fewer than sizeof(Integral) bytes remain
+    template <typename Integral>
+      Integral peek_le() const noexcept { return load_le<Integral>(_p); }
+    template <typename Integral>
+      Integral peek_be() const noexcept { return load_be<Integral>(_p); }
+
+    //Returns the field at the current position and moves past it,
+    //undefined if fewer than sizeof(Integral) bytes remain
+    template <typename Integral>
+      Integral read_le() noexcept {
+        Integral x = load_le<Integral>(_p);
+        _p += sizeof(x);
+        return x;
+      }
+    template <typename Integral>
+      Integral read_be() noexcept {
+        Integral x = load_be<Integral>(_p);
+        _p += sizeof(x);
+        return x;
+      }
+
+    //Stores the field at the current position in x and moves past it,
+    //returns false and leaves x and the cursor unchanged if fewer than sizeof(Integral) bytes remain
+    template <typename Integral>
+      bool try_read_le(Integral& x) noexcept {
+        if(!has(sizeof(x))) {
+          return false;
+        }
+        x = read_le<Integral>();
+        return true;
+      }
+    template <typename Integral>
+      bool try_read_be(Integral& x) noexcept {
+        if(!has(sizeof(x))) {
+          return false;
+        }
+        x = read_be<Integral>();
+        return true;
+      }
+
+  private:
+    const unsigned char* _p = nullptr;
+    const unsigned char* _end = nullptr;
+};
+
 } //namespace std
 
 #endif
@@ -0,0 +1,212 @@
+#ifndef BUDDY_ALLOCATOR_HH
+#define BUDDY_ALLOCATOR_HH
+
+#include "bitops.hh"
+
+#include <cstdint>
+#include <cstddef>
+
+namespace std {
+
+////////////////////////////////////
+//Buddy allocator
+////////////////////////////////////
+
+//Binary buddy allocator over a caller owned region of memory, such as a pre-registered DMA region.
+//Blocks are min_block << k bytes for order k. A block of order k at offset o from the base
+//has its buddy at flipbit(o, log2(min_block) + k), the two merge into the block of order k + 1
+//at rstbit(o, log2(min_block) + k) when both are free.
+//
+//The free blocks of each order are kept in a bitmap with summary levels like summary_bitmap:
+//bit j of level l + 1 is set when word j of level l is non zero, up to a top level of a single word.
+//The lowest free block is found with one cntt0 per level, so allocation and free are O(orders * levels),
+//4 levels for 10^7 blocks, however the free blocks are spread. Neither allocates: the bitmaps are
+//stored in caller provided memory of metadata_words() words.
+//Blocks are aligned to their size relative to the base.
+class buddy_allocator {
+  public:
+    static constexpr int max_orders = 64;
+
+    //Number of uint64_t needed for the bitmaps and their summaries of a region of capacity bytes
+    static constexpr14 size_t metadata_words(size_t capacity, size_t min_block) noexcept {
+      size_t words = 0;
+      for(size_t blocks = capacity / min_block; blocks != 0; blocks /= 2) {
+        size_t n = blocks;
+        do {
+          n = (n + 63) / 64;
+          words += n;
+        } while(n > 1);
+      }
+      return words;
+    }
+
+    buddy_allocator() noexcept = default;
+
+    //Manages the capacity bytes at base in blocks of at least min_block bytes, min_block must be a power of 2.
+    //meta must hold metadata_words(capacity, min_block) words and outlive the allocator.
+    //Any bytes past the last multiple of min_block are not used.
+    buddy_allocator(void* base, size_t capacity, size_t min_block, uint64_t* meta) noexcept
+      : _base(static_cast<char*>(base)), _min_shift(cntt0(min_block)) {
+        size_t blocks = capacity / min_block;
+        for(_orders = 0; blocks != 0; ++_orders, blocks /= 2) {
+          _free[_orders] = meta;
+          _nblocks[_orders] = blocks;
+          _count[_orders] = 0;
+          _levels[_orders] = 0;
+          size_t n = blocks;
+          do {
+            n = (n + 63) / 64;
+            for(size_t w = 0; w < n; ++w) {
+              meta[w] = 0;
+            }
+            meta += n;
+            ++_levels[_orders];
+          } while(n > 1);
+          _top[_orders] = meta - 1;
+        }
+        _capacity = (capacity / min_block) << _min_shift;
+
+        //Cover the region with the largest aligned blocks which fit
+        for(size_t off = 0; off < _capacity;) {
+          int k = _orders - 1;
+          while(!is_aligned(off, shll(size_t(1), _min_shift + k)) || off + block(k) > _capacity) {
+            --k;
+          }
+          insert(k, off >> (_min_shift + k));
+          off += block(k);
+        }
+        _available = _capacity;
+      }
+
+    //Number of bytes managed
+    size_t capacity() const noexcept { return _capacity; }
+
+    //Number of bytes in free blocks
+    size_t available() const noexcept { return _available; }
+
+    //Size of the smallest block
+    size_t min_block() const noexcept { return block(0); }
+
+    //Size of the largest block, 0 if the region is smaller than min_block
+    size_t max_block() const noexcept { return _orders == 0 ? 0 : block(_orders - 1); }
+
+    //Size of the block which allocate(n) returns
+    size_t block_size(size_t n) const noexcept {
+      return block(order(n));
+    }
+
+    //Returns a block of block_size(n) bytes, nullptr if there is no free block large enough
+    void* allocate(size_t n) noexcept {
+      int k = order(n);
+      int j = k;
+      while(j < _orders && _count[j] == 0) {
+        ++j;
+      }
+      if(j >= _orders) {
+        return nullptr;
+      }
+      size_t i = take(j);
+      //Split down to order k, the upper half stays free at each order
+      for(; j > k; --j) {
+        i *= 2;
+        insert(j - 1, i + 1);
+      }
+      _available -= block(k);
+      return _base + (i << (_min_shift + k));
+    }
+
+    //Frees p, which was returned by allocate(n), merging it with its free buddies
+    void deallocate(void* p, size_t n) noexcept {
+      int k = order(n);
+      _available += block(k);
+      size_t off = size_t(static_cast<char*>(p) - _base);
+      for(; k + 1 < _orders; ++k) {
+        size_t buddy = flipbit(off, _min_shift + k) >> (_min_shift + k);
+        if(buddy >= _nblocks[k] || !testbit(_free[k][buddy / 64], int(buddy % 64))) {
+          break;
+        }
+        remove(k, buddy);
+        off = rstbit(off, _min_shift + k);
+      }
+      insert(k, off >> (_min_shift + k));
+    }
+
+  private:
+    size_t block(int k) const noexcept {
+      return shll(size_t(1), _min_shift + k);
+    }
+
+    //Order of the smallest block holding n bytes, ceil(log2(n)) - log2(min_block)
+    //x86_64 LZCNT
+    int order(size_t n) const noexcept {
+      return n <= block(0) ? 0 : int(sizeof(size_t) * CHAR_BIT) - cntl0(n - 1) - _min_shift;
+    }
+
+    //Number of words in level l of the bitmap of order k, the shift is split so that l = 10 is defined
+    size_t level_words(int k, int l) const noexcept {
+      return shlr(shlr(_nblocks[k] - 1, 6 * l), 6) + 1;
+    }
+
+    //Marks block i of order k free, going up the summary levels while the word set was zero
+    void insert(int k, size_t i) noexcept {
+      ++_count[k];
+      uint64_t* words = _free[k];
+      size_t n = (_nblocks[k] + 63) / 64;
+      for(int l = 0; l < _levels[k]; ++l, i /= 64) {
+        uint64_t w = words[i / 64];
+        words[i / 64] = setbit(w, int(i % 64));
+        if(w != 0) {
+          break;
+        }
+        words += n;
+        n = (n + 63) / 64;
+      }
+    }
+
+    //Marks block i of order k used, going up the summary levels while the word cleared becomes zero
+    void remove(int k, size_t i) noexcept {
+      --_count[k];
+      uint64_t* words = _free[k];
+      size_t n = (_nblocks[k] + 63) / 64;
+      for(int l = 0; l < _levels[k]; ++l, i /= 64) {
+        uint64_t w = rstbit(words[i / 64], int(i % 64));
+        words[i / 64] = w;
+        if(w != 0) {
+          break;
+        }
+        words += n;
+        n = (n + 63) / 64;
+      }
+    }
+
+    //Removes and returns the lowest free block of order k, which must have one.
+    //Goes down from the top word of the summary levels, which follow the bitmap.
+    //x86_64 BMI: TZCNT
+    size_t take(int k) noexcept {
+      const uint64_t* words = _top[k];
+      size_t i = size_t(cntt0(words[0]));
+      for(int l = _levels[k] - 1; l > 0; --l) {
+        words -= level_words(k, l - 1);
+        i = i * 64 + size_t(cntt0(words[i]));
+      }
+      remove(k, i);
+      return i;
+    }
+
+    char* _base = nullptr;
+    size_t _capacity = 0;
+    size_t _available = 0;
+    int _min_shift = 0;
+    int _orders = 0;
+    //Per order: free bitmap followed by its summary levels, top summary word, number of levels, number of blocks
+    //and number of free blocks
+    uint64_t* _free[max_orders] = {};
+    uint64_t* _top[max_orders] = {};
+    int _levels[max_orders] = {};
+    size_t _nblocks[max_orders] = {};
+    size_t _count[max_orders] = {};
+};
+
+} //namespace std
+
+#endif
@@ -0,0 +1,715 @@
+#ifndef BYTE_SCAN_HH
+#define BYTE_SCAN_HH
+
+#include "bitops.hh"
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace std {
+
+////////////////////////////////////
+//Byte scanning
+////////////////////////////////////
+
+//Each vector of bytes is compared at once, movemask turns the compare into a bit per byte and
+//cntt0 or ilog2 (cntl0) of the bits gives the first or last match, as in the strlen application of cntt0.
+//A scan reads its first vector at the start of the range, or for scan_memrchr the one which ends it,
+//when that stays in one page, else the aligned vector which holds that byte with the bytes out of the
+//range masked out of the bits. The following loads are aligned with align_down, so they never cross into
+//another page even when they read bytes outside of the range, which are never returned. After 3 single
+//vectors, which keep short scans short, the scan compares 4 vectors per step, tests the or of the compares
+//and only locates the match in the step which has one.
+//The 16 byte kernels are compiled for SSSE3, which the byte set lookup needs. AVX-512BW compares give
+//the bits in a mask register without movemask.
+
+//A set of bytes to scan for with scan_first_of
+class byte_set {
+  public:
+    byte_set() noexcept = default;
+
+    //The n bytes at p
+    byte_set(const void* p, size_t n) noexcept {
+      for(size_t i = 0; i < n; ++i) {
+        set(static_cast<const unsigned char*>(p)[i]);
+      }
+    }
+
+    //The bytes of the null terminated string s
+    byte_set(const char* s) noexcept : byte_set(s, std::strlen(s)) {}
+
+    void set(unsigned char c) noexcept {
+      _bits[c / 64] = std::setbit(_bits[c / 64], c % 64);
+      _nibbles[(c & 0x0F) + (c & 0x80 ? 16 : 0)] |= (unsigned char)(1u << ((c >> 4) & 7));
+      unsigned char& d = _direct[c & 0x0F];
+      _direct_ok = _direct_ok && c < 0x80 && (d == c || (d & 0x0F) != (c & 0x0F));
+      d = c;
+    }
+
+    bool test(unsigned char c) const noexcept { return testbit(_bits[c / 64], c % 64); }
+
+    //Bit (c >> 4) & 7 of entry c & 0x0F, or of entry 16 + (c & 0x0F) if c >= 0x80, is set when c is in the set.
+    //The vector kernels look up both nibbles of 16 or 32 bytes at once with pshufb.
+    const unsigned char* nibble_table() const noexcept { return _nibbles; }
+
+    //When the bytes of the set are < 0x80 and no two have the same low nibble, entry c & 0x0F is c for each c in the set
+    //and the other entries are bytes of another low nibble, else nullptr. A byte is then in the set when the pshufb of
+    //it equals it, a match as short as that of a single byte. Delimiters such as " ,=\t" often are such a set.
+    const unsigned char* direct_table() const noexcept { return _direct_ok ? _direct : nullptr; }
+
+  private:
+    uint64_t _bits[4] = {};
+    unsigned char _nibbles[32] = {};
+    unsigned char _direct[16] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 0};
+    bool _direct_ok = true;
+};
+
+//The kernels read outside of the range, within its pages, which AddressSanitizer reports
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define BITOPS_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#endif
+#endif
+#if !defined(BITOPS_NO_SANITIZE_ADDRESS) && defined(__SANITIZE_ADDRESS__)
+#define BITOPS_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#endif
+#if !defined(BITOPS_NO_SANITIZE_ADDRESS)
+#define BITOPS_NO_SANITIZE_ADDRESS
+#endif
+
+namespace bitops_detail {
+
+template <typename T>
+  inline const T* align_down_ptr(const T* p, size_t a) noexcept {
+    return reinterpret_cast<const T*>(align_down(uintptr_t(p), a));
+  }
+
+inline bool has_avx512bw() noexcept {
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+  return true;
+#else
+  return cpu().avx512bw;
+#endif
+}
+
+//p + i if i is in the n bytes at p. Returning the byte found lets the scan functions tail call the kernels.
+inline const unsigned char* first_in(const unsigned char* p, size_t i, size_t n) noexcept {
+  return i < n ? p + i : nullptr;
+}
+
+#if defined(BITOPS_RUNTIME_DISPATCH)
+//Matchers compare the bytes of the vector at p, giving 0xFF for each byte which matches,
+//or with AVX-512 the bit of each byte which matches in a mask register
+struct match_byte_ssse3 {
+  __m128i c;
+  BITOPS_TARGET("ssse3") explicit match_byte_ssse3(unsigned char x) noexcept : c(_mm_set1_epi8(char(x))) {}
+  BITOPS_TARGET("ssse3") BITOPS_NO_SANITIZE_ADDRESS __m128i operator()(const unsigned char* p) const noexcept {
+    return _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), c);
+  }
+};
+
+struct match_byte_avx2 {
+  __m256i c;
+  BITOPS_TARGET("avx2") explicit match_byte_avx2(unsigned char x) noexcept : c(_mm256_set1_epi8(char(x))) {}
+  BITOPS_TARGET("avx2") BITOPS_NO_SANITIZE_ADDRESS __m256i operator()(const unsigned char* p) const noexcept {
+    return _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), c);
+  }
+};
+
+//The AVX-512 matchers carry the AVX2 one for the first 32 bytes of a scan, see find_first_avx512
+struct match_byte_avx512 {
+  match_byte_avx2 head;
+  __m512i c;
+  BITOPS_TARGET("avx512f,avx512bw") explicit match_byte_avx512(unsigned char x) noexcept : head(x), c(_mm512_set1_epi8(char(x))) {}
+  BITOPS_TARGET("avx512f,avx512bw") BITOPS_NO_SANITIZE_ADDRESS uint64_t operator()(const unsigned char* p) const noexcept {
+    return _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(p), c);
+  }
+};
+
+//Looks up the row of the low nibble in the table for bytes < 0x80 or >= 0x80, pshufb gives 0 for
+//indices with bit 7 set, and tests the bit of the high nibble in it (Wojciech Mula, SIMD byte lookup)
+struct match_set_ssse3 {
+  __m128i lo, hi, bit;
+  BITOPS_TARGET("ssse3") explicit match_set_ssse3(const byte_set& s) noexcept
+    : lo(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s.nibble_table()))),
+    hi(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s.nibble_table() + 16))),
+    bit(_mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128)) {}
+  BITOPS_TARGET("ssse3") BITOPS_NO_SANITIZE_ADDRESS __m128i operator()(const unsigned char* p) const noexcept {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i row = _mm_or_si128(_mm_shuffle_epi8(lo, v), _mm_shuffle_epi8(hi, _mm_xor_si128(v, _mm_set1_epi8(-128))));
+    __m128i b = _mm_shuffle_epi8(bit, _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F)));
+    return _mm_cmpeq_epi8(_mm_and_si128(row, b), b);
+  }
+};
+
+struct match_set_avx2 {
+  __m256i lo, hi, bit;
+  BITOPS_TARGET("avx2") explicit match_set_avx2(const byte_set& s) noexcept
+    : lo(_mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s.nibble_table())))),
+    hi(_mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s.nibble_table() + 16)))),
+    bit(_mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+          1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128)) {}
+  BITOPS_TARGET("avx2") BITOPS_NO_SANITIZE_ADDRESS __m256i operator()(const unsigned char* p) const noexcept {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i row = _mm256_or_si256(_mm256_shuffle_epi8(lo, v), _mm256_shuffle_epi8(hi, _mm256_xor_si256(v, _mm256_set1_epi8(-128))));
+    __m256i b = _mm256_shuffle_epi8(bit, _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F)));
+    return _mm256_cmpeq_epi8(_mm256_and_si256(row, b), b);
+  }
+};
+
+//The 16 bytes at t in each lane. gcc 12 warns of the undefined vector which the unmasked
+//_mm512_broadcast_i32x4 passes to the builtin, the zero masked one has none.
+BITOPS_TARGET("avx512f,avx512bw") inline __m512i broadcast_lane(const unsigned char* t) noexcept {
+  return _mm512_maskz_broadcast_i32x4(__mmask16(0xFFFF), _mm_loadu_si128(reinterpret_cast<const __m128i*>(t)));
+}
+
+//The bit of the high nibble has one bit set, so the test of the row against it is the match
+struct match_set_avx512 {
+  match_set_avx2 head;
+  __m512i lo, hi, bit;
+  BITOPS_TARGET("avx512f,avx512bw") explicit match_set_avx512(const byte_set& s) noexcept
+    : head(s), lo(broadcast_lane(s.nibble_table())), hi(broadcast_lane(s.nibble_table() + 16)),
+    bit(_mm512_set1_epi64(int64_t(0x8040201008040201ULL))) {}
+  BITOPS_TARGET("avx512f,avx512bw") BITOPS_NO_SANITIZE_ADDRESS uint64_t operator()(const unsigned char* p) const noexcept {
+    __m512i v = _mm512_loadu_si512(p);
+    __m512i row = _mm512_or_si512(_mm512_shuffle_epi8(lo, v), _mm512_shuffle_epi8(hi, _mm512_xor_si512(v, _mm512_set1_epi8(-128))));
+    __m512i b = _mm512_shuffle_epi8(bit, _mm512_and_si512(_mm512_srli_epi16(v, 4), _mm512_set1_epi8(0x0F)));
+    return _mm512_test_epi8_mask(row, b);
+  }
+};
+
+//Sets with a byte_set::direct_table, pshufb gives 0 for bytes >= 0x80, which are not 0 and not in the set
+struct match_direct_ssse3 {
+  __m128i t;
+  BITOPS_TARGET("ssse3") explicit match_direct_ssse3(const byte_set& s) noexcept
+    : t(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s.direct_table()))) {}
+  BITOPS_TARGET("ssse3") BITOPS_NO_SANITIZE_ADDRESS __m128i operator()(const unsigned char* p) const noexcept {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    return _mm_cmpeq_epi8(_mm_shuffle_epi8(t, v), v);
+  }
+};
+
+struct match_direct_avx2 {
+  __m256i t;
+  BITOPS_TARGET("avx2") explicit match_direct_avx2(const byte_set& s) noexcept
+    : t(_mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s.direct_table())))) {}
+  BITOPS_TARGET("avx2") BITOPS_NO_SANITIZE_ADDRESS __m256i operator()(const unsigned char* p) const noexcept {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    return _mm256_cmpeq_epi8(_mm256_shuffle_epi8(t, v), v);
+  }
+};
+
+struct match_direct_avx512 {
+  match_direct_avx2 head;
+  __m512i t;
+  BITOPS_TARGET("avx512f,avx512bw") explicit match_direct_avx512(const byte_set& s) noexcept
+    : head(s), t(broadcast_lane(s.direct_table())) {}
+  BITOPS_TARGET("avx512f,avx512bw") BITOPS_NO_SANITIZE_ADDRESS uint64_t operator()(const unsigned char* p) const noexcept {
+    __m512i v = _mm512_loadu_si512(p);
+    return _mm512_cmpeq_epi8_mask(_mm512_shuffle_epi8(t, v), v);
+  }
+};
+
+BITOPS_TARGET("ssse3") inline uint32_t match_bits(__m128i v) noexcept {
+  return uint32_t(_mm_movemask_epi8(v));
+}
+
+BITOPS_TARGET("avx2") inline uint32_t match_bits(__m256i v) noexcept {
+  return uint32_t(_mm256_movemask_epi8(v));
+}
+
+//Whether the w bytes at p are in one page, so that they can be read past the end of the range
+inline bool in_page(const unsigned char* p, size_t w) noexcept {
+  return (uintptr_t(p) & 4095) <= 4096 - w;
+}
+
+//The vector of w bytes which ends at e, which can start before the range
+inline const unsigned char* vector_before(const unsigned char* e, size_t w) noexcept {
+  return reinterpret_cast<const unsigned char*>(uintptr_t(e) - w);
+}
+
+//The address past the n bytes at p, or the last address when n runs past it, as it does for SIZE_MAX
+inline uintptr_t range_end(const unsigned char* p, size_t n) noexcept {
+  return n < UINTPTR_MAX - uintptr_t(p) ? uintptr_t(p) + n : UINTPTR_MAX;
+}
+
+//m without the bits of the k bytes before the range, for a vector which starts k bytes before p
+inline uint64_t skip_bytes(uint64_t m, ptrdiff_t k) noexcept {
+  return k <= 0 ? m : k >= 64 ? 0 : m >> k << k;
+}
+
+//The kernels read bytes outside of the object at p. Once a scan of an array is inlined the compiler
+//must not know the object, gcc warns of the reads and could assume they do not happen.
+inline const unsigned char* unknown_object(const unsigned char* p) noexcept {
+  __asm__("" : "+r"(p));
+  return p;
+}
+
+//The first byte of the n at p which matches, or nullptr. n may be SIZE_MAX for a range ended by a match.
+//The first vector is read at p unless it crosses a page, a match close to p is then found with one compare.
+//The next 3 aligned vectors are compared one at a time, written out so that each has its own branches, then
+//4 vectors at a time from a boundary of 4 vectors, which may compare up to 3 of them again. Where the 4 vectors
+//start does not depend on p, so their branches predict well. 4 vectors are in the same page, their compares
+//are or'ed together, leaving one test per 4 vectors.
+//The matcher is made from arg here, where it is kept in registers. arg is the byte, passed by value so that
+//the scan functions tail call the kernel, or a const byte_set&.
+template <typename Match, typename Arg>
+  BITOPS_TARGET("ssse3") BITOPS_NO_SANITIZE_ADDRESS
+  inline const unsigned char* find_first_ssse3(const unsigned char* p, size_t n, Arg arg) noexcept {
+    p = unknown_object(p);
+    const Match match(arg);
+    const uintptr_t end = range_end(p, n);
+    const unsigned char* a = align_down_ptr(p, 16);
+    uint32_t m = in_page(p, 16) ? match_bits(match(p)) : shlr(match_bits(match(a)), int(p - a));
+    if(m != 0) {
+      //A match in the first vector is in the range unless the range is shorter
+      return n >= 16 ? p + unsigned(cntt0(m)) : first_in(p, unsigned(cntt0(m)), n);
+    }
+    if(uintptr_t(a + 16) >= end) {
+      return nullptr;
+    }
+    if((m = match_bits(match(a + 16))) != 0) {
+      return first_in(p, size_t(a + 16 - p) + unsigned(cntt0(m)), n);
+    }
+    if(uintptr_t(a + 32) >= end) {
+      return nullptr;
+    }
+    if((m = match_bits(match(a + 32))) != 0) {
+      return first_in(p, size_t(a + 32 - p) + unsigned(cntt0(m)), n);
+    }
+    if(uintptr_t(a + 48) >= end) {
+      return nullptr;
+    }
+    if((m = match_bits(match(a + 48))) != 0) {
+      return first_in(p, size_t(a + 48 - p) + unsigned(cntt0(m)), n);
+    }
+    for(a = align_down_ptr(a + 64, 64);; a += 64) {
+      if(uintptr_t(a) >= end) {
+        return nullptr;
+      }
+      __m128i v0 = match(a), v1 = match(a + 16), v2 = match(a + 32), v3 = match(a + 48);
+      if(match_bits(_mm_or_si128(_mm_or_si128(v0, v1), _mm_or_si128(v2, v3))) != 0) {
+        uint64_t m4 = match_bits(v0) | shll(uint64_t(match_bits(v1)), 16) |
+          shll(uint64_t(match_bits(v2)), 32) | shll(uint64_t(match_bits(v3)), 48);
+        return first_in(p, size_t(a - p) + unsigned(cntt0(m4)), n);
+      }
+    }
+  }
+
+//The last byte of the n at p which matches, or nullptr. n must not be 0.
+//The first vector is the one which ends the range, read unaligned unless that crosses a page, so a range
+//of up to one vector takes a compare and no branch on where p is. When 3 more aligned vectors are in the
+//range they are compared one at a time, written out and with no bytes before p to skip, then 4 at a time
+//from a boundary of 4 vectors while they are all in the range, which may compare up to 3 of them again,
+//then single vectors down to p. A shorter range takes those last ones.
+template <typename Match, typename Arg>
+  BITOPS_TARGET("ssse3") BITOPS_NO_SANITIZE_ADDRESS
+  inline const unsigned char* find_last_ssse3(const unsigned char* p, size_t n, Arg arg) noexcept {
+    p = unknown_object(p);
+    const Match match(arg);
+    const unsigned char* e = p + n;
+    const unsigned char* a = align_down_ptr(e - 1, 16);
+    uint64_t m;
+    if(in_page(vector_before(e, 16), 16)) {
+      const unsigned k = n < 16 ? unsigned(16 - n) : 0;
+      if((m = uint64_t(match_bits(match(vector_before(e, 16)))) >> k << k) != 0) {
+        return vector_before(e, 16) + ilog2(m);
+      }
+      if(n <= 16) {
+        return nullptr;
+      }
+    } else {
+      if((m = skip_bytes(rstbitsge(uint64_t(match_bits(match(a))), int(e - a)), p - a)) != 0) {
+        return a + ilog2(m);
+      }
+      if(a <= p) {
+        return nullptr;
+      }
+    }
+    if(size_t(a - p) < 48) {
+      while(a > p) {
+        a -= 16;
+        if((m = skip_bytes(match_bits(match(a)), p - a)) != 0) {
+          return a + ilog2(m);
+        }
+      }
+      return nullptr;
+    }
+    if((m = match_bits(match(a - 16))) != 0) {
+      return a - 16 + ilog2(m);
+    }
+    if((m = match_bits(match(a - 32))) != 0) {
+      return a - 32 + ilog2(m);
+    }
+    if((m = match_bits(match(a - 48))) != 0) {
+      return a - 48 + ilog2(m);
+    }
+    for(a = align_down_ptr(a, 64); size_t(a - p) >= 64; a -= 64) {
+      __m128i v0 = match(a - 64), v1 = match(a - 48), v2 = match(a - 32), v3 = match(a - 16);
+      if(match_bits(_mm_or_si128(_mm_or_si128(v0, v1), _mm_or_si128(v2, v3))) != 0) {
+        uint64_t m4 = match_bits(v0) | shll(uint64_t(match_bits(v1)), 16) |
+          shll(uint64_t(match_bits(v2)), 32) | shll(uint64_t(match_bits(v3)), 48);
+        return a - 64 + ilog2(m4);
+      }
+    }
+    while(a > p) {
+      a -= 16;
+      if((m = skip_bytes(match_bits(match(a)), p - a)) != 0) {
+        return a + ilog2(m);
+      }
+    }
+    return nullptr;
+  }
+
+template <typename Match, typename Arg>
+  BITOPS_TARGET("avx2") BITOPS_NO_SANITIZE_ADDRESS
+  inline const unsigned char* find_first_avx2(const unsigned char* p, size_t n, Arg arg) noexcept {
+    p = unknown_object(p);
+    const Match match(arg);
+    const uintptr_t end = range_end(p, n);
+    const unsigned char* a = align_down_ptr(p, 32);
+    uint32_t m = in_page(p, 32) ? match_bits(match(p)) : shlr(match_bits(match(a)), int(p - a));
+    if(m != 0) {
+      return n >= 32 ? p + unsigned(cntt0(m)) : first_in(p, unsigned(cntt0(m)), n);
+    }
+    if(uintptr_t(a + 32) >= end) {
+      return nullptr;
+    }
+    if((m = match_bits(match(a + 32))) != 0) {
+      return first_in(p, size_t(a + 32 - p) + unsigned(cntt0(m)), n);
+    }
+    if(uintptr_t(a + 64) >= end) {
+      return nullptr;
+    }
+    if((m = match_bits(match(a + 64))) != 0) {
+      return first_in(p, size_t(a + 64 - p) + unsigned(cntt0(m)), n);
+    }
+    if(uintptr_t(a + 96) >= end) {
+      return nullptr;
+    }
+    if((m = match_bits(match(a + 96))) != 0) {
+      return first_in(p, size_t(a + 96 - p) + unsigned(cntt0(m)), n);
+    }
+    for(a = align_down_ptr(a + 128, 128);; a += 128) {
+      if(uintptr_t(a) >= end) {
+        return nullptr;
+      }
+      __m256i v0 = match(a), v1 = match(a + 32), v2 = match(a + 64), v3 = match(a + 96);
+      if(match_bits(_mm256_or_si256(_mm256_or_si256(v0, v1), _mm256_or_si256(v2, v3))) != 0) {
+        uint64_t lo = match_bits(v0) | shll(uint64_t(match_bits(v1)), 32);
+        if(lo != 0) {
+          return first_in(p, size_t(a - p) + unsigned(cntt0(lo)), n);
+        }
+        uint64_t hi = match_bits(v2) | shll(uint64_t(match_bits(v3)), 32);
+        return first_in(p, size_t(a - p) + 64 + unsigned(cntt0(hi)), n);
+      }
+    }
+  }
+
+template <typename Match, typename Arg>
+  BITOPS_TARGET("avx2") BITOPS_NO_SANITIZE_ADDRESS
+  inline const unsigned char* find_last_avx2(const unsigned char* p, size_t n, Arg arg) noexcept {
+    p = unknown_object(p);
+    const Match match(arg);
+    const unsigned char* e = p + n;
+    const unsigned char* a = align_down_ptr(e - 1, 32);
+    uint64_t m;
+    if(in_page(vector_before(e, 32), 32)) {
+      const unsigned k = n < 32 ? unsigned(32 - n) : 0;
+      if((m = uint64_t(match_bits(match(vector_before(e, 32)))) >> k << k) != 0) {
+        return vector_before(e, 32) + ilog2(m);
+      }
+      if(n <= 32) {
+        return nullptr;
+      }
+    } else {
+      if((m = skip_bytes(rstbitsge(uint64_t(match_bits(match(a))), int(e - a)), p - a)) != 0) {
+        return a + ilog2(m);
+      }
+      if(a <= p) {
+        return nullptr;
+      }
+    }
+    if(size_t(a - p) < 96) {
+      while(a > p) {
+        a -= 32;
+        if((m = skip_bytes(match_bits(match(a)), p - a)) != 0) {
+          return a + ilog2(m);
+        }
+      }
+      return nullptr;
+    }
+    if((m = match_bits(match(a - 32))) != 0) {
+      return a - 32 + ilog2(m);
+    }
+    if((m = match_bits(match(a - 64))) != 0) {
+      return a - 64 + ilog2(m);
+    }
+    if((m = match_bits(match(a - 96))) != 0) {
+      return a - 96 + ilog2(m);
+    }
+    for(a = align_down_ptr(a, 128); size_t(a - p) >= 128; a -= 128) {
+      __m256i v0 = match(a - 128), v1 = match(a - 96), v2 = match(a - 64), v3 = match(a - 32);
+      if(match_bits(_mm256_or_si256(_mm256_or_si256(v0, v1), _mm256_or_si256(v2, v3))) != 0) {
+        uint64_t hi = match_bits(v2) | shll(uint64_t(match_bits(v3)), 32);
+        if(hi != 0) {
+          return a - 64 + ilog2(hi);
+        }
+        uint64_t lo = match_bits(v0) | shll(uint64_t(match_bits(v1)), 32);
+        return a - 128 + ilog2(lo);
+      }
+    }
+    while(a > p) {
+      a -= 32;
+      if((m = skip_bytes(match_bits(match(a)), p - a)) != 0) {
+        return a + ilog2(m);
+      }
+    }
+    return nullptr;
+  }
+
+//The masks of 64 byte vectors need no movemask. Up to the blocks the vectors are those of find_first_avx2,
+//a 64 byte load at p would nearly always split a cache line and delay the matches close to p.
+//The blocks are aligned to 256 bytes, so the first can start before p, its bytes there are skipped.
+template <typename Match, typename Arg>
+  BITOPS_TARGET("avx512f,avx512bw") BITOPS_NO_SANITIZE_ADDRESS
+  inline const unsigned char* find_first_avx512(const unsigned char* p, size_t n, Arg arg) noexcept {
+    p = unknown_object(p);
+    const Match match(arg);
+    const uintptr_t end = range_end(p, n);
+    const unsigned char* a = align_down_ptr(p, 32);
+    uint32_t h = in_page(p, 32) ? match_bits(match.head(p)) : shlr(match_bits(match.head(a)), int(p - a));
+    if(h != 0) {
+      return n >= 32 ? p + unsigned(cntt0(h)) : first_in(p, unsigned(cntt0(h)), n);
+    }
+    if(uintptr_t(a + 32) >= end) {
+      return nullptr;
+    }
+    if((h = match_bits(match.head(a + 32))) != 0) {
+      return first_in(p, size_t(a + 32 - p) + unsigned(cntt0(h)), n);
+    }
+    if(uintptr_t(a + 64) >= end) {
+      return nullptr;
+    }
+    if((h = match_bits(match.head(a + 64))) != 0) {
+      return first_in(p, size_t(a + 64 - p) + unsigned(cntt0(h)), n);
+    }
+    if(uintptr_t(a + 96) >= end) {
+      return nullptr;
+    }
+    if((h = match_bits(match.head(a + 96))) != 0) {
+      return first_in(p, size_t(a + 96 - p) + unsigned(cntt0(h)), n);
+    }
+    for(a = align_down_ptr(a + 128, 256);; a += 256) {
+      if(uintptr_t(a) >= end) {
+        return nullptr;
+      }
+      uint64_t m0 = match(a), m1 = match(a + 64), m2 = match(a + 128), m3 = match(a + 192);
+      if((m0 | m1 | m2 | m3) != 0) {
+        if(a < p) {
+          const ptrdiff_t k = p - a;
+          m0 = skip_bytes(m0, k); m1 = skip_bytes(m1, k - 64); m2 = skip_bytes(m2, k - 128); m3 = skip_bytes(m3, k - 192);
+          if((m0 | m1 | m2 | m3) == 0) {
+            continue;
+          }
+        }
+        size_t i = m0 != 0 ? unsigned(cntt0(m0)) : m1 != 0 ? 64 + unsigned(cntt0(m1)) :
+          m2 != 0 ? 128 + unsigned(cntt0(m2)) : 192 + unsigned(cntt0(m3));
+        return first_in(p, size_t(a - p) + i, n);
+      }
+    }
+  }
+
+
+//Like in find_first_avx512 the vectors up to the blocks are those of find_last_avx2, 32 bytes matched
+//with AVX2. The blocks are of aligned 64 byte vectors.
+template <typename Match, typename Arg>
+  BITOPS_TARGET("avx512f,avx512bw") BITOPS_NO_SANITIZE_ADDRESS
+  inline const unsigned char* find_last_avx512(const unsigned char* p, size_t n, Arg arg) noexcept {
+    p = unknown_object(p);
+    const Match match(arg);
+    const unsigned char* e = p + n;
+    const unsigned char* a = align_down_ptr(e - 1, 32);
+    uint64_t m;
+    if(in_page(vector_before(e, 32), 32)) {
+      const unsigned k = n < 32 ? unsigned(32 - n) : 0;
+      if((m = uint64_t(match_bits(match.head(vector_before(e, 32)))) >> k << k) != 0) {
+        return vector_before(e, 32) + ilog2(m);
+      }
+      if(n <= 32) {
+        return nullptr;
+      }
+    } else {
+      if((m = skip_bytes(rstbitsge(uint64_t(match_bits(match.head(a))), int(e - a)), p - a)) != 0) {
+        return a + ilog2(m);
+      }
+      if(a <= p) {
+        return nullptr;
+      }
+    }
+    if(size_t(a - p) < 96) {
+      while(a > p) {
+        a -= 32;
+        if((m = skip_bytes(match_bits(match.head(a)), p - a)) != 0) {
+          return a + ilog2(m);
+        }
+      }
+      return nullptr;
+    }
+    if((m = match_bits(match.head(a - 32))) != 0) {
+      return a - 32 + ilog2(m);
+    }
+    if((m = match_bits(match.head(a - 64))) != 0) {
+      return a - 64 + ilog2(m);
+    }
+    if((m = match_bits(match.head(a - 96))) != 0) {
+      return a - 96 + ilog2(m);
+    }
+    for(a = align_down_ptr(a - 32, 64); size_t(a - p) >= 256; a -= 256) {
+      uint64_t m0 = match(a - 256), m1 = match(a - 192), m2 = match(a - 128), m3 = match(a - 64);
+      if((m0 | m1 | m2 | m3) != 0) {
+        return m3 != 0 ? a - 64 + ilog2(m3) : m2 != 0 ? a - 128 + ilog2(m2) :
+          m1 != 0 ? a - 192 + ilog2(m1) : a - 256 + ilog2(m0);
+      }
+    }
+    while(a > p) {
+      a -= 64;
+      if((m = skip_bytes(match(a), p - a)) != 0) {
+        return a + ilog2(m);
+      }
+    }
+    return nullptr;
+  }
+#endif
+
+//The first c in the n bytes at p, or nullptr
+inline const unsigned char* scan_first_byte(const unsigned char* p, size_t n, unsigned char c) noexcept {
+  if(n == 0) {
+    return nullptr;
+  }
+#if defined(BITOPS_RUNTIME_DISPATCH)
+  if(has_avx512bw()) {
+    return find_first_avx512<match_byte_avx512>(p, n, c);
+  }
+  if(has_avx2()) {
+    return find_first_avx2<match_byte_avx2>(p, n, c);
+  }
+  if(has_ssse3()) {
+    return find_first_ssse3<match_byte_ssse3>(p, n, c);
+  }
+#endif
+  return static_cast<const unsigned char*>(std::memchr(p, c, n));
+}
+
+//The last c in the n bytes at p, or nullptr
+inline const unsigned char* scan_last_byte(const unsigned char* p, size_t n, unsigned char c) noexcept {
+  if(n == 0) {
+    return nullptr;
+  }
+#if defined(BITOPS_RUNTIME_DISPATCH)
+  if(has_avx512bw()) {
+    return find_last_avx512<match_byte_avx512>(p, n, c);
+  }
+  if(has_avx2()) {
+    return find_last_avx2<match_byte_avx2>(p, n, c);
+  }
+#endif
+#if defined(__GLIBC__) && defined(_GNU_SOURCE)
+  //The SSE2 memrchr of glibc, its loop is shorter than that of the 16 byte kernel
+  return static_cast<const unsigned char*>(memrchr(p, c, n));
+#else
+#if defined(BITOPS_RUNTIME_DISPATCH)
+  if(has_ssse3()) {
+    return find_last_ssse3<match_byte_ssse3>(p, n, c);
+  }
+#endif
+  for(size_t i = n; i-- > 0;) {
+    if(p[i] == c) {
+      return p + i;
+    }
+  }
+  return nullptr;
+#endif
+}
+
+//The first of the n bytes at p in s, or nullptr
+inline const unsigned char* scan_set(const unsigned char* p, size_t n, const byte_set& s) noexcept {
+  if(n == 0) {
+    return nullptr;
+  }
+#if defined(BITOPS_RUNTIME_DISPATCH)
+  const bool direct = s.direct_table() != nullptr;
+  if(has_avx512bw()) {
+    return direct ? find_first_avx512<match_direct_avx512, const byte_set&>(p, n, s) :
+      find_first_avx512<match_set_avx512, const byte_set&>(p, n, s);
+  }
+  if(has_avx2()) {
+    return direct ? find_first_avx2<match_direct_avx2, const byte_set&>(p, n, s) :
+      find_first_avx2<match_set_avx2, const byte_set&>(p, n, s);
+  }
+  if(has_ssse3()) {
+    return direct ? find_first_ssse3<match_direct_ssse3, const byte_set&>(p, n, s) :
+      find_first_ssse3<match_set_ssse3, const byte_set&>(p, n, s);
+  }
+#endif
+  size_t i = 0;
+  while(i < n && !s.test(p[i])) {
+    ++i;
+  }
+  return first_in(p, i, n);
+}
+
+} //namespace bitops_detail
+
+//Returns the length of the null terminated string s
+//x86_64 SSSE3: pcmpeqb, pmovmskb, tzcnt on 16 bytes at once
+//x86_64 AVX2: 32 bytes at once
+//x86_64 AVX-512BW: vpcmpeqb into a mask on 64 bytes at once
+inline size_t scan_strlen(const char* s) noexcept {
+#if defined(BITOPS_RUNTIME_DISPATCH)
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(s);
+  if(bitops_detail::has_avx512bw()) {
+    return size_t(bitops_detail::find_first_avx512<bitops_detail::match_byte_avx512>(p, SIZE_MAX, 0) - p);
+  }
+  if(bitops_detail::has_avx2()) {
+    return size_t(bitops_detail::find_first_avx2<bitops_detail::match_byte_avx2>(p, SIZE_MAX, 0) - p);
+  }
+  if(bitops_detail::has_ssse3()) {
+    return size_t(bitops_detail::find_first_ssse3<bitops_detail::match_byte_ssse3>(p, SIZE_MAX, 0) - p);
+  }
+#endif
+  return std::strlen(s);
+}
+
+//Returns a pointer to the first byte (unsigned char)c in the n bytes at p, or nullptr, like memchr
+//x86_64 SSSE3: pcmpeqb, pmovmskb, tzcnt on 16 bytes at once
+//x86_64 AVX2: 32 bytes at once
+//x86_64 AVX-512BW: vpcmpeqb into a mask on 64 bytes at once
+//Application: finding delimiters and line ends
+inline const void* scan_memchr(const void* p, int c, size_t n) noexcept {
+  return bitops_detail::scan_first_byte(static_cast<const unsigned char*>(p), n, (unsigned char)c);
+}
+
+//Returns a pointer to the last byte (unsigned char)c in the n bytes at p, or nullptr, like memrchr
+//x86_64 SSSE3: pcmpeqb, pmovmskb, lzcnt on 16 bytes at once, but the memrchr of glibc where there is one
+//x86_64 AVX2: 32 bytes at once
+//x86_64 AVX-512BW: vpcmpeqb into a mask on 64 bytes at once
+//Application: finding the start of the last line or path component
+inline const void* scan_memrchr(const void* p, int c, size_t n) noexcept {
+  return bitops_detail::scan_last_byte(static_cast<const unsigned char*>(p), n, (unsigned char)c);
+}
+
+//Returns a pointer to the first of the n bytes at p which is in set, or nullptr, like strpbrk for spans
+//x86_64 SSSE3: 2 pshufb nibble lookups on 16 bytes at once
+//x86_64 AVX2: 32 bytes at once
+//x86_64 AVX-512BW: 64 bytes at once
+//When no two bytes of the set have the same low nibble and all are < 0x80, one pshufb and a compare per vector
+//Application: tokenizers finding the next of several delimiters, escaping the special characters of JSON
+inline const void* scan_first_of(const void* p, size_t n, const byte_set& set) noexcept {
+  return bitops_detail::scan_set(static_cast<const unsigned char*>(p), n, set);
+}
+
+} //namespace std
+
+#endif
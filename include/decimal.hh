@@ -0,0 +1,158 @@
+#ifndef DECIMAL_HH
+#define DECIMAL_HH
+
+#include "bitops.hh"
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace std {
+
+////////////////////////////////////
+//Decimal integers
+////////////////////////////////////
+
+//The number of decimal digits of x comes from the number of bits given by cntl0:
+//t = (ilog2(x) + 1) * 1233 / 4096 is floor(log10(2^(ilog2(x) + 1))), which is ilog10(x) or one more,
+//so one compare against a table of powers of 10 finds ilog10(x) without a loop of divisions.
+//Knowing the length up front, to_decimal writes the digits backwards from the end, 2 per division by 100.
+
+namespace bitops_detail {
+
+template <typename = void>
+struct decimal_tables {
+  static constexpr uint64_t pow10[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+    1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+    1000000000000000000ULL, 10000000000000000000ULL
+  };
+  //The digits of 0 to 99
+  static constexpr char pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+};
+template <typename T> constexpr uint64_t decimal_tables<T>::pow10[20];
+template <typename T> constexpr char decimal_tables<T>::pairs[201];
+
+inline constexpr14 int ilog10_u64(uint64_t x) noexcept {
+  int t = ((ilog2(x) + 1) * 1233) >> 12;
+  return t - (x < decimal_tables<>::pow10[t]);
+}
+
+//Writes the digits of x ending at end, there are at least 1
+template <typename U>
+  inline void write_decimal(U x, char* end) noexcept {
+    while(x >= 100) {
+      U q = x / 100;
+      end -= 2;
+      std::memcpy(end, decimal_tables<>::pairs + 2 * size_t(x - q * 100), 2);
+      x = q;
+    }
+    if(x >= 10) {
+      std::memcpy(end - 2, decimal_tables<>::pairs + 2 * size_t(x), 2);
+    } else {
+      end[-1] = char('0' + x);
+    }
+  }
+
+//Division of 64 bit values by constants costs a wider multiply than of 32 bit values, so the high digits
+//are split off until the rest fits in 32 bits
+inline void write_decimal(uint64_t x, char* end) noexcept {
+  while(x > UINT32_MAX) {
+    uint64_t q = x / 100;
+    end -= 2;
+    std::memcpy(end, decimal_tables<>::pairs + 2 * size_t(x - q * 100), 2);
+    x = q;
+  }
+  write_decimal(uint32_t(x), end);
+}
+
+#if defined(__SIZEOF_INT128__)
+//Division of 128 bit values is a library call, so the low 19 digits are split off with one division
+//by 10^19 at a time and written as 64 bit values
+inline void write_decimal(unsigned __int128 x, char* end) noexcept {
+  const uint64_t p19 = decimal_tables<>::pow10[19];
+  while(uint64_t(x >> 64) != 0) {
+    unsigned __int128 q = x / p19;
+    uint64_t r = uint64_t(x - q * p19);
+    //Exactly 19 digits with leading zeros
+    for(int i = 0; i < 9; ++i) {
+      uint64_t rq = r / 100;
+      end -= 2;
+      std::memcpy(end, decimal_tables<>::pairs + 2 * size_t(r - rq * 100), 2);
+      r = rq;
+    }
+    *--end = char('0' + r);
+    x = q;
+  }
+  write_decimal(uint64_t(x), end);
+}
+#endif
+
+} //namespace bitops_detail
+
+//Returns floor(log10(x)), or -1 if x is 0. Undefined if x < 0.
+//Application: Number of digits of x, fixed point scaling
+template <typename Integral>
+  constexpr14 auto ilog10(Integral x) noexcept
+  -> typename std::enable_if<bitops_detail::is_integral<Integral>::value && sizeof(Integral) <= 8, int>::type {
+    return bitops_detail::ilog10_u64(uint64_t(typename bitops_detail::make_unsigned<Integral>::type(x)));
+  }
+
+#if defined(__SIZEOF_INT128__)
+//Values of 64 bits or more compare against 10^t = 10^(t-19) * 10^19, t is 19 to 38
+inline constexpr14 int ilog10(unsigned __int128 x) noexcept {
+  if(uint64_t(x >> 64) == 0) {
+    return bitops_detail::ilog10_u64(uint64_t(x));
+  }
+  int t = ((ilog2(x) + 1) * 1233) >> 12;
+  typedef bitops_detail::decimal_tables<> tables;
+  return t - (x < (unsigned __int128)tables::pow10[t - 19] * tables::pow10[19]);
+}
+inline constexpr14 int ilog10(__int128 x) noexcept {
+  return ilog10((unsigned __int128)x);
+}
+#endif
+
+//Maximum number of characters written by to_decimal for an Integral, including a minus sign
+template <typename Integral>
+  constexpr auto decimal_max_size() noexcept
+  -> typename std::enable_if<bitops_detail::is_integral<Integral>::value, size_t>::type {
+    //The digits of 2^(bits - 1) for signed types, which have one value bit less
+    return ((sizeof(Integral) * CHAR_BIT - (Integral(-1) < Integral(0))) * 1233 >> 12) + 1 + (Integral(-1) < Integral(0));
+  }
+
+//Number of characters written by to_decimal for x
+template <typename Integral>
+  constexpr14 auto decimal_size(Integral x) noexcept
+  -> typename std::enable_if<bitops_detail::is_integral<Integral>::value, size_t>::type {
+    typedef typename bitops_detail::make_unsigned<Integral>::type U;
+    //x | 1 has the same number of digits as x as powers of 10 are even
+    return size_t(ilog10(U((x < 0 ? U(0) - U(x) : U(x)) | 1u)) + 1) + (x < 0);
+  }
+
+//Writes x in decimal to p, which must have room for decimal_size(x) characters, and returns the number
+//of characters written. Like std::to_chars, there is no terminating null and no allocation or locale.
+template <typename Integral>
+  inline auto to_decimal(Integral x, char* p) noexcept
+  -> typename std::enable_if<bitops_detail::is_integral<Integral>::value, size_t>::type {
+    typedef typename bitops_detail::make_unsigned<Integral>::type U;
+    U u = U(x);
+    if(x < 0) {
+      *p = '-';
+      u = U(0) - u;
+    }
+    size_t n = decimal_size(x);
+    //Narrow types are formatted as 32 bit values, wider types by their own overload
+    typedef typename std::conditional<(sizeof(U) <= 4), uint32_t,
+      typename std::conditional<sizeof(U) == 8, uint64_t, U>::type>::type W;
+    bitops_detail::write_decimal(W(u), p + n);
+    return n;
+  }
+
+} //namespace std
+
+#endif
@@ -0,0 +1,349 @@
+#ifndef PACKED_ARRAY_HH
+#define PACKED_ARRAY_HH
+
+#include "bitops.hh"
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace std {
+
+////////////////////////////////////
+//Bit packed integer arrays
+////////////////////////////////////
+
+//n values of width bits are packed into uint64_t words, value i is bits [i * width, (i + 1) * width)
+//of the words, bit j being bit j % 64 of word j / 64. Every 64 values fill exactly width words.
+
+//Number of words holding n values of width bits
+constexpr size_t packed_words(size_t n, int width) noexcept {
+  return (n * size_t(width) + 63) / 64;
+}
+
+namespace bitops_detail {
+
+//Value i of width bits with mask rstbitsge(~0, width), only reads the second word if the value crosses into it
+template <typename T>
+  inline T unpack_one(const uint64_t* in, size_t i, int width, uint64_t mask) noexcept {
+    size_t bit = i * size_t(width);
+    int s = int(bit % 64);
+    uint64_t x = shlr(in[bit / 64], s);
+    if(s + width > 64) {
+      x |= shll(in[bit / 64 + 1], 64 - s);
+    }
+    return T(x & mask);
+  }
+
+inline uint64_t width_mask(int width) noexcept {
+  return width == 64 ? ~uint64_t(0) : rstbitsge(~uint64_t(0), width);
+}
+
+//The fixed width kernels unpack and pack blocks of 64 values. The loop is unrolled,
+//so the word index, shift and mask of each value are known at compile time.
+template <int W, typename T>
+  inline void unpack_block(const uint64_t* in, T* out) noexcept {
+    BITOPS_UNROLL(64)
+    for(int j = 0; j < 64; ++j) {
+      const int s = j * W % 64;
+      const int w = j * W / 64;
+      uint64_t x = shlr(in[w], s);
+      if(s + W > 64) {
+        x |= shll(in[w + 1], 64 - s);
+      }
+      out[j] = T(W == 64 ? x : rstbitsge(x, W % 64));
+    }
+  }
+
+//Each word is stored once, after the value which ends in it or crosses out of it.
+//The values alternate between 2 partial words to halve the chain of ors.
+template <int W, typename T>
+  inline void pack_block(const T* in, uint64_t* out) noexcept {
+    uint64_t word[2] = {0, 0};
+    BITOPS_UNROLL(64)
+    for(int j = 0; j < 64; ++j) {
+      const int s = j * W % 64;
+      const int w = j * W / 64;
+      uint64_t x = W == 64 ? uint64_t(in[j]) : rstbitsge(uint64_t(in[j]), W % 64);
+      word[j % 2] |= shll(x, s);
+      if(s + W >= 64) {
+        out[w] = word[0] | word[1];
+        word[0] = s + W > 64 ? shlr(x, 64 - s) : 0;
+        word[1] = 0;
+      }
+    }
+  }
+
+template <int... I>
+  struct int_seq {};
+template <int N, int... I>
+  struct make_int_seq : make_int_seq<N - 1, N - 1, I...> {};
+template <int... I>
+  struct make_int_seq<0, I...> {
+    typedef int_seq<I...> type;
+  };
+
+//Tables of the kernels of each width for 32 and 64 bit values, narrower types go through blocks of 32 bit values
+template <typename U>
+  struct packed_kernels {
+    typedef void (*unpack_type)(const uint64_t*, U*);
+    typedef void (*pack_type)(const U*, uint64_t*);
+
+    template <int... I>
+      static unpack_type unpack(int width, int_seq<I...>) noexcept {
+        static const unpack_type table[] = {&unpack_block<I + 1, U>...};
+        return table[width - 1];
+      }
+    static unpack_type unpack(int width) noexcept {
+      return unpack(width, typename make_int_seq<int(sizeof(U) * CHAR_BIT)>::type());
+    }
+
+    template <int... I>
+      static pack_type pack(int width, int_seq<I...>) noexcept {
+        static const pack_type table[] = {&pack_block<I + 1, U>...};
+        return table[width - 1];
+      }
+    static pack_type pack(int width) noexcept {
+      return pack(width, typename make_int_seq<int(sizeof(U) * CHAR_BIT)>::type());
+    }
+  };
+
+template <typename T>
+  inline auto unpack_kernel_blocks(const uint64_t* in, size_t nblocks, int width, T* out) noexcept
+  -> typename std::enable_if<(sizeof(T) >= 4)>::type {
+    typename packed_kernels<T>::unpack_type k = packed_kernels<T>::unpack(width);
+    for(size_t b = 0; b < nblocks; ++b) {
+      k(in + b * size_t(width), out + b * 64);
+    }
+  }
+template <typename T>
+  inline auto unpack_kernel_blocks(const uint64_t* in, size_t nblocks, int width, T* out) noexcept
+  -> typename std::enable_if<(sizeof(T) < 4)>::type {
+    packed_kernels<uint32_t>::unpack_type k = packed_kernels<uint32_t>::unpack(width);
+    uint32_t block[64];
+    for(size_t b = 0; b < nblocks; ++b) {
+      k(in + b * size_t(width), block);
+      for(int j = 0; j < 64; ++j) {
+        out[b * 64 + size_t(j)] = T(block[j]);
+      }
+    }
+  }
+
+template <typename T>
+  inline auto pack_kernel_blocks(const T* in, size_t nblocks, int width, uint64_t* out) noexcept
+  -> typename std::enable_if<(sizeof(T) >= 4)>::type {
+    typename packed_kernels<T>::pack_type k = packed_kernels<T>::pack(width);
+    for(size_t b = 0; b < nblocks; ++b) {
+      k(in + b * 64, out + b * size_t(width));
+    }
+  }
+template <typename T>
+  inline auto pack_kernel_blocks(const T* in, size_t nblocks, int width, uint64_t* out) noexcept
+  -> typename std::enable_if<(sizeof(T) < 4)>::type {
+    packed_kernels<uint32_t>::pack_type k = packed_kernels<uint32_t>::pack(width);
+    uint32_t block[64];
+    for(size_t b = 0; b < nblocks; ++b) {
+      for(int j = 0; j < 64; ++j) {
+        block[j] = in[b * 64 + size_t(j)];
+      }
+      k(block, out + b * size_t(width));
+    }
+  }
+
+//At the full width of T the words hold the values in memory order on little endian targets
+template <typename T>
+  inline void unpack_blocks(const uint64_t* in, size_t nblocks, int width, T* out) noexcept {
+#if !defined(BITOPS_BIG_ENDIAN)
+    if(width == int(sizeof(T) * CHAR_BIT)) {
+      std::memcpy(out, in, nblocks * 64 * sizeof(T));
+      return;
+    }
+#endif
+    unpack_kernel_blocks(in, nblocks, width, out);
+  }
+
+template <typename T>
+  inline void pack_blocks(const T* in, size_t nblocks, int width, uint64_t* out) noexcept {
+#if !defined(BITOPS_BIG_ENDIAN)
+    if(width == int(sizeof(T) * CHAR_BIT)) {
+      std::memcpy(out, in, nblocks * 64 * sizeof(T));
+      return;
+    }
+#endif
+    pack_kernel_blocks(in, nblocks, width, out);
+  }
+
+#if defined(BITOPS_RUNTIME_DISPATCH)
+//Unpacks 8 values of width <= 25 bits per step, ngroups must be a multiple of 8.
+//Every 8 values are width bytes, each half of the register gets the 16 bytes holding 4 of them.
+//vpshufb moves the 4 bytes holding each value into its lane, vpsrlvd and vpand extract it.
+//Reads up to width / 2 + 16 bytes from the start of the last group.
+BITOPS_TARGET("avx2") inline void unpack_avx2(const unsigned char* in, size_t ngroups, int width, uint32_t* out) noexcept {
+  alignas(32) unsigned char ctl[32];
+  alignas(32) uint32_t shifts[8];
+  for(int j = 0; j < 8; ++j) {
+    int r = j * width - (j / 4) * (4 * width / 8 * 8);
+    for(int b = 0; b < 4; ++b) {
+      ctl[j * 4 + b] = (unsigned char)(r / 8 + b);
+    }
+    shifts[j] = uint32_t(r % 8);
+  }
+  const __m256i c = _mm256_load_si256(reinterpret_cast<const __m256i*>(ctl));
+  const __m256i sh = _mm256_load_si256(reinterpret_cast<const __m256i*>(shifts));
+  const __m256i mask = _mm256_set1_epi32(int(rstbitsge(~uint32_t(0), width)));
+  const size_t hi = size_t(4 * width / 8);
+  for(size_t g = 0; g < ngroups; ++g) {
+    const unsigned char* p = in + g * size_t(width);
+    __m256i v = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + hi)), 1);
+    v = _mm256_and_si256(_mm256_srlv_epi32(_mm256_shuffle_epi8(v, c), sh), mask);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + g * 8), v);
+  }
+}
+#endif
+
+//Values unpacked with SIMD from the start of the array, a multiple of 64
+template <typename T>
+  inline size_t unpack_simd(const uint64_t*, size_t, int, T*) noexcept {
+    return 0;
+  }
+inline size_t unpack_simd(const uint64_t* in, size_t n, int width, uint32_t* out) noexcept {
+#if defined(BITOPS_RUNTIME_DISPATCH)
+  if(width <= 25 && has_avx2()) {
+    //Stay within the packed words on the reads of the last group
+    size_t nbytes = packed_words(n, width) * 8;
+    size_t reach = size_t(width / 2 + 16);
+    size_t ngroups = nbytes < reach ? 0 : std::min(n / 8, (nbytes - reach) / size_t(width) + 1);
+    ngroups -= ngroups % 8;
+    unpack_avx2(reinterpret_cast<const unsigned char*>(in), ngroups, width, out);
+    return ngroups * 8;
+  }
+#else
+  (void)in; (void)n; (void)width; (void)out;
+#endif
+  return 0;
+}
+
+} //namespace bitops_detail
+
+//Unpacks n values of width bits from the words at src into dst, 1 <= width <= sizeof(T) * CHAR_BIT.
+//Blocks of 64 values go through a kernel specialized for width at compile time, selected from a table
+//x86_64 AVX2: vpshufb, vpsrlvd (32 bit values of up to 25 bits)
+template <typename T>
+  auto unpack_bits(const uint64_t* src, size_t n, int width, T* dst) noexcept
+  -> typename std::enable_if<std::is_unsigned<T>::value>::type {
+    size_t i = bitops_detail::unpack_simd(src, n, width, dst);
+    bitops_detail::unpack_blocks(src + i / 64 * size_t(width), (n - i) / 64, width, dst + i);
+    i = n - n % 64;
+    uint64_t mask = bitops_detail::width_mask(width);
+    for(; i < n; ++i) {
+      dst[i] = bitops_detail::unpack_one<T>(src, i, width, mask);
+    }
+  }
+
+//Unpacks n values of Width bits, for widths known at compile time
+template <int Width, typename T>
+  auto unpack_bits(const uint64_t* src, size_t n, T* dst) noexcept
+  -> typename std::enable_if<std::is_unsigned<T>::value>::type {
+    static_assert(Width >= 1 && Width <= int(sizeof(T) * CHAR_BIT), "Width must be between 1 and the width of T");
+    size_t i = bitops_detail::unpack_simd(src, n, Width, dst);
+    for(; i + 64 <= n; i += 64) {
+      bitops_detail::unpack_block<Width>(src + i / 64 * Width, dst + i);
+    }
+    for(; i < n; ++i) {
+      dst[i] = bitops_detail::unpack_one<T>(src, i, Width, bitops_detail::width_mask(Width));
+    }
+  }
+
+//Packs the low width bits of the n values at src into the packed_words(n, width) words at dst,
+//1 <= width <= sizeof(T) * CHAR_BIT
+template <typename T>
+  auto pack_bits(const T* src, size_t n, int width, uint64_t* dst) noexcept
+  -> typename std::enable_if<std::is_unsigned<T>::value>::type {
+    bitops_detail::pack_blocks(src, n / 64, width, dst);
+    size_t i = n - n % 64;
+    uint64_t mask = bitops_detail::width_mask(width);
+    for(size_t w = i / 64 * size_t(width); w < packed_words(n, width); ++w) {
+      dst[w] = 0;
+    }
+    for(; i < n; ++i) {
+      size_t bit = i * size_t(width);
+      int s = int(bit % 64);
+      uint64_t x = uint64_t(src[i]) & mask;
+      dst[bit / 64] |= shll(x, s);
+      if(s + width > 64) {
+        dst[bit / 64 + 1] |= shlr(x, 64 - s);
+      }
+    }
+  }
+
+//Fixed size array of n unsigned values of width bits.
+//One word of padding lets single values be read without checking for the end of the array.
+template <typename T>
+class packed_array {
+  public:
+    static_assert(std::is_unsigned<T>::value, "T must be unsigned");
+
+    packed_array() noexcept = default;
+
+    //n zero values of width bits, 1 <= width <= sizeof(T) * CHAR_BIT
+    packed_array(size_t n, int width)
+      : _words(packed_words(n, width) + 1), _n(n), _width(width), _mask(bitops_detail::width_mask(width)) {}
+
+    //Packs the low width bits of the n values at src
+    packed_array(const T* src, size_t n, int width)
+      : packed_array(n, width) {
+        pack_bits(src, n, width, _words.data());
+      }
+
+    size_t size() const noexcept { return _n; }
+    int width() const noexcept { return _width; }
+
+    //The packed words, packed_words(size(), width()) of them
+    const uint64_t* data() const noexcept { return _words.data(); }
+
+    //Returns value i, undefined if i >= size()
+    //The second word is always read, (y << 1) << (63 - s) is 0 when s == 0.
+    T get(size_t i) const noexcept {
+      size_t bit = i * size_t(_width);
+      int s = int(bit % 64);
+      uint64_t x = shlr(_words[bit / 64], s) | shll(shll(_words[bit / 64 + 1], 1), 63 - s);
+      return T(x & _mask);
+    }
+    T operator[](size_t i) const noexcept { return get(i); }
+
+    //Stores the low width bits of v as value i, undefined if i >= size()
+    void set(size_t i, T v) noexcept {
+      size_t bit = i * size_t(_width);
+      int s = int(bit % 64);
+      uint64_t x = uint64_t(v) & _mask;
+      uint64_t& lo = _words[bit / 64];
+      lo = (lo & ~shll(_mask, s)) | shll(x, s);
+      if(s + _width > 64) {
+        uint64_t& hi = _words[bit / 64 + 1];
+        hi = (hi & ~shlr(_mask, 64 - s)) | shlr(x, 64 - s);
+      }
+    }
+
+    //Unpacks the n values starting at value first to out, undefined if first + n > size()
+    void unpack(size_t first, size_t n, T* out) const noexcept {
+      //Unpack single values up to the start of a block
+      size_t head = std::min(n, (64 - first % 64) % 64);
+      for(size_t i = 0; i < head; ++i) {
+        out[i] = get(first + i);
+      }
+      unpack_bits(_words.data() + (first + head) / 64 * size_t(_width), n - head, _width, out + head);
+    }
+
+  private:
+    std::vector<uint64_t> _words;
+    size_t _n = 0;
+    int _width = 0;
+    uint64_t _mask = 0;
+};
+
+} //namespace std
+
+#endif
@@ -0,0 +1,321 @@
+#ifndef POOL_ALLOCATOR_HH
+#define POOL_ALLOCATOR_HH
+
+#include "bitops.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace std {
+
+////////////////////////////////////
+//Power of 2 size class pool
+////////////////////////////////////
+
+//Memory pool with power of 2 size classes from min_size to max_size bytes.
+//A request of n bytes is served from class ceilp2(n), whose index is computed with a single cntl0.
+//Each class has a thread local free list threaded through the free blocks and a thread local slab
+//which is carved into blocks on demand. Blocks are aligned to their size up to the page size,
+//so any type whose size is a multiple of its alignment can be placed in them.
+//
+//Memory is never returned to the system. A thread keeps at most two slabs' worth of free blocks
+//of a class, the overflow goes to a shared depot as batches of at most one slab's worth. A thread
+//whose list is empty takes one batch, so that blocks allocated by one thread and freed by another
+//are reused and are shared among the threads which allocate. An exiting thread hands all of its free
+//blocks and the rest of its slabs to the depot. Blocks may be freed by any thread.
+//Requests larger than max_size go to ::operator new.
+class size_class_pool {
+  public:
+    static constexpr size_t min_size = 16;
+    static constexpr size_t max_size = 65536;
+    static constexpr int num_classes = 13;
+    static constexpr size_t slab_size = 262144;
+    static constexpr size_t max_align = 4096;
+
+    //Index of the smallest size class holding n bytes, undefined if n > max_size
+    //x86_64 LZCNT
+    static constexpr14 int size_class(size_t n) noexcept {
+      return n <= min_size ? 0 : int(sizeof(size_t) * CHAR_BIT) - cntl0(n - 1) - 4;
+    }
+
+    //Size of the blocks of class c
+    static constexpr size_t class_size(int c) noexcept {
+      return min_size << c;
+    }
+
+    //Allocates n bytes, throws std::bad_alloc on failure
+    static void* allocate(size_t n) {
+      if(n > max_size) {
+        return ::operator new(n);
+      }
+      int c = size_class(n);
+      if(cache_dead()) {
+        return allocate_shared(c);
+      }
+      thread_cache& tc = cache();
+      void* p = tc.free[c];
+      if(p != nullptr) {
+        tc.free[c] = next(p);
+        --tc.count[c];
+        return p;
+      }
+      return refill(tc, c);
+    }
+
+    //Frees p, which was returned by allocate(n)
+    static void deallocate(void* p, size_t n) noexcept {
+      if(n > max_size) {
+        ::operator delete(p);
+        return;
+      }
+      int c = size_class(n);
+      if(cache_dead()) {
+        depot& d = shared();
+        std::lock_guard<std::mutex> lock(d.m);
+        push_batch(d, c, p, p, 1);
+        return;
+      }
+      thread_cache& tc = cache();
+      next(p) = tc.free[c];
+      tc.free[c] = p;
+      if(++tc.count[c] > 2 * slab_blocks(c)) {
+        release(tc, c, slab_blocks(c));
+      }
+    }
+
+    //Number of slabs taken from the system so far
+    static size_t slabs() noexcept {
+      return shared().slabs.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct thread_cache {
+      void* free[num_classes] = {};
+      size_t count[num_classes] = {};
+      //Uncarved part of the current slab of each class
+      char* cur[num_classes] = {};
+      char* end[num_classes] = {};
+
+      ~thread_cache() {
+        for(int c = 0; c < num_classes; ++c) {
+          if(cur[c] != end[c]) {
+            size_t size = class_size(c);
+            free[c] = carve(cur[c], end[c], size, free[c]);
+            count[c] += size_t(end[c] - cur[c]) / size;
+            cur[c] = end[c] = nullptr;
+          }
+          release(*this, c, 0);
+        }
+        cache_dead() = true;
+      }
+    };
+
+    //A list of count free blocks, ended by nullptr
+    struct batch {
+      void* head;
+      size_t count;
+    };
+
+    struct depot {
+      std::mutex m;
+      //Stack of batches of each class, each of at most slab_blocks(c) blocks
+      std::vector<batch> batches[num_classes];
+      std::atomic<size_t> slabs{0};
+
+      //A stack which is empty has room for a batch, see push_batch
+      depot() {
+        for(auto& v : batches) {
+          v.reserve(16);
+        }
+      }
+    };
+
+    //Number of blocks in a slab of class c, a thread keeps at most twice this many free blocks
+    static constexpr size_t slab_blocks(int c) noexcept {
+      return slab_size / class_size(c);
+    }
+
+    static void*& next(void* p) noexcept {
+      return *static_cast<void**>(p);
+    }
+
+    static thread_cache& cache() noexcept {
+      static thread_local thread_cache tc;
+      return tc;
+    }
+
+    //Set when the thread cache is destroyed, thread local objects destroyed after it use the depot directly.
+    //Kept outside of the cache since it is read after the cache's lifetime ends, being trivially
+    //destructible it stays valid until the thread exits.
+    static bool& cache_dead() noexcept {
+      static thread_local bool dead = false;
+      return dead;
+    }
+
+    //Never destroyed, so that threads exiting after static destruction can still use it
+    static depot& shared() noexcept {
+      static depot* d = new depot;
+      return *d;
+    }
+
+    //New slab for class c, aligned to the block size up to max_align
+    static char* new_slab(int c) {
+      size_t size = class_size(c);
+      size_t align = size < max_align ? size : size_t(max_align);
+      void* raw = std::malloc(slab_size + align - 1);
+      if(raw == nullptr) {
+        throw std::bad_alloc();
+      }
+      shared().slabs.fetch_add(1, std::memory_order_relaxed);
+      return static_cast<char*>(align_up(raw, align));
+    }
+
+    //Links the blocks of size bytes in [first, last) in address order in front of list
+    static void* carve(char* first, char* last, size_t size, void* list) noexcept {
+      while(last != first) {
+        last -= size;
+        next(last) = list;
+        list = last;
+      }
+      return list;
+    }
+
+    //Adds the n blocks from first to last to the depot's batches of class c, d.m must be held.
+    //They go in front of the top batch when that stays within a slab's worth, else they are a new batch.
+    static void push_batch(depot& d, int c, void* first, void* last, size_t n) noexcept {
+      std::vector<batch>& v = d.batches[c];
+      if(v.empty() || v.back().count + n > slab_blocks(c)) {
+        next(last) = nullptr;
+        try {
+          v.push_back(batch{first, n});
+          return;
+        } catch(const std::bad_alloc&) {
+          //v is not empty, it would have room otherwise, so the top batch grows past a slab's worth
+        }
+      }
+      batch& b = v.back();
+      next(last) = b.head;
+      b.head = first;
+      b.count += n;
+    }
+
+    //Hands all but the first keep blocks of the thread's list of class c to the depot.
+    //The walk is paid for by the blocks handed over, which are at least as many as the ones kept.
+    //It cuts them into batches outside of the lock, which is then taken once per batch.
+    static void release(thread_cache& tc, int c, size_t keep) noexcept {
+      void** link = &tc.free[c];
+      for(size_t i = 0; i < keep; ++i) {
+        link = &next(*link);
+      }
+      void* first = *link;
+      *link = nullptr;
+      tc.count[c] = keep;
+
+      depot& d = shared();
+      while(first != nullptr) {
+        void* last = first;
+        size_t n = 1;
+        while(n < slab_blocks(c) && next(last) != nullptr) {
+          last = next(last);
+          ++n;
+        }
+        void* rest = next(last);
+        {
+          std::lock_guard<std::mutex> lock(d.m);
+          push_batch(d, c, first, last, n);
+        }
+        first = rest;
+      }
+    }
+
+    //Slow path of allocate: takes one batch of the depot or carves a block from the slab
+    static void* refill(thread_cache& tc, int c) {
+      depot& d = shared();
+      {
+        std::unique_lock<std::mutex> lock(d.m);
+        std::vector<batch>& v = d.batches[c];
+        if(!v.empty()) {
+          batch b = v.back();
+          v.pop_back();
+          lock.unlock();
+          tc.free[c] = next(b.head);
+          tc.count[c] = b.count - 1;
+          return b.head;
+        }
+      }
+
+      if(tc.cur[c] == tc.end[c]) {
+        tc.cur[c] = new_slab(c);
+        tc.end[c] = tc.cur[c] + slab_size;
+      }
+      void* p = tc.cur[c];
+      tc.cur[c] += class_size(c);
+      return p;
+    }
+
+    //Allocation after the thread cache is destroyed, the depot is used directly
+    static void* allocate_shared(int c) {
+      depot& d = shared();
+      {
+        std::lock_guard<std::mutex> lock(d.m);
+        std::vector<batch>& v = d.batches[c];
+        if(!v.empty()) {
+          batch& b = v.back();
+          void* p = b.head;
+          b.head = next(p);
+          if(--b.count == 0) {
+            v.pop_back();
+          }
+          return p;
+        }
+      }
+
+      //The rest of a new slab goes to the depot
+      size_t size = class_size(c);
+      char* first = new_slab(c);
+      char* last = first + slab_size;
+      void* rest = carve(first + size, last, size, nullptr);
+      std::lock_guard<std::mutex> lock(d.m);
+      push_batch(d, c, rest, last - size, slab_blocks(c) - 1);
+      return first;
+    }
+};
+
+//Allocator using size_class_pool, so that standard containers can use it.
+//Requests larger than max_size only have the alignment of ::operator new, so over aligned types are not supported.
+template <typename T>
+class pool_allocator {
+  public:
+    typedef T value_type;
+
+    pool_allocator() noexcept = default;
+    template <typename U>
+      pool_allocator(const pool_allocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+      static_assert(alignof(T) <= alignof(std::max_align_t), "T is over aligned");
+      if(n > size_t(-1) / sizeof(T)) {
+        throw std::bad_alloc();
+      }
+      return static_cast<T*>(size_class_pool::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+      size_class_pool::deallocate(p, n * sizeof(T));
+    }
+};
+
+//All pool allocators share the same pool
+template <typename T, typename U>
+  bool operator==(const pool_allocator<T>&, const pool_allocator<U>&) noexcept { return true; }
+template <typename T, typename U>
+  bool operator!=(const pool_allocator<T>&, const pool_allocator<U>&) noexcept { return false; }
+
+} //namespace std
+
+#endif
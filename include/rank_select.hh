@@ -0,0 +1,188 @@
+#ifndef RANK_SELECT_HH
+#define RANK_SELECT_HH
+
+#include "bitops.hh"
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace std {
+
+////////////////////////////////////
+//Rank and select over a bitmap
+////////////////////////////////////
+
+namespace bitops_detail {
+
+//Byte wise select: the prefix sums of the byte popcounts find the byte holding the bit,
+//then the lower 1 bits of that byte are cleared.
+//Vigna, Broadword Implementation of Rank/Select Queries
+inline int select_in_word_broadword(uint64_t w, int r) noexcept {
+  const uint64_t ones = 0x0101010101010101ULL;
+  const uint64_t msbs = 0x8080808080808080ULL;
+  uint64_t s = w - (shlr(w, 1) & 0x5555555555555555ULL);
+  s = (s & 0x3333333333333333ULL) + (shlr(s, 2) & 0x3333333333333333ULL);
+  //Byte i is the number of 1 bits in bytes 0 to i
+  s = ((s + shlr(s, 4)) & 0x0F0F0F0F0F0F0F0FULL) * ones;
+  //The bytes whose prefix sum is <= r are the ones before the byte holding the bit.
+  //Both are below 128, so the msb of each byte of the difference is set when s <= r.
+  uint64_t le = shlr(((uint64_t(r) * ones) | msbs) - s, 7) & ones;
+  int place = int(shlr(le * ones, 56)) * 8;
+  int k = r - int(shlr(shll(s, 8), place) & 0xFF);
+  uint64_t x = shlr(w, place) & 0xFF;
+  for(; k > 0; --k) {
+    x = rstls1b(x);
+  }
+  return place + cntt0(x);
+}
+
+//Position of the 1 bit of rank r in w, which must have more than r 1 bits
+//x86_64 BMI2: PDEP, TZCNT
+inline int select_in_word(uint64_t w, int r) noexcept {
+#if defined(BITOPS_PDEP) || defined(BITOPS_RUNTIME_DISPATCH)
+  if(has_fast_pdep()) {
+    return cntt0(deposit_bits_pdep(shll(uint64_t(1), r), w));
+  }
+#endif
+  return select_in_word_broadword(w, r);
+}
+
+} //namespace bitops_detail
+
+//Rank and select index over an immutable bitmap of nbits bits stored in an array of uint64_t.
+//Bit i of the bitmap is bit i % 64 of word i / 64. The bitmap is not copied and must outlive the index.
+//
+//The layout follows poppy (Zhou, Andersen, Kaminsky: Space-Efficient, High-Performance Rank & Select
+//Structures on Uncompressed Bit Sequences). Each 2048 bit basic block has one 64 bit index entry
+//holding the number of 1 bits before the block and the counts of its first three 512 bit sub blocks,
+//so rank reads one index word and at most one 64 byte cache line of the bitmap.
+//The position of every 8192nd 1 bit is sampled to start select. The index is about 3.2% of the bitmap.
+class rank_select {
+  public:
+    rank_select() noexcept = default;
+
+    //Builds the index for the nbits bits at bits
+    rank_select(const uint64_t* bits, size_t nbits)
+      : _bits(bits), _nbits(nbits), _l0(nbits / l0_bits + 1), _l12(nbits / block_bits + 1) {
+        size_t nwords = (nbits + 63) / 64;
+        size_t ones = 0;
+        for(size_t b = 0; b < _l12.size(); ++b) {
+          if(b % (l0_bits / block_bits) == 0) {
+            _l0[b / (l0_bits / block_bits)] = ones;
+          }
+          uint64_t entry = ones - _l0[b / (l0_bits / block_bits)];
+          for(size_t s = 0; s < block_bits / sub_bits; ++s) {
+            size_t count = 0;
+            for(size_t w = b * block_words + s * sub_words; w < std::min(nwords, b * block_words + (s + 1) * sub_words); ++w) {
+              count += popcount(word(w));
+            }
+            if(s < 3) {
+              entry |= uint64_t(count) << (32 + 10 * s);
+            }
+            //Sample the basic block holding every sample_ones'th 1 bit
+            while(_samples.size() * sample_ones < ones + count) {
+              _samples.push_back(uint32_t(b));
+            }
+            ones += count;
+          }
+          _l12[b] = entry;
+        }
+        _ones = ones;
+      }
+
+    //Number of bits in the bitmap
+    size_t size() const noexcept { return _nbits; }
+
+    //Number of 1 bits in the bitmap
+    size_t count() const noexcept { return _ones; }
+
+    //Returns bit i, undefined if i >= size()
+    bool test(size_t i) const noexcept {
+      return testbit(_bits[i / 64], int(i % 64));
+    }
+
+    //Returns the number of 1 bits in positions [0, i), undefined if i > size()
+    size_t rank1(size_t i) const noexcept {
+      size_t b = i / block_bits;
+      uint64_t entry = _l12[b];
+      size_t r = block_rank(b);
+      size_t s = (i % block_bits) / sub_bits;
+      for(size_t k = 0; k < s; ++k) {
+        r += size_t(shlr(entry, int(32 + 10 * k)) & 0x3FF);
+      }
+      size_t w = b * block_words + s * sub_words;
+      for(; w < i / 64; ++w) {
+        r += popcount(_bits[w]);
+      }
+      if(i % 64 != 0) {
+        r += popcount(rstbitsge(_bits[w], int(i % 64)));
+      }
+      return r;
+    }
+
+    //Returns the number of 0 bits in positions [0, i), undefined if i > size()
+    size_t rank0(size_t i) const noexcept {
+      return i - rank1(i);
+    }
+
+    //Returns the position of the 1 bit with rank k (counting from 0), undefined if k >= count()
+    size_t select1(size_t k) const noexcept {
+      //Binary search the basic blocks between the surrounding samples
+      size_t lo = _samples[k / sample_ones];
+      size_t hi = k / sample_ones + 1 < _samples.size() ? _samples[k / sample_ones + 1] + 1 : _l12.size();
+      while(hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if(block_rank(mid) <= k) { lo = mid; } else { hi = mid; }
+      }
+
+      size_t r = k - block_rank(lo);
+      uint64_t entry = _l12[lo];
+      size_t w = lo * block_words;
+      for(size_t s = 0; s < 3; ++s) {
+        size_t count = size_t(shlr(entry, int(32 + 10 * s)) & 0x3FF);
+        if(r < count) { break; }
+        r -= count;
+        w += sub_words;
+      }
+      for(;; ++w) {
+        size_t count = popcount(_bits[w]);
+        if(r < count) { break; }
+        r -= count;
+      }
+      return w * 64 + bitops_detail::select_in_word(_bits[w], int(r));
+    }
+
+  private:
+    static constexpr size_t l0_bits = size_t(1) << 32;
+    static constexpr size_t block_bits = 2048;
+    static constexpr size_t block_words = block_bits / 64;
+    static constexpr size_t sub_bits = 512;
+    static constexpr size_t sub_words = sub_bits / 64;
+    static constexpr size_t sample_ones = 8192;
+
+    //Word w of the bitmap with the bits past the end cleared
+    uint64_t word(size_t w) const noexcept {
+      return (w + 1) * 64 <= _nbits ? _bits[w] : rstbitsge(_bits[w], int(_nbits % 64));
+    }
+
+    //Number of 1 bits before basic block b
+    size_t block_rank(size_t b) const noexcept {
+      return size_t(_l0[b / (l0_bits / block_bits)]) + size_t(_l12[b] & 0xFFFFFFFFUL);
+    }
+
+    const uint64_t* _bits = nullptr;
+    size_t _nbits = 0;
+    size_t _ones = 0;
+    //Number of 1 bits before each 2^32 bits
+    std::vector<uint64_t> _l0;
+    //Per basic block: bits 0-31 are the 1 bits before the block relative to _l0,
+    //bits 32-41, 42-51, 52-61 are the 1 bits in the first three sub blocks
+    std::vector<uint64_t> _l12;
+    //Basic block containing the 1 bit of rank j * sample_ones
+    std::vector<uint32_t> _samples;
+};
+
+} //namespace std
+
+#endif
@@ -0,0 +1,643 @@
+#ifndef ROARING_BITMAP_HH
+#define ROARING_BITMAP_HH
+
+#include "bitops.hh"
+#include "bitmap_expr.hh"
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace std {
+
+////////////////////////////////////
+//Compressed bitmaps
+////////////////////////////////////
+
+//Roaring bitmaps (Chambi, Lemire, Kaser, Godin: Better bitmap performance with Roaring bitmaps).
+//A set of uint32_t is split into chunks of 2^16 values by the high 16 bits, the key. Each non empty
+//chunk is a container of one of 3 kinds, chosen by its size:
+//array: the sorted low 16 bits, up to 4096 of them
+//bitmap: 1024 uint64_t words, for more than 4096 values
+//run: sorted pairs of the first value and the length - 1 of each run of consecutive values,
+//made by run_optimize() where they are smaller than either of the above
+
+namespace bitops_detail {
+
+enum roaring_kind { roaring_array = 1, roaring_bitmap_kind = 2, roaring_run = 3 };
+
+constexpr uint32_t roaring_array_max = 4096;
+constexpr size_t roaring_bitmap_words = 1024;
+
+//Sets bits lo to hi inclusive of the words
+inline void roaring_set_range(uint64_t* words, size_t lo, size_t hi) noexcept {
+  size_t wl = lo / 64;
+  size_t wh = hi / 64;
+  if(wl == wh) {
+    words[wl] |= setbitsge(uint64_t(0), int(lo % 64)) & setbitsle(uint64_t(0), int(hi % 64));
+    return;
+  }
+  words[wl] = setbitsge(words[wl], int(lo % 64));
+  for(size_t w = wl + 1; w < wh; ++w) {
+    words[w] = ~uint64_t(0);
+  }
+  words[wh] = setbitsle(words[wh], int(hi % 64));
+}
+
+struct roaring_container {
+  int kind = roaring_array;
+  uint32_t card = 0;
+  //Array values, or run first value and length - 1 pairs
+  std::vector<uint16_t> values;
+  std::vector<uint64_t> words;
+
+  size_t nruns() const noexcept { return values.size() / 2; }
+
+  //Index of the last run starting at or before x, -1 if there is none
+  ptrdiff_t find_run(uint16_t x) const noexcept {
+    size_t lo = 0;
+    size_t hi = nruns();
+    while(lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if(values[2 * mid] <= x) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return ptrdiff_t(lo) - 1;
+  }
+
+  bool test(uint16_t x) const noexcept {
+    if(kind == roaring_array) {
+      return std::binary_search(values.begin(), values.end(), x);
+    }
+    if(kind == roaring_bitmap_kind) {
+      return testbit(words[x / 64], x % 64);
+    }
+    ptrdiff_t r = find_run(x);
+    return r >= 0 && x - values[size_t(2 * r)] <= values[size_t(2 * r + 1)];
+  }
+
+  //Number of runs of consecutive values, the starts of the runs of a bitmap are the
+  //1 bits whose lower neighbour is 0
+  size_t count_runs() const noexcept {
+    if(kind == roaring_run) {
+      return nruns();
+    }
+    size_t n = 0;
+    if(kind == roaring_array) {
+      for(size_t i = 0; i < values.size(); ++i) {
+        n += i == 0 || values[i] != values[i - 1] + 1;
+      }
+      return n;
+    }
+    uint64_t prev = 0;
+    for(uint64_t w : words) {
+      n += size_t(popcount(w & ~(shll(w, 1) | shlr(prev, 63))));
+      prev = w;
+    }
+    return n;
+  }
+
+  void to_bitmap() {
+    std::vector<uint64_t> w(roaring_bitmap_words);
+    if(kind == roaring_array) {
+      for(uint16_t v : values) {
+        w[v / 64] = setbit(w[v / 64], v % 64);
+      }
+    } else {
+      for(size_t r = 0; r < nruns(); ++r) {
+        roaring_set_range(w.data(), values[2 * r], size_t(values[2 * r]) + values[2 * r + 1]);
+      }
+    }
+    words.swap(w);
+    std::vector<uint16_t>().swap(values);
+    kind = roaring_bitmap_kind;
+  }
+
+  //The values of a bitmap are its 1 bits, found with cntt0 and rstls1b
+  void to_array() {
+    std::vector<uint16_t> v;
+    v.reserve(card);
+    if(kind == roaring_bitmap_kind) {
+      for(size_t i = 0; i < words.size(); ++i) {
+        for(int b : bit_positions(words[i])) {
+          v.push_back(uint16_t(i * 64 + size_t(b)));
+        }
+      }
+    } else {
+      for(size_t r = 0; r < nruns(); ++r) {
+        for(uint32_t x = values[2 * r]; x <= uint32_t(values[2 * r]) + values[2 * r + 1]; ++x) {
+          v.push_back(uint16_t(x));
+        }
+      }
+    }
+    values.swap(v);
+    std::vector<uint64_t>().swap(words);
+    kind = roaring_array;
+  }
+
+  //The runs of a bitmap go from a 1 bit whose lower neighbour is 0 to a 1 bit whose upper neighbour is 0
+  void to_runs() {
+    std::vector<uint16_t> v;
+    if(kind == roaring_array) {
+      for(size_t i = 0; i < values.size(); ++i) {
+        if(i == 0 || values[i] != values[i - 1] + 1) {
+          v.push_back(values[i]);
+          v.push_back(0);
+        } else {
+          ++v.back();
+        }
+      }
+    } else {
+      std::vector<uint16_t> ends;
+      uint64_t prev = 0;
+      for(size_t i = 0; i < words.size(); ++i) {
+        uint64_t w = words[i];
+        uint64_t next = i + 1 < words.size() ? words[i + 1] : 0;
+        for(int b : bit_positions(w & ~(shll(w, 1) | shlr(prev, 63)))) {
+          v.push_back(uint16_t(i * 64 + size_t(b)));
+          v.push_back(0);
+        }
+        for(int b : bit_positions(w & ~(shlr(w, 1) | shll(next, 63)))) {
+          ends.push_back(uint16_t(i * 64 + size_t(b)));
+        }
+        prev = w;
+      }
+      for(size_t r = 0; r < ends.size(); ++r) {
+        v[2 * r + 1] = uint16_t(ends[r] - v[2 * r]);
+      }
+    }
+    values.swap(v);
+    std::vector<uint64_t>().swap(words);
+    kind = roaring_run;
+  }
+
+  //Converts to an array or a bitmap by the cardinality
+  void normalize() {
+    if(card <= roaring_array_max) {
+      if(kind != roaring_array) {
+        to_array();
+      }
+    } else if(kind != roaring_bitmap_kind) {
+      to_bitmap();
+    }
+  }
+
+  //Adds x, returns true if it was not there
+  bool set(uint16_t x) {
+    if(kind == roaring_run) {
+      normalize();
+    }
+    if(kind == roaring_array) {
+      auto it = std::lower_bound(values.begin(), values.end(), x);
+      if(it != values.end() && *it == x) {
+        return false;
+      }
+      if(card == roaring_array_max) {
+        to_bitmap();
+        return set(x);
+      }
+      values.insert(it, x);
+    } else {
+      if(testbit(words[x / 64], x % 64)) {
+        return false;
+      }
+      words[x / 64] = setbit(words[x / 64], x % 64);
+    }
+    ++card;
+    return true;
+  }
+
+  //Removes x, returns true if it was there
+  bool reset(uint16_t x) {
+    if(kind == roaring_run) {
+      normalize();
+    }
+    if(kind == roaring_array) {
+      auto it = std::lower_bound(values.begin(), values.end(), x);
+      if(it == values.end() || *it != x) {
+        return false;
+      }
+      values.erase(it);
+      --card;
+    } else {
+      if(!testbit(words[x / 64], x % 64)) {
+        return false;
+      }
+      words[x / 64] = rstbit(words[x / 64], x % 64);
+      if(--card <= roaring_array_max) {
+        to_array();
+      }
+    }
+    return true;
+  }
+
+  //Converts to the smallest of the 3 kinds
+  void optimize() {
+    size_t run_bytes = 4 * count_runs();
+    size_t bytes = card <= roaring_array_max ? 2 * card : 8 * roaring_bitmap_words;
+    if(run_bytes < bytes) {
+      if(kind != roaring_run) {
+        to_runs();
+      }
+    } else {
+      normalize();
+    }
+  }
+
+  template <typename F>
+    void for_each(uint32_t base, F& f) const {
+      if(kind == roaring_array) {
+        for(uint16_t v : values) {
+          f(base | v);
+        }
+      } else if(kind == roaring_bitmap_kind) {
+        for(size_t i = 0; i < words.size(); ++i) {
+          for(int b : bit_positions(words[i])) {
+            f(base + uint32_t(i * 64) + uint32_t(b));
+          }
+        }
+      } else {
+        for(size_t r = 0; r < nruns(); ++r) {
+          for(uint32_t x = values[2 * r]; x <= uint32_t(values[2 * r]) + values[2 * r + 1]; ++x) {
+            f(base | x);
+          }
+        }
+      }
+    }
+};
+
+//c, or a copy of it in tmp as an array or a bitmap if it is a run container
+inline const roaring_container& roaring_natural(const roaring_container& c, roaring_container& tmp) {
+  if(c.kind != roaring_run) {
+    return c;
+  }
+  tmp = c;
+  tmp.normalize();
+  return tmp;
+}
+
+//Words of a AND or OR b with the cardinality counted in the same pass
+inline uint32_t roaring_words(bitmap_op op, const roaring_container& a, const roaring_container& b, roaring_container& r) {
+  r.kind = roaring_bitmap_kind;
+  r.words.resize(roaring_bitmap_words);
+  bitmap_expr e(roaring_bitmap_words);
+  int root = e.apply(op, e.input(a.words.data()), e.input(b.words.data()));
+  return uint32_t(e.evaluate_count(root, r.words.data()));
+}
+
+inline roaring_container roaring_and(const roaring_container& a0, const roaring_container& b0) {
+  roaring_container ta, tb, r;
+  const roaring_container& a = roaring_natural(a0, ta);
+  const roaring_container& b = roaring_natural(b0, tb);
+  if(a.kind == roaring_array && b.kind == roaring_array) {
+    std::set_intersection(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(), std::back_inserter(r.values));
+    r.card = uint32_t(r.values.size());
+  } else if(a.kind == roaring_array || b.kind == roaring_array) {
+    const roaring_container& arr = a.kind == roaring_array ? a : b;
+    const roaring_container& bm = a.kind == roaring_array ? b : a;
+    for(uint16_t v : arr.values) {
+      if(testbit(bm.words[v / 64], v % 64)) {
+        r.values.push_back(v);
+      }
+    }
+    r.card = uint32_t(r.values.size());
+  } else {
+    r.card = roaring_words(bitmap_op::bit_and, a, b, r);
+    if(r.card <= roaring_array_max) {
+      r.to_array();
+    }
+  }
+  return r;
+}
+
+inline roaring_container roaring_or(const roaring_container& a0, const roaring_container& b0) {
+  roaring_container ta, tb, r;
+  const roaring_container& a = roaring_natural(a0, ta);
+  const roaring_container& b = roaring_natural(b0, tb);
+  if(a.kind == roaring_array && b.kind == roaring_array) {
+    std::set_union(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(), std::back_inserter(r.values));
+    r.card = uint32_t(r.values.size());
+    if(r.card > roaring_array_max) {
+      r.to_bitmap();
+    }
+  } else if(a.kind == roaring_array || b.kind == roaring_array) {
+    const roaring_container& arr = a.kind == roaring_array ? a : b;
+    r = a.kind == roaring_array ? b : a;
+    for(uint16_t v : arr.values) {
+      r.words[v / 64] = setbit(r.words[v / 64], v % 64);
+    }
+    r.card = uint32_t(popcount(r.words.data(), r.words.size()));
+  } else {
+    r.card = roaring_words(bitmap_op::bit_or, a, b, r);
+  }
+  return r;
+}
+
+constexpr uint32_t roaring_magic = 0x314D4252; //"RBM1"
+
+} //namespace bitops_detail
+
+//Serialized layout, all fields little endian:
+//uint32_t magic "RBM1", uint32_t number of containers
+//Per container, 16 bytes: uint16_t key, uint16_t kind (1 array, 2 bitmap, 3 run), uint32_t cardinality,
+//uint32_t byte offset of the data from the start of the buffer, uint32_t number of data elements
+//The data of each container: uint16_t values or run pairs, or 1024 uint64_t words at an offset
+//that is a multiple of 8.
+class roaring_bitmap {
+  public:
+    roaring_bitmap() noexcept = default;
+
+    //Adds x
+    void set(uint32_t x) {
+      size_t i = find(uint16_t(x >> 16));
+      if(i == _keys.size() || _keys[i] != uint16_t(x >> 16)) {
+        _keys.insert(_keys.begin() + ptrdiff_t(i), uint16_t(x >> 16));
+        _containers.insert(_containers.begin() + ptrdiff_t(i), bitops_detail::roaring_container());
+      }
+      _containers[i].set(uint16_t(x));
+    }
+
+    //Removes x
+    void reset(uint32_t x) {
+      size_t i = find(uint16_t(x >> 16));
+      if(i != _keys.size() && _keys[i] == uint16_t(x >> 16) && _containers[i].reset(uint16_t(x)) && _containers[i].card == 0) {
+        _keys.erase(_keys.begin() + ptrdiff_t(i));
+        _containers.erase(_containers.begin() + ptrdiff_t(i));
+      }
+    }
+
+    //Returns true if x is in the set
+    bool test(uint32_t x) const noexcept {
+      size_t i = find(uint16_t(x >> 16));
+      return i != _keys.size() && _keys[i] == uint16_t(x >> 16) && _containers[i].test(uint16_t(x));
+    }
+
+    //Number of values
+    size_t count() const noexcept {
+      size_t n = 0;
+      for(const auto& c : _containers) {
+        n += c.card;
+      }
+      return n;
+    }
+
+    bool empty() const noexcept { return _keys.empty(); }
+
+    //Calls f(x) for each value x in increasing order
+    template <typename F>
+      void for_each(F f) const {
+        for(size_t i = 0; i < _keys.size(); ++i) {
+          _containers[i].for_each(uint32_t(_keys[i]) << 16, f);
+        }
+      }
+
+    //Converts each container to the smallest kind, using runs where they are smaller.
+    //The runs of a bitmap container are counted with popcount.
+    void run_optimize() {
+      for(auto& c : _containers) {
+        c.optimize();
+      }
+    }
+
+    //Intersection and union. Run containers take part as arrays or bitmaps.
+    //Bitmaps are combined with bitmap_expr, which counts the result in the same pass.
+    friend roaring_bitmap operator&(const roaring_bitmap& a, const roaring_bitmap& b) {
+      roaring_bitmap r;
+      size_t i = 0, j = 0;
+      while(i < a._keys.size() && j < b._keys.size()) {
+        if(a._keys[i] < b._keys[j]) {
+          ++i;
+        } else if(b._keys[j] < a._keys[i]) {
+          ++j;
+        } else {
+          bitops_detail::roaring_container c = bitops_detail::roaring_and(a._containers[i], b._containers[j]);
+          if(c.card != 0) {
+            r._keys.push_back(a._keys[i]);
+            r._containers.push_back(std::move(c));
+          }
+          ++i;
+          ++j;
+        }
+      }
+      return r;
+    }
+
+    friend roaring_bitmap operator|(const roaring_bitmap& a, const roaring_bitmap& b) {
+      roaring_bitmap r;
+      size_t i = 0, j = 0;
+      while(i < a._keys.size() || j < b._keys.size()) {
+        if(j == b._keys.size() || (i < a._keys.size() && a._keys[i] < b._keys[j])) {
+          r._keys.push_back(a._keys[i]);
+          r._containers.push_back(a._containers[i++]);
+        } else if(i == a._keys.size() || b._keys[j] < a._keys[i]) {
+          r._keys.push_back(b._keys[j]);
+          r._containers.push_back(b._containers[j++]);
+        } else {
+          r._keys.push_back(a._keys[i]);
+          r._containers.push_back(bitops_detail::roaring_or(a._containers[i++], b._containers[j++]));
+        }
+      }
+      return r;
+    }
+
+    //Number of bytes written by serialize()
+    size_t serialized_size() const noexcept {
+      size_t n = 8 + 16 * _keys.size();
+      for(const auto& c : _containers) {
+        n = c.kind == bitops_detail::roaring_bitmap_kind ? align_up(n, 8) + 8 * c.words.size() : n + 2 * c.values.size();
+      }
+      return n;
+    }
+
+    //Writes the serialized_size() bytes of the serialized bitmap to out, which may have any alignment
+    void serialize(void* out) const noexcept {
+      unsigned char* p = static_cast<unsigned char*>(out);
+      store_le(p, bitops_detail::roaring_magic);
+      store_le(p + 4, uint32_t(_keys.size()));
+      size_t off = 8 + 16 * _keys.size();
+      for(size_t i = 0; i < _keys.size(); ++i) {
+        const bitops_detail::roaring_container& c = _containers[i];
+        bool bitmap = c.kind == bitops_detail::roaring_bitmap_kind;
+        if(bitmap) {
+          std::memset(p + off, 0, align_up(off, 8) - off);
+          off = align_up(off, 8);
+        }
+        unsigned char* d = p + 8 + 16 * i;
+        store_le(d, _keys[i]);
+        store_le(d + 2, uint16_t(c.kind));
+        store_le(d + 4, c.card);
+        store_le(d + 8, uint32_t(off));
+        store_le(d + 12, uint32_t(bitmap ? c.words.size() : c.values.size()));
+        if(bitmap) {
+          for(uint64_t w : c.words) {
+            store_le(p + off, w);
+            off += 8;
+          }
+        } else {
+          for(uint16_t v : c.values) {
+            store_le(p + off, v);
+            off += 2;
+          }
+        }
+      }
+    }
+
+  private:
+    //Index of the first key >= key
+    size_t find(uint16_t key) const noexcept {
+      return size_t(std::lower_bound(_keys.begin(), _keys.end(), key) - _keys.begin());
+    }
+
+    std::vector<uint16_t> _keys;
+    std::vector<bitops_detail::roaring_container> _containers;
+};
+
+//Queries a serialized roaring_bitmap in place, such as one in a memory mapped file.
+//The constructor checks that the layout fits in the buffer, not that the contents are sorted.
+class roaring_view {
+  public:
+    roaring_view() noexcept = default;
+
+    //View of the n bytes at p, which may have any alignment. Invalid if they do not hold a serialized bitmap.
+    roaring_view(const void* p, size_t n) noexcept {
+      const unsigned char* b = static_cast<const unsigned char*>(p);
+      if(n < 8 || load_le<uint32_t>(b) != bitops_detail::roaring_magic) {
+        return;
+      }
+      size_t count = load_le<uint32_t>(b + 4);
+      if(count > (n - 8) / 16) {
+        return;
+      }
+      for(size_t i = 0; i < count; ++i) {
+        const unsigned char* d = b + 8 + 16 * i;
+        int kind = load_le<uint16_t>(d + 2);
+        size_t card = load_le<uint32_t>(d + 4);
+        size_t off = load_le<uint32_t>(d + 8);
+        size_t size = load_le<uint32_t>(d + 12);
+        bool ok = card != 0 && card <= 65536 && off <= n
+          && (i == 0 || load_le<uint16_t>(d) > load_le<uint16_t>(d - 16));
+        if(kind == bitops_detail::roaring_array) {
+          ok = ok && size == card && card <= bitops_detail::roaring_array_max && size <= (n - off) / 2;
+        } else if(kind == bitops_detail::roaring_bitmap_kind) {
+          ok = ok && size == bitops_detail::roaring_bitmap_words && 8 * size <= n - off;
+        } else if(kind == bitops_detail::roaring_run) {
+          ok = ok && size % 2 == 0 && size <= (n - off) / 2;
+        } else {
+          ok = false;
+        }
+        if(!ok) {
+          return;
+        }
+      }
+      _p = b;
+      _count = count;
+    }
+
+    //Returns true if the buffer holds a serialized bitmap
+    bool valid() const noexcept { return _p != nullptr; }
+
+    //Returns true if x is in the set
+    bool test(uint32_t x) const noexcept {
+      //Last container with a key <= the key of x
+      size_t lo = 0;
+      size_t hi = _count;
+      while(lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if(key(mid) <= (x >> 16)) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      if(lo == 0 || key(lo - 1) != (x >> 16)) {
+        return false;
+      }
+      const unsigned char* d = desc(lo - 1);
+      const unsigned char* data = _p + load_le<uint32_t>(d + 8);
+      size_t size = load_le<uint32_t>(d + 12);
+      uint16_t v = uint16_t(x);
+      switch(load_le<uint16_t>(d + 2)) {
+        case bitops_detail::roaring_array: {
+          size_t i = upper_bound(data, size, 1, v);
+          return i != 0 && load_le<uint16_t>(data + 2 * (i - 1)) == v;
+        }
+        case bitops_detail::roaring_bitmap_kind:
+          return testbit(load_le<uint64_t>(data + 8 * (v / 64)), v % 64);
+        default: {
+          //Last run starting at or before v
+          size_t r = upper_bound(data, size / 2, 2, v);
+          return r != 0 && v - load_le<uint16_t>(data + 4 * (r - 1)) <= load_le<uint16_t>(data + 4 * (r - 1) + 2);
+        }
+      }
+    }
+
+    //Number of values
+    size_t count() const noexcept {
+      size_t n = 0;
+      for(size_t i = 0; i < _count; ++i) {
+        n += load_le<uint32_t>(desc(i) + 4);
+      }
+      return n;
+    }
+
+    bool empty() const noexcept { return _count == 0; }
+
+    //Calls f(x) for each value x in increasing order
+    template <typename F>
+      void for_each(F f) const {
+        for(size_t i = 0; i < _count; ++i) {
+          const unsigned char* d = desc(i);
+          uint32_t base = uint32_t(key(i)) << 16;
+          const unsigned char* data = _p + load_le<uint32_t>(d + 8);
+          size_t size = load_le<uint32_t>(d + 12);
+          int kind = load_le<uint16_t>(d + 2);
+          for(size_t j = 0; kind == bitops_detail::roaring_array && j < size; ++j) {
+            f(base | load_le<uint16_t>(data + 2 * j));
+          }
+          for(size_t j = 0; kind == bitops_detail::roaring_bitmap_kind && j < size; ++j) {
+            for(int b : bit_positions(load_le<uint64_t>(data + 8 * j))) {
+              f(base + uint32_t(j * 64) + uint32_t(b));
+            }
+          }
+          for(size_t j = 0; kind == bitops_detail::roaring_run && j < size; j += 2) {
+            uint32_t first = load_le<uint16_t>(data + 2 * j);
+            uint32_t last = first + load_le<uint16_t>(data + 2 * j + 2);
+            for(uint32_t x = first; x <= last; ++x) {
+              f(base | x);
+            }
+          }
+        }
+      }
+
+  private:
+    const unsigned char* desc(size_t i) const noexcept { return _p + 8 + 16 * i; }
+    uint32_t key(size_t i) const noexcept { return load_le<uint16_t>(desc(i)); }
+
+    //Index of the first of the n uint16_t at p, stride elements apart, which is > v
+    static size_t upper_bound(const unsigned char* p, size_t n, size_t stride, uint16_t v) noexcept {
+      size_t lo = 0;
+      size_t hi = n;
+      while(lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if(load_le<uint16_t>(p + 2 * stride * mid) <= v) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      return lo;
+    }
+
+    const unsigned char* _p = nullptr;
+    size_t _count = 0;
+};
+
+} //namespace std
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef SUMMARY_BITMAP_HH
+#define SUMMARY_BITMAP_HH
+
+#include "bitops.hh"
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+namespace std {
+
+////////////////////////////////////
+//Hierarchical summary bitmap
+////////////////////////////////////
+
+//Bitmap of n bits with summary levels for fast searches of sparse bitmaps.
+//Level 0 holds the bits, bit i is bit i % 64 of word i / 64. Bit j of level l + 1 is set
+//when word j of level l is non zero, up to a top level of a single word.
+//Searches and single bit updates touch one word per level, O(log64 n), which is 4 levels for 10^7 bits.
+//Each level starts on its own 64 byte cache line.
+class summary_bitmap {
+  public:
+    static constexpr size_t npos = size_t(-1);
+    static constexpr int max_levels = 11;
+
+    summary_bitmap() noexcept = default;
+
+    //Bitmap of nbits bits, all clear
+    explicit summary_bitmap(size_t nbits) : _nbits(nbits) {
+      size_t words[max_levels];
+      size_t total = 0;
+      size_t n = nbits != 0 ? nbits : 1;
+      do {
+        words[_nlevels] = (n + 63) / 64;
+        total += align_up(words[_nlevels], 8);
+        n = words[_nlevels++];
+      } while(n > 1);
+      _storage.reset(new uint64_t[total + 7]());
+      uint64_t* p = static_cast<uint64_t*>(align_up(static_cast<void*>(_storage.get()), 64));
+      for(int l = 0; l < _nlevels; ++l) {
+        _levels[l] = p;
+        p += align_up(words[l], 8);
+      }
+    }
+
+    //Number of bits
+    size_t size() const noexcept { return _nbits; }
+
+    //Returns true if any bit is set
+    bool any() const noexcept { return _nlevels != 0 && _levels[_nlevels - 1][0] != 0; }
+
+    //Returns bit i, undefined if i >= size()
+    bool test(size_t i) const noexcept {
+      return testbit(_levels[0][i / 64], int(i % 64));
+    }
+
+    //Sets bit i, undefined if i >= size()
+    void set(size_t i) noexcept {
+      for(int l = 0; l < _nlevels; ++l, i /= 64) {
+        uint64_t w = _levels[l][i / 64];
+        _levels[l][i / 64] = setbit(w, int(i % 64));
+        if(w != 0) {
+          break;
+        }
+      }
+    }
+
+    //Clears bit i, undefined if i >= size()
+    void reset(size_t i) noexcept {
+      for(int l = 0; l < _nlevels; ++l, i /= 64) {
+        uint64_t w = rstbit(_levels[l][i / 64], int(i % 64));
+        _levels[l][i / 64] = w;
+        if(w != 0) {
+          break;
+        }
+      }
+    }
+
+    //Sets the bits in [first, last), undefined if last > size()
+    void set(size_t first, size_t last) noexcept {
+      for(int l = 0; l < _nlevels && first < last; ++l) {
+        uint64_t* words = _levels[l];
+        size_t wf = first / 64;
+        size_t wl = (last - 1) / 64;
+        if(wf == wl) {
+          words[wf] |= range_mask(int(first % 64), int((last - 1) % 64));
+        } else {
+          words[wf] = setbitsge(words[wf], int(first % 64));
+          for(size_t w = wf + 1; w < wl; ++w) {
+            words[w] = ~uint64_t(0);
+          }
+          words[wl] = setbitsle(words[wl], int((last - 1) % 64));
+        }
+        //All of the words touched are now non zero
+        first = wf;
+        last = wl + 1;
+      }
+    }
+
+    //Clears the bits in [first, last), undefined if last > size()
+    void reset(size_t first, size_t last) noexcept {
+      for(int l = 0; l < _nlevels && first < last; ++l) {
+        uint64_t* words = _levels[l];
+        size_t wf = first / 64;
+        size_t wl = (last - 1) / 64;
+        if(wf == wl) {
+          words[wf] &= ~range_mask(int(first % 64), int((last - 1) % 64));
+        } else {
+          words[wf] = rstbitsge(words[wf], int(first % 64));
+          for(size_t w = wf + 1; w < wl; ++w) {
+            words[w] = 0;
+          }
+          words[wl] = rstbitsle(words[wl], int((last - 1) % 64));
+        }
+        //The words in between are now zero, the words at either end may still have bits set
+        first = wf + (words[wf] != 0);
+        last = wl + 1 - (wl != wf && words[wl] != 0);
+      }
+    }
+
+    //Returns the position of the first set bit >= i, npos if there is none
+    //x86_64 BMI: TZCNT
+    size_t find_next(size_t i) const noexcept {
+      if(i >= _nbits) {
+        return npos;
+      }
+      uint64_t x = shlr(_levels[0][i / 64], int(i % 64));
+      if(x != 0) {
+        return i + size_t(cntt0(x));
+      }
+      //Go up until a set bit after the current word is found
+      size_t j = i / 64;
+      int l = 1;
+      for(; l < _nlevels; ++l, j /= 64) {
+        x = rstbitsle(_levels[l][j / 64], int(j % 64));
+        if(x != 0) {
+          break;
+        }
+      }
+      if(l >= _nlevels) {
+        return npos;
+      }
+      //Then down to its first set bit
+      j = (j / 64) * 64 + size_t(cntt0(x));
+      while(--l >= 0) {
+        j = j * 64 + size_t(cntt0(_levels[l][j]));
+      }
+      return j;
+    }
+
+    //Returns the position of the last set bit <= i, npos if there is none.
+    //i >= size() searches the whole bitmap.
+    //x86_64 LZCNT
+    size_t find_prev(size_t i) const noexcept {
+      if(_nbits == 0) {
+        return npos;
+      }
+      if(i >= _nbits) {
+        i = _nbits - 1;
+      }
+      uint64_t x = shll(_levels[0][i / 64], 63 - int(i % 64));
+      if(x != 0) {
+        return i - size_t(cntl0(x));
+      }
+      //Go up until a set bit before the current word is found
+      size_t j = i / 64;
+      int l = 1;
+      for(; l < _nlevels; ++l, j /= 64) {
+        x = rstbitsge(_levels[l][j / 64], int(j % 64));
+        if(x != 0) {
+          break;
+        }
+      }
+      if(l >= _nlevels) {
+        return npos;
+      }
+      //Then down to its last set bit
+      j = (j / 64) * 64 + size_t(63 - cntl0(x));
+      while(--l >= 0) {
+        j = j * 64 + size_t(63 - cntl0(_levels[l][j]));
+      }
+      return j;
+    }
+
+  private:
+    //Bits lo to hi inclusive
+    static uint64_t range_mask(int lo, int hi) noexcept {
+      return setbitsge(uint64_t(0), lo) & setbitsle(uint64_t(0), hi);
+    }
+
+    size_t _nbits = 0;
+    int _nlevels = 0;
+    uint64_t* _levels[max_levels] = {};
+    std::unique_ptr<uint64_t[]> _storage;
+};
+
+} //namespace std
+
+#endif
@@ -0,0 +1,405 @@
+#ifndef VARINT_HH
+#define VARINT_HH
+
+#include "bitops.hh"
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace std {
+
+////////////////////////////////////
+//Variable length integers
+////////////////////////////////////
+
+//Unsigned values are LEB128 varints as in protocol buffers: 7 bits per byte starting with the
+//least significant ones, the high bit of a byte is set when another byte follows.
+//Signed values are zigzag encoded first, so values of small magnitude are short.
+
+//Maps 0, -1, 1, -2, 2 ... to 0, 1, 2, 3, 4 ...
+template <typename Integral>
+  constexpr auto zigzag_encode(Integral x) noexcept
+  -> typename std::enable_if<std::is_signed<Integral>::value, typename std::make_unsigned<Integral>::type>::type {
+    typedef typename std::make_unsigned<Integral>::type U;
+    return U(shll(U(x), 1) ^ U(shar(x, int(sizeof(x) * CHAR_BIT) - 1)));
+  }
+
+//Inverse of zigzag_encode
+template <typename Integral>
+  constexpr auto zigzag_decode(Integral x) noexcept
+  -> typename std::enable_if<std::is_unsigned<Integral>::value, typename std::make_signed<Integral>::type>::type {
+    return typename std::make_signed<Integral>::type(shlr(x, 1) ^ Integral(0u - (x & 1u)));
+  }
+
+//Maximum number of bytes of the varint of an Integral
+template <typename Integral>
+  constexpr auto varint_max_size() noexcept
+  -> typename std::enable_if<std::is_integral<Integral>::value, size_t>::type {
+    return (sizeof(Integral) * CHAR_BIT + 6) / 7;
+  }
+
+namespace bitops_detail {
+
+//The unsigned value which is encoded for x
+template <typename Integral>
+  constexpr auto varint_value(Integral x) noexcept
+  -> typename std::enable_if<std::is_unsigned<Integral>::value, Integral>::type {
+    return x;
+  }
+template <typename Integral>
+  constexpr auto varint_value(Integral x) noexcept
+  -> typename std::enable_if<std::is_signed<Integral>::value, typename std::make_unsigned<Integral>::type>::type {
+    return zigzag_encode(x);
+  }
+
+//The Integral which was encoded as the unsigned value u
+template <typename Integral>
+  constexpr auto varint_from(typename std::make_unsigned<Integral>::type u) noexcept
+  -> typename std::enable_if<std::is_unsigned<Integral>::value, Integral>::type {
+    return u;
+  }
+template <typename Integral>
+  constexpr auto varint_from(typename std::make_unsigned<Integral>::type u) noexcept
+  -> typename std::enable_if<std::is_signed<Integral>::value, Integral>::type {
+    return zigzag_decode(u);
+  }
+
+//Moves the 7 bit groups of x < 2^56 to the low bits of the bytes, deposit_bits(x, 0x7F7F7F7F7F7F7F7F)
+//x86_64 BMI2: PDEP
+constexpr14 uint64_t varint_spread(uint64_t x) noexcept {
+#if defined(BITOPS_PDEP)
+  return deposit_bits(x, uint64_t(0x7F7F7F7F7F7F7F7FULL));
+#else
+  x = (x & 0x000000000FFFFFFFULL) | (shll(x, 4) & 0x0FFFFFFF00000000ULL);
+  x = (x & 0x00003FFF00003FFFULL) | (shll(x, 2) & 0x3FFF00003FFF0000ULL);
+  return (x & 0x007F007F007F007FULL) | (shll(x, 1) & 0x7F007F007F007F00ULL);
+#endif
+}
+
+//Inverse of varint_spread, extract_bits(x, 0x7F7F7F7F7F7F7F7F)
+//x86_64 BMI2: PEXT
+constexpr14 uint64_t varint_compact(uint64_t x) noexcept {
+#if defined(BITOPS_PDEP)
+  return extract_bits(x, uint64_t(0x7F7F7F7F7F7F7F7FULL));
+#else
+  x = (x & 0x007F007F007F007FULL) | shlr(x & 0x7F007F007F007F00ULL, 1);
+  x = (x & 0x00003FFF00003FFFULL) | shlr(x & 0x3FFF00003FFF0000ULL, 2);
+  return (x & 0x000000000FFFFFFFULL) | shlr(x & 0x0FFFFFFF00000000ULL, 4);
+#endif
+}
+
+//Encodes v to out and returns its size. All 8 bytes of a varint of up to 8 bytes are
+//stored at once when room8 is true.
+inline size_t varint_encode_u64(uint64_t v, unsigned char* out, bool room8) noexcept {
+  size_t len = size_t(64 - cntl0(v | 1) + 6) / 7;
+  if(len <= 8) {
+    uint64_t w = varint_spread(v) | rstbitsge(uint64_t(0x8080808080808080ULL), int(len) * 8 - 8);
+    if(room8) {
+      store_le(out, w);
+    } else {
+      unsigned char b[8];
+      store_le(b, w);
+      std::memcpy(out, b, len);
+    }
+    return len;
+  }
+  store_le(out, varint_spread(rstbitsge(v, 56)) | 0x8080808080808080ULL);
+  out[8] = (unsigned char)(shlr(v, 56) & 0x7F) | (len == 10 ? 0x80 : 0);
+  if(len == 10) {
+    out[9] = 1;
+  }
+  return len;
+}
+
+//Decodes a varint of at most (nbits + 6) / 7 bytes whose value fits in nbits bits from the n bytes at p.
+//Returns its size, or 0 if it is truncated, too long or too large.
+//Single byte varints are checked for first. With 8 bytes left a varint of up to 8 bytes is then
+//decoded from a single load, the terminating byte is the lowest one without its high bit set.
+inline size_t varint_decode_u64(const unsigned char* p, size_t n, int nbits, uint64_t& v) noexcept {
+  const size_t max = size_t(nbits + 6) / 7;
+  if(n != 0 && p[0] < 0x80) {
+    v = p[0];
+    return 1;
+  }
+  if(n >= 8) {
+    uint64_t w = load_le<uint64_t>(p);
+    uint64_t stop = ~w & 0x8080808080808080ULL;
+    if(stop != 0) {
+      size_t len = size_t(cntt0(stop)) / 8 + 1;
+      uint64_t x = varint_compact(w & maskt0ls1b(stop) & 0x7F7F7F7F7F7F7F7FULL);
+      if(len > max || (nbits < 64 && shlr(x, nbits) != 0)) {
+        return 0;
+      }
+      v = x;
+      return len;
+    }
+  }
+  uint64_t x = 0;
+  for(size_t i = 0; i < n && i < max; ++i) {
+    uint64_t b = p[i] & 0x7F;
+    x |= shll(b, int(7 * i));
+    if(p[i] < 0x80) {
+      if(i + 1 == max && shlr(b, nbits - int(7 * i)) != 0) {
+        return 0;
+      }
+      v = x;
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+#if defined(BITOPS_RUNTIME_DISPATCH)
+//Tables of the masked VByte decoder.
+//ctl[e] moves 4 varints of 1 to 4 bytes to the 4 lanes of a vector, zero filling the lanes.
+//e is (l0 - 1) | (l1 - 1) << 2 | (l2 - 1) << 4 | (l3 - 1) << 6 for the byte lengths l0, l1, l2, l3.
+//step[m] is for the continuation bits m of 12 bytes. It holds the shuffle e for the up to 4 varints
+//of at most 4 bytes which end within them, the number of those varints and their total length.
+struct varint_decode_table {
+  struct entry {
+    unsigned char e;
+    unsigned char count;
+    unsigned char len;
+  };
+
+  alignas(16) unsigned char ctl[256][16];
+  entry step[4096];
+
+  varint_decode_table() noexcept {
+    for(int e = 0; e < 256; ++e) {
+      int off = 0;
+      for(int k = 0; k < 4; ++k) {
+        int len = ((e >> (2 * k)) & 3) + 1;
+        for(int b = 0; b < 4; ++b) {
+          ctl[e][4 * k + b] = (unsigned char)(b < len ? off + b : 0x80);
+        }
+        off += len;
+      }
+    }
+    for(unsigned m = 0; m < 4096; ++m) {
+      unsigned stop = ~m & 0xFFF;
+      int e = 0;
+      int pos = 0;
+      int k = 0;
+      for(; k < 4 && shlr(stop, pos) != 0; ++k) {
+        int len = cntt0(shlr(stop, pos)) + 1;
+        if(len > 4) {
+          break;
+        }
+        e |= (len - 1) << (2 * k);
+        pos += len;
+      }
+      step[m].e = (unsigned char)e;
+      step[m].count = (unsigned char)k;
+      step[m].len = (unsigned char)pos;
+    }
+  }
+};
+
+inline const varint_decode_table& varint_decode_tables() noexcept {
+  static const varint_decode_table t;
+  return t;
+}
+
+//Masked VByte decoding of 32 bit varints. Each step loads 16 bytes and looks up the next 4 varints
+//by the movemask of the continuation bits of the first 12. A pshufb moves them to the lanes, where
+//the 7 bit groups are joined with shifts and masks. A block of 16 single byte varints is zero
+//extended directly. Varints of 5 bytes are decoded one at a time.
+//Returns the number of varints decoded and advances p past them. Stops at a malformed varint or
+//when fewer than 16 bytes or 4 values are left.
+BITOPS_TARGET("ssse3") inline size_t varint_decode_ssse3(const unsigned char*& p, const unsigned char* end, uint32_t* out, size_t n) noexcept {
+  const varint_decode_table& t = varint_decode_tables();
+  const __m128i low7 = _mm_set1_epi32(0x7F7F7F7F);
+  const __m128i even7 = _mm_set1_epi32(0x007F007F);
+  const __m128i odd7 = _mm_set1_epi32(0x7F007F00);
+  const __m128i low14 = _mm_set1_epi32(0x00003FFF);
+  const __m128i high14 = _mm_set1_epi32(0x3FFF0000);
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  while(i + 4 <= n && end - p >= 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    unsigned m = unsigned(_mm_movemask_epi8(v));
+    if(m == 0 && i + 16 <= n) {
+      __m128i lo = _mm_unpacklo_epi8(v, zero);
+      __m128i hi = _mm_unpackhi_epi8(v, zero);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi16(lo, zero));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 4), _mm_unpackhi_epi16(lo, zero));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_unpacklo_epi16(hi, zero));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 12), _mm_unpackhi_epi16(hi, zero));
+      p += 16;
+      i += 16;
+      continue;
+    }
+    const varint_decode_table::entry s = t.step[m & 0xFFF];
+    if(s.count == 0) {
+      uint64_t x;
+      size_t len = varint_decode_u64(p, size_t(end - p), 32, x);
+      if(len == 0) {
+        break;
+      }
+      out[i++] = uint32_t(x);
+      p += len;
+      continue;
+    }
+    //The lanes past count are overwritten by the next step
+    __m128i c = _mm_load_si128(reinterpret_cast<const __m128i*>(t.ctl[s.e]));
+    __m128i x = _mm_and_si128(_mm_shuffle_epi8(v, c), low7);
+    x = _mm_or_si128(_mm_and_si128(x, even7), _mm_srli_epi32(_mm_and_si128(x, odd7), 1));
+    x = _mm_or_si128(_mm_and_si128(x, low14), _mm_srli_epi32(_mm_and_si128(x, high14), 2));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), x);
+    p += s.len;
+    i += s.count;
+  }
+  return i;
+}
+#endif
+
+//Varints decoded with SIMD from the start of the input
+template <typename U>
+  inline size_t varint_decode_simd(const unsigned char*&, const unsigned char*, U*, size_t) noexcept {
+    return 0;
+  }
+inline size_t varint_decode_simd(const unsigned char*& p, const unsigned char* end, uint32_t* out, size_t n) noexcept {
+#if defined(BITOPS_RUNTIME_DISPATCH)
+  if(has_ssse3()) {
+    return varint_decode_ssse3(p, end, out, n);
+  }
+#else
+  (void)p; (void)end; (void)out; (void)n;
+#endif
+  return 0;
+}
+
+} //namespace bitops_detail
+
+//Number of bytes of the varint of x, from the number of significant bits given by cntl0
+template <typename Integral>
+  constexpr14 auto varint_size(Integral x) noexcept
+  -> typename std::enable_if<std::is_integral<Integral>::value, size_t>::type {
+    auto u = bitops_detail::varint_value(x);
+    return size_t(int(sizeof(u) * CHAR_BIT) - cntl0(decltype(u)(u | 1u)) + 6) / 7;
+  }
+
+//Encodes x to p, which must have room for varint_size(x) bytes, and returns the number of bytes written.
+//Signed values are zigzag encoded.
+//x86_64 BMI2: PDEP
+template <typename Integral>
+  inline auto varint_encode(Integral x, void* p) noexcept
+  -> typename std::enable_if<std::is_integral<Integral>::value, size_t>::type {
+    return bitops_detail::varint_encode_u64(uint64_t(bitops_detail::varint_value(x)), static_cast<unsigned char*>(p), false);
+  }
+
+//Decodes a varint from the n bytes at p to x and returns the number of bytes read.
+//Returns 0 and leaves x unchanged if the varint is truncated, longer than varint_max_size<Integral>()
+//or does not fit in Integral.
+//x86_64 BMI2: PEXT
+template <typename Integral>
+  inline auto varint_decode(const void* p, size_t n, Integral& x) noexcept
+  -> typename std::enable_if<std::is_integral<Integral>::value, size_t>::type {
+    uint64_t v;
+    size_t len = bitops_detail::varint_decode_u64(static_cast<const unsigned char*>(p), n, int(sizeof(x) * CHAR_BIT), v);
+    if(len != 0) {
+      typedef typename std::make_unsigned<Integral>::type U;
+      x = bitops_detail::varint_from<Integral>(U(v));
+    }
+    return len;
+  }
+
+//Reads varints from a region of memory, such as a received message, without copying it.
+//The read functions fail at a varint which is truncated or malformed, without moving past it.
+class varint_reader {
+  public:
+    varint_reader() noexcept = default;
+    varint_reader(const void* p, size_t n) noexcept
+      : _p(static_cast<const unsigned char*>(p)), _end(_p + n) {}
+
+    //Current position
+    const unsigned char* data() const noexcept { return _p; }
+
+    //Number of bytes left
+    size_t remaining() const noexcept { return size_t(_end - _p); }
+
+    //Decodes the varint at the current position to x and moves past it,
+    //returns false and leaves x and the reader unchanged if it is truncated or malformed
+    template <typename Integral>
+      bool read(Integral& x) noexcept {
+        size_t len = varint_decode(_p, remaining(), x);
+        _p += len;
+        return len != 0;
+      }
+
+    //Decodes up to n varints to out and returns the number decoded, which is less than n
+    //at the end of the input or at a malformed varint.
+    //x86_64 SSSE3: masked VByte decoding with pshufb for 32 bit values
+    template <typename Integral>
+      auto read(Integral* out, size_t n) noexcept
+      -> typename std::enable_if<std::is_integral<Integral>::value, size_t>::type {
+        typedef typename std::make_unsigned<Integral>::type U;
+        U* u = reinterpret_cast<U*>(out);
+        size_t i = bitops_detail::varint_decode_simd(_p, _end, u, n);
+        for(; i < n; ++i) {
+          uint64_t v;
+          size_t len = bitops_detail::varint_decode_u64(_p, remaining(), int(sizeof(U) * CHAR_BIT), v);
+          if(len == 0) {
+            break;
+          }
+          u[i] = U(v);
+          _p += len;
+        }
+        if(std::is_signed<Integral>::value) {
+          for(size_t j = 0; j < i; ++j) {
+            out[j] = bitops_detail::varint_from<Integral>(u[j]);
+          }
+        }
+        return i;
+      }
+
+  private:
+    const unsigned char* _p = nullptr;
+    const unsigned char* _end = nullptr;
+};
+
+//Writes varints to a caller provided buffer.
+//The write functions fail when the next varint does not fit, without writing it.
+class varint_writer {
+  public:
+    varint_writer() noexcept = default;
+    varint_writer(void* p, size_t n) noexcept
+      : _p(static_cast<unsigned char*>(p)), _end(_p + n) {}
+
+    //Current position, the end of the varints written so far
+    unsigned char* data() const noexcept { return _p; }
+
+    //Number of bytes left
+    size_t remaining() const noexcept { return size_t(_end - _p); }
+
+    //Encodes x at the current position and moves past it, returns false if it does not fit
+    template <typename Integral>
+      auto write(Integral x) noexcept
+      -> typename std::enable_if<std::is_integral<Integral>::value, bool>::type {
+        uint64_t v = uint64_t(bitops_detail::varint_value(x));
+        if(remaining() < varint_max_size<Integral>() && remaining() < varint_size(v)) {
+          return false;
+        }
+        _p += bitops_detail::varint_encode_u64(v, _p, remaining() >= 8);
+        return true;
+      }
+
+    //Encodes up to n values from in and returns the number written, which is less than n
+    //when the next one does not fit.
+    template <typename Integral>
+      size_t write(const Integral* in, size_t n) noexcept {
+        size_t i = 0;
+        for(; i < n && write(in[i]); ++i) {}
+        return i;
+      }
+
+  private:
+    unsigned char* _p = nullptr;
+    unsigned char* _end = nullptr;
+};
+
+} //namespace std
+
+#endif
@@ -0,0 +1,98 @@
+#include <bitmap_expr.hh>
+#include "driver.hh"
+
+#include <vector>
+
+using namespace std;
+
+static std::vector<uint64_t> random_words(size_t n, uint64_t seed) {
+  std::vector<uint64_t> v(n);
+  xorshift64 rng(seed);
+  for(auto& x : v) x = rng();
+  return v;
+}
+
+static uint64_t apply_op(bitmap_op op, uint64_t l, uint64_t r) {
+  switch(op) {
+    case bitmap_op::bit_and: return l & r;
+    case bitmap_op::bit_or: return l | r;
+    case bitmap_op::bit_xor: return l ^ r;
+    default: return l & ~r;
+  }
+}
+
+//Random trees over the inputs, with the reference result of each node computed word by word
+struct RandomTree {
+  std::vector<std::vector<uint64_t>> inputs;
+  std::vector<std::vector<uint64_t>> ref;
+  bitmap_expr e;
+  xorshift64 next;
+
+  RandomTree(size_t nwords, uint64_t seed) : e(nwords), next(seed) {}
+
+  int build(int depth) {
+    int i;
+    if(depth == 0 || next() % 4 == 0) {
+      inputs.push_back(random_words(e.size(), next()));
+      i = e.input(inputs.back().data());
+      ref.resize(size_t(i) + 1);
+      ref[size_t(i)] = inputs.back();
+      return i;
+    }
+    bitmap_op op = bitmap_op(next() % 4);
+    int l = build(depth - 1);
+    int rr = build(depth - 1);
+    i = e.apply(op, l, rr);
+    ref.resize(size_t(i) + 1);
+    for(size_t w = 0; w < e.size(); ++w) {
+      ref[size_t(i)].push_back(apply_op(op, ref[size_t(l)][w], ref[size_t(rr)][w]));
+    }
+    return i;
+  }
+};
+
+TEST(BitmapExprTest, Operators) {
+  const size_t nwords = 1000;
+  std::vector<uint64_t> a = random_words(nwords, 1), b = random_words(nwords, 2);
+  for(int op = 0; op < 4; ++op) {
+    for(bool swap : {false, true}) {
+      bitmap_expr e(nwords);
+      int ia = e.input(a.data());
+      int ib = e.input(b.data());
+      int root = swap ? e.apply(bitmap_op(op), ib, ia) : e.apply(bitmap_op(op), ia, ib);
+      std::vector<uint64_t> out(nwords + 1, 0x5A);
+      size_t c = e.evaluate_count(root, out.data());
+      size_t expect = 0;
+      for(size_t w = 0; w < nwords; ++w) {
+        uint64_t x = swap ? apply_op(bitmap_op(op), b[w], a[w]) : apply_op(bitmap_op(op), a[w], b[w]);
+        ASSERT_EQ(x, out[w]) << op << " " << w;
+        expect += size_t(popcount(x));
+      }
+      ASSERT_EQ(0x5Au, out[nwords]);
+      ASSERT_EQ(expect, c);
+      ASSERT_EQ(expect, e.count(root));
+    }
+  }
+}
+
+TEST(BitmapExprTest, Trees) {
+  //Sizes around the chunk and vector sizes
+  for(size_t nwords : {0, 1, 7, 255, 256, 257, 1000}) {
+    for(int t = 0; t < 20; ++t) {
+      RandomTree tree(nwords, 0x9E3779B97F4A7C15ULL + uint64_t(t));
+      int root = tree.build(1 + t % 6);
+      const std::vector<uint64_t>& expect = tree.ref[size_t(root)];
+      size_t c = 0;
+      for(uint64_t x : expect) {
+        c += size_t(popcount(x));
+      }
+      std::vector<uint64_t> out(nwords);
+      tree.e.evaluate(root, out.data());
+      ASSERT_EQ(expect, out) << nwords << " " << t;
+      ASSERT_EQ(c, tree.e.count(root));
+      std::fill(out.begin(), out.end(), 0);
+      ASSERT_EQ(c, tree.e.evaluate_count(root, out.data()));
+      ASSERT_EQ(expect, out);
+    }
+  }
+}
@@ -0,0 +1,87 @@
+#include <bitops.hh>
+#include "driver.hh"
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+template <typename T>
+class BitPositionsTest : public ::testing::Test {
+};
+TYPED_TEST_CASE_P(BitPositionsTest);
+
+template <typename T>
+std::vector<T> bitpos_inputs(size_t n, int sparsity) {
+  std::vector<T> v(n);
+  xorshift64 next(0x9E3779B97F4A7C15ULL + uint64_t(sparsity));
+  for(auto& x : v) {
+    uint64_t w = next();
+    for(int i = 0; i < sparsity; ++i) w &= next();
+    x = T(w);
+  }
+  return v;
+}
+
+TYPED_TEST_P(BitPositionsTest, Integer) {
+  typedef TypeParam T;
+  constexpr int nbits = int(sizeof(T) * CHAR_BIT);
+
+  ASSERT_TRUE(bit_positions(T(0)).empty());
+  ASSERT_EQ(bit_positions(T(0)).begin(), bit_positions(T(0)).end());
+
+  for(T x : bitpos_inputs<T>(64, 1)) {
+    std::vector<int> expected;
+    for(int i = 0; i < nbits; ++i) {
+      if(testbit(x, i)) expected.push_back(i);
+    }
+    std::vector<int> got;
+    for(int i : bit_positions(x)) got.push_back(i);
+    ASSERT_EQ(expected, got);
+    ASSERT_EQ(expected.size(), bit_positions(x).size());
+  }
+
+  std::vector<int> all;
+  for(int i : bit_positions(T(~T(0)))) all.push_back(i);
+  ASSERT_EQ(size_t(nbits), all.size());
+  ASSERT_EQ(nbits - 1, all.back());
+}
+
+TYPED_TEST_P(BitPositionsTest, Array) {
+  typedef TypeParam T;
+  constexpr size_t nbits = sizeof(T) * CHAR_BIT;
+
+  for(int sparsity = 0; sparsity < 6; sparsity += 2) {
+    std::vector<T> v = bitpos_inputs<T>(301, sparsity);
+    //Runs of zero elements at the start, middle and end
+    std::fill(v.begin(), v.begin() + 5, T(0));
+    std::fill(v.begin() + 100, v.begin() + 150, T(0));
+    std::fill(v.end() - 7, v.end(), T(0));
+
+    std::vector<uint32_t> expected;
+    for(size_t i = 0; i < v.size() * nbits; ++i) {
+      if(testbit(v[i / nbits], int(i % nbits))) expected.push_back(uint32_t(i));
+    }
+
+    std::vector<uint32_t> got;
+    for(size_t i : bit_positions(v.data(), v.size())) got.push_back(uint32_t(i));
+    ASSERT_EQ(expected, got);
+
+    std::vector<uint32_t> out(expected.size() + 16);
+    size_t n = decode_bit_positions(v.data(), v.size(), out.data());
+    ASSERT_EQ(expected.size(), n);
+    out.resize(n);
+    ASSERT_EQ(expected, out);
+
+    //Odd lengths leave a tail for the scalar decoder
+    out.assign(expected.size() + 16, 0);
+    n = decode_bit_positions(v.data(), 3, out.data());
+    out.resize(n);
+    ASSERT_EQ(std::vector<uint32_t>(expected.begin(), expected.begin() + n), out);
+  }
+
+  ASSERT_EQ(bit_positions(static_cast<const T*>(nullptr), 0).begin(), bit_positions(static_cast<const T*>(nullptr), 0).end());
+}
+
+REGISTER_TYPED_TEST_CASE_P(BitPositionsTest, Integer, Array);
+INSTANTIATE_TYPED_TEST_CASE_P(Ints, BitPositionsTest, IntTypes);
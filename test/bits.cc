@@ -0,0 +1,95 @@
+#include <bitops.hh>
+#include "driver.hh"
+
+#include <limits>
+
+using namespace std;
+
+template <typename T>
+class BitsTest : public ::testing::Test {
+};
+TYPED_TEST_CASE_P(BitsTest);
+
+//Values including the extremes of signed types, where x + 1, x - 1 and -x overflow
+template <typename T>
+std::vector<T> bits_inputs() {
+  return {T(0), T(1), T(2), T(6), T(0x5A), T(~T(0)), T(~T(1)),
+    std::numeric_limits<T>::min(), std::numeric_limits<T>::max()};
+}
+
+TYPED_TEST_P(BitsTest, Rightmost) {
+  typedef TypeParam T;
+  typedef typename std::make_unsigned<T>::type U;
+
+  for(T x : bits_inputs<T>()) {
+    U u = U(x);
+    ASSERT_EQ(T(u & U(u - 1)), rstls1b(x));
+    ASSERT_EQ(T(u | U(u + 1)), setls0b(x));
+    ASSERT_EQ(T(u & U(0u - u)), isols1b(x));
+    ASSERT_EQ(T(U(~u) & U(u + 1)), isols0b(x));
+    ASSERT_EQ(T(u & U(u + 1)), rstt1(x));
+    ASSERT_EQ(T(u | U(u - 1)), sett0(x));
+    ASSERT_EQ(T(U(~u) & U(u - 1)), maskt0(x));
+    ASSERT_EQ(T(~U(U(~u) | U(u + 1))), maskt1(x));
+    ASSERT_EQ(T(U(u - 1) ^ u), maskt0ls1b(x));
+    ASSERT_EQ(T(u ^ U(u + 1)), maskt1ls0b(x));
+  }
+}
+
+TYPED_TEST_P(BitsTest, Range) {
+  typedef TypeParam T;
+  constexpr int nbits = int(sizeof(T) * CHAR_BIT);
+
+  for(T x : bits_inputs<T>()) {
+    for(int b = 0; b < nbits; ++b) {
+      T ge = 0, le = 0;
+      for(int i = 0; i < nbits; ++i) {
+        if(i >= b) ge = setbit(ge, i);
+        if(i <= b) le = setbit(le, i);
+      }
+      ASSERT_EQ(T(x & ~ge), rstbitsge(x, b));
+      ASSERT_EQ(T(x & ~le), rstbitsle(x, b));
+      ASSERT_EQ(T(x | ge), setbitsge(x, b));
+      ASSERT_EQ(T(x | le), setbitsle(x, b));
+      ASSERT_EQ(T(x ^ ge), flipbitsge(x, b));
+      ASSERT_EQ(T(x ^ le), flipbitsle(x, b));
+
+      ASSERT_TRUE(testbit(setbit(x, b), b));
+      ASSERT_FALSE(testbit(rstbit(x, b), b));
+      ASSERT_NE(testbit(x, b), testbit(flipbit(x, b), b));
+    }
+  }
+}
+
+TYPED_TEST_P(BitsTest, Pow2) {
+  typedef TypeParam T;
+  typedef typename std::make_unsigned<T>::type U;
+  constexpr int nbits = int(sizeof(T) * CHAR_BIT);
+
+  ASSERT_EQ(T(0), ceilp2(T(0)));
+  ASSERT_EQ(T(1), ceilp2(T(1)));
+  ASSERT_EQ(T(8), ceilp2(T(5)));
+  ASSERT_EQ(T(4), floorp2(T(5)));
+  ASSERT_EQ(T(0), floorp2(T(0)));
+  ASSERT_EQ(-1, ilog2(T(0)));
+  ASSERT_EQ(0, ilog2(T(1)));
+  ASSERT_EQ(2, ilog2(T(5)));
+  for(int b = 1; b < nbits - 1; ++b) {
+    T p = shll(T(1), b);
+    ASSERT_TRUE(ispow2(p));
+    ASSERT_FALSE(ispow2(T(p + 1)));
+    ASSERT_EQ(p, ceilp2(p));
+    ASSERT_EQ(T(shll(p, 1)), ceilp2(T(p + 1)));
+    ASSERT_EQ(p, floorp2(T(U(shll(p, 1)) - 1u)));
+    ASSERT_EQ(b, ilog2(p));
+    ASSERT_EQ(b, ilog2(T(U(shll(p, 1)) - 1u)));
+  }
+  //Signed values are rounded like the unsigned values with the same bits
+  const T top = shll(T(1), nbits - 1);
+  ASSERT_EQ(top, ceilp2(top));
+  ASSERT_EQ(top, ceilp2(T(U(top) - 1u)));
+  ASSERT_EQ(top, floorp2(T(~T(0))));
+}
+
+REGISTER_TYPED_TEST_CASE_P(BitsTest, Rightmost, Range, Pow2);
+INSTANTIATE_TYPED_TEST_CASE_P(Ints, BitsTest, IntTypes);
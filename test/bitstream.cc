@@ -0,0 +1,125 @@
+#include <bit_stream.hh>
+#include "driver.hh"
+
+#include <vector>
+
+using namespace std;
+
+template <typename T>
+class BitStreamTest : public ::testing::Test {
+};
+TYPED_TEST_CASE_P(BitStreamTest);
+
+template <bit_order Order>
+struct Order_ {
+  static constexpr bit_order value = Order;
+};
+typedef ::testing::Types<Order_<bit_order::lsb_first>, Order_<bit_order::msb_first>> BitOrders;
+
+//Bit i of the stream
+static bool stream_bit(const std::vector<unsigned char>& b, size_t i, bit_order order) {
+  return testbit(b[i / 8], order == bit_order::lsb_first ? int(i % 8) : 7 - int(i % 8));
+}
+
+//Fields of random widths from 0 to 56 bits
+struct field {
+  uint64_t x;
+  int n;
+};
+static std::vector<field> random_fields(size_t count) {
+  std::vector<field> f(count);
+  xorshift64 rng;
+  for(auto& x : f) {
+    x.n = int(rng() % 57);
+    x.x = rng();
+  }
+  return f;
+}
+
+TYPED_TEST_P(BitStreamTest, WriteRead) {
+  constexpr bit_order order = TypeParam::value;
+
+  std::vector<field> fields = random_fields(1000);
+  size_t nbits = 0;
+  for(auto& f : fields) {
+    nbits += size_t(f.n);
+  }
+  //Exact size, so the last writes and reads take the paths near the end
+  std::vector<unsigned char> buf((nbits + 7) / 8);
+  bit_writer<order> w(buf.data(), buf.size());
+  for(auto& f : fields) {
+    w.write(f.x, f.n);
+  }
+  ASSERT_EQ(nbits, w.tell());
+  ASSERT_EQ(buf.size(), w.flush());
+  ASSERT_FALSE(w.overflow());
+
+  //Each field is stored first bit first, its least significant or most significant bit first
+  size_t pos = 0;
+  for(auto& f : fields) {
+    for(int b = 0; b < f.n; ++b) {
+      int src = order == bit_order::lsb_first ? b : f.n - 1 - b;
+      ASSERT_EQ(testbit(f.x, src), stream_bit(buf, pos + size_t(b), order)) << pos << " " << b;
+    }
+    pos += size_t(f.n);
+  }
+  for(; pos < buf.size() * 8; ++pos) {
+    ASSERT_FALSE(stream_bit(buf, pos, order));
+  }
+
+  bit_reader<order> r(buf.data(), buf.size());
+  for(auto& f : fields) {
+    ASSERT_EQ(rstbitsge(f.x, f.n), r.read(f.n));
+  }
+  ASSERT_EQ(nbits, r.tell());
+  ASSERT_FALSE(r.overrun());
+  //Past the end are zero bits
+  ASSERT_EQ(0u, r.read(56));
+  ASSERT_TRUE(r.overrun());
+}
+
+TYPED_TEST_P(BitStreamTest, PeekConsume) {
+  constexpr bit_order order = TypeParam::value;
+
+  std::vector<unsigned char> buf(100);
+  for(size_t i = 0; i < buf.size(); ++i) {
+    buf[i] = (unsigned char)(i * 37 + 11);
+  }
+  bit_reader<order> r(buf.data() + 1, buf.size() - 1);
+  size_t pos = 8;
+  for(int n = 0; pos + 56 <= buf.size() * 8; n = (n + 5) % 57) {
+    r.refill();
+    ASSERT_GE(r.available(), 56);
+    uint64_t x = r.peek(n);
+    for(int b = 0; b < n; ++b) {
+      int dst = order == bit_order::lsb_first ? b : n - 1 - b;
+      ASSERT_EQ(stream_bit(buf, pos + size_t(b), order), testbit(x, dst)) << pos << " " << n;
+    }
+    ASSERT_EQ(x, r.peek(n));
+    r.consume(n);
+    pos += size_t(n);
+    ASSERT_EQ(pos - 8, r.tell());
+  }
+}
+
+TYPED_TEST_P(BitStreamTest, Overflow) {
+  constexpr bit_order order = TypeParam::value;
+
+  unsigned char buf[4] = {};
+  bit_writer<order> w(buf, 3);
+  w.write(0xFFFF, 16);
+  w.write(0x5, 3);
+  ASSERT_FALSE(w.overflow());
+  w.write(0x3, 2);
+  ASSERT_EQ(3u, w.flush());
+  ASSERT_FALSE(w.overflow());
+  w.write(0xFF, 8);
+  ASSERT_TRUE(w.overflow());
+  ASSERT_EQ(0xFF, buf[0]);
+  ASSERT_EQ(0xFF, buf[1]);
+  ASSERT_EQ(order == bit_order::lsb_first ? 0x1D : 0xB8, buf[2]);
+  ASSERT_EQ(0, buf[3]);
+}
+
+REGISTER_TYPED_TEST_CASE_P(BitStreamTest, WriteRead, PeekConsume, Overflow);
+INSTANTIATE_TYPED_TEST_CASE_P(Orders, BitStreamTest, BitOrders);
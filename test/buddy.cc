@@ -0,0 +1,140 @@
+#include <buddy_allocator.hh>
+#include "driver.hh"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+using namespace std;
+
+struct buddy_region {
+  buddy_region(size_t capacity, size_t min_block)
+    : mem(capacity / 8 + 1), meta(buddy_allocator::metadata_words(capacity, min_block)),
+    alloc(mem.data(), capacity, min_block, meta.data()) {}
+
+  std::vector<uint64_t> mem;
+  std::vector<uint64_t> meta;
+  buddy_allocator alloc;
+};
+
+TEST(BuddyTest, Exhaust) {
+  buddy_region r(1 << 16, 64);
+  buddy_allocator& a = r.alloc;
+  ASSERT_EQ(size_t(1 << 16), a.capacity());
+  ASSERT_EQ(size_t(1 << 16), a.max_block());
+  ASSERT_EQ(size_t(64), a.block_size(1));
+  ASSERT_EQ(size_t(128), a.block_size(65));
+  ASSERT_EQ(size_t(1 << 16), a.block_size(1 << 16));
+
+  std::vector<char*> blocks;
+  for(char* p; (p = static_cast<char*>(a.allocate(64))) != nullptr;) {
+    ASSERT_TRUE(is_aligned(size_t(p - reinterpret_cast<char*>(r.mem.data())), 64));
+    blocks.push_back(p);
+  }
+  ASSERT_EQ(size_t(1024), blocks.size());
+  ASSERT_EQ(0u, a.available());
+  std::sort(blocks.begin(), blocks.end());
+  ASSERT_TRUE(std::adjacent_find(blocks.begin(), blocks.end()) == blocks.end());
+
+  //Freeing in any order merges everything back into one block
+  for(size_t i = 0; i < blocks.size(); ++i) {
+    a.deallocate(blocks[i * 389 % blocks.size()], 64);
+  }
+  ASSERT_EQ(size_t(1 << 16), a.available());
+  void* p = a.allocate(1 << 16);
+  ASSERT_EQ(static_cast<void*>(r.mem.data()), p);
+  ASSERT_EQ(nullptr, a.allocate(1));
+  a.deallocate(p, 1 << 16);
+  ASSERT_EQ(nullptr, a.allocate((1 << 16) + 1));
+}
+
+TEST(BuddyTest, Churn) {
+  //Not a power of 2, so the region starts as several blocks
+  const size_t capacity = 3 * 4096 + 5 * 256 + 100;
+  buddy_region r(capacity, 256);
+  buddy_allocator& a = r.alloc;
+  ASSERT_EQ(capacity - 100, a.capacity());
+  ASSERT_EQ(size_t(8192), a.max_block());
+
+  char* base = reinterpret_cast<char*>(r.mem.data());
+  std::map<char*, size_t> live;
+  xorshift64 rng;
+  for(int iter = 0; iter < 20000; ++iter) {
+    const uint64_t s = rng();
+    if(s % 3 != 0 || live.empty()) {
+      size_t n = 1 + size_t(s >> 20) % 5000;
+      char* p = static_cast<char*>(a.allocate(n));
+      if(p == nullptr) {
+        continue;
+      }
+      size_t size = a.block_size(n);
+      ASSERT_TRUE(is_aligned(size_t(p - base), size));
+      ASSERT_LE(size_t(p - base) + size, a.capacity());
+      //No overlap with the neighbouring live blocks
+      auto next = live.lower_bound(p);
+      if(next != live.end()) {
+        ASSERT_LE(p + size, next->first);
+      }
+      if(next != live.begin()) {
+        --next;
+        ASSERT_LE(next->first + a.block_size(next->second), p);
+      }
+      live[p] = n;
+    } else {
+      auto it = live.begin();
+      std::advance(it, (s >> 32) % live.size());
+      a.deallocate(it->first, it->second);
+      live.erase(it);
+    }
+    size_t used = 0;
+    for(auto& b : live) {
+      used += a.block_size(b.second);
+    }
+    ASSERT_EQ(a.capacity() - used, a.available());
+  }
+  for(auto& b : live) {
+    a.deallocate(b.first, b.second);
+  }
+
+  //Fully merged again: the 8192, 4096 and 1024 byte blocks at the start
+  ASSERT_EQ(a.capacity(), a.available());
+  ASSERT_EQ(static_cast<void*>(base), a.allocate(8192));
+  ASSERT_EQ(static_cast<void*>(base + 8192), a.allocate(4096));
+  ASSERT_EQ(static_cast<void*>(base + 12288), a.allocate(1024));
+  ASSERT_EQ(static_cast<void*>(base + 13312), a.allocate(256));
+  ASSERT_EQ(nullptr, a.allocate(256));
+}
+
+TEST(BuddyTest, FarBlock) {
+  //262144 blocks of order 0, so their bitmap has two summary levels above it
+  const size_t capacity = size_t(1) << 22;
+  buddy_region r(capacity, 16);
+  buddy_allocator& a = r.alloc;
+  char* base = reinterpret_cast<char*>(r.mem.data());
+  for(size_t i = 0; i < capacity / 16; ++i) {
+    ASSERT_EQ(static_cast<void*>(base + i * 16), a.allocate(16)) << i;
+  }
+  ASSERT_EQ(nullptr, a.allocate(16));
+
+  //The only free block alternates between the low end and anywhere else
+  xorshift64 rng;
+  for(int k = 0; k < 10000; ++k) {
+    size_t i = k % 2 == 0 ? size_t(k) % 64 : size_t(rng() % (capacity / 16));
+    a.deallocate(base + i * 16, 16);
+    ASSERT_EQ(static_cast<void*>(base + i * 16), a.allocate(16)) << k;
+    ASSERT_EQ(nullptr, a.allocate(16));
+  }
+
+  for(size_t i = capacity / 16; i-- > 0;) {
+    a.deallocate(base + i * 16, 16);
+  }
+  ASSERT_EQ(capacity, a.available());
+  ASSERT_EQ(static_cast<void*>(base), a.allocate(capacity));
+}
+
+TEST(BuddyTest, Small) {
+  buddy_region r(100, 128);
+  ASSERT_EQ(0u, r.alloc.capacity());
+  ASSERT_EQ(0u, r.alloc.max_block());
+  ASSERT_EQ(nullptr, r.alloc.allocate(1));
+}
@@ -0,0 +1,214 @@
+#include <byte_scan.hh>
+#include "driver.hh"
+
+#include <vector>
+#if defined(__unix__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static size_t ref_first(const unsigned char* p, size_t n, const byte_set& s) {
+  size_t i = 0;
+  while(i < n && !s.test(p[i])) ++i;
+  return i;
+}
+
+static size_t ref_last(const unsigned char* p, size_t n, unsigned char c) {
+  for(size_t i = n; i-- > 0;) {
+    if(p[i] == c) return i;
+  }
+  return n;
+}
+
+static size_t index_of(const void* r, const unsigned char* p, size_t n) {
+  return r == nullptr ? n : size_t(static_cast<const unsigned char*>(r) - p);
+}
+
+//Every start alignment and length up to 3 vectors, with the byte at every position and everywhere
+//outside the range, which must not be found
+TEST(ByteScanTest, Memchr) {
+  std::vector<unsigned char> buf(256, 'x');
+  for(size_t start = 64; start < 96; ++start) {
+    for(size_t n = 0; n <= 100; ++n) {
+      unsigned char* p = buf.data() + start;
+      std::fill(buf.begin(), buf.end(), 'c');
+      std::fill(p, p + n, 'x');
+      ASSERT_EQ(nullptr, scan_memchr(p, 'c', n)) << start << " " << n;
+      ASSERT_EQ(nullptr, scan_memrchr(p, 'c', n)) << start << " " << n;
+      for(size_t i = 0; i < n; ++i) {
+        p[i] = 'c';
+        ASSERT_EQ(p + i, scan_memchr(p, 'c', n)) << start << " " << n << " " << i;
+        ASSERT_EQ(p + i, scan_memrchr(p, 'c', n)) << start << " " << n << " " << i;
+        //The first and last of 2
+        if(i + 5 < n) {
+          p[i + 5] = 'c';
+          ASSERT_EQ(p + i, scan_memchr(p, 'c', n));
+          ASSERT_EQ(p + i + 5, scan_memrchr(p, 'c', n));
+          p[i + 5] = 'x';
+        }
+        p[i] = 'x';
+      }
+    }
+  }
+}
+
+//Ranges long enough for the steps of 4 vectors, with the byte in every position of them
+TEST(ByteScanTest, MemchrLong) {
+  std::vector<unsigned char> buf(1024, 'x');
+  for(size_t start : {0, 1, 17, 63, 64, 100, 127}) {
+    for(size_t n : {128, 255, 256, 300, 700}) {
+      unsigned char* p = buf.data() + start;
+      ASSERT_EQ(nullptr, scan_memchr(p, 'c', n));
+      ASSERT_EQ(nullptr, scan_memrchr(p, 'c', n));
+      for(size_t i = 0; i < n; ++i) {
+        p[i] = 'c';
+        ASSERT_EQ(p + i, scan_memchr(p, 'c', n)) << start << " " << n << " " << i;
+        ASSERT_EQ(p + i, scan_memrchr(p, 'c', n)) << start << " " << n << " " << i;
+        ASSERT_EQ(p + i, scan_first_of(p, n, byte_set("bc"))) << start << " " << n << " " << i;
+        p[i] = '\0';
+        ASSERT_EQ(i, scan_strlen(reinterpret_cast<const char*>(p))) << start << " " << i;
+        p[i] = 'x';
+      }
+    }
+  }
+}
+
+TEST(ByteScanTest, MemchrRandom) {
+  std::vector<unsigned char> buf(4096);
+  xorshift64 rng;
+  for(auto& b : buf) b = (unsigned char)rng();
+  for(int k = 0; k < 2000; ++k) {
+    const uint64_t r = rng();
+    size_t start = r % 2048;
+    size_t n = (r >> 16) % 2048;
+    unsigned char c = (unsigned char)(r >> 32);
+    const unsigned char* p = buf.data() + start;
+    ASSERT_EQ(memchr(p, c, n), scan_memchr(p, c, n));
+    ASSERT_EQ(ref_last(p, n, c), index_of(scan_memrchr(p, c, n), p, n));
+  }
+}
+
+TEST(ByteScanTest, Strlen) {
+  std::vector<char> buf(256);
+  for(size_t start = 64; start < 96; ++start) {
+    for(size_t n = 0; n <= 100; ++n) {
+      std::fill(buf.begin(), buf.end(), '\0');
+      std::fill(buf.begin() + ptrdiff_t(start), buf.begin() + ptrdiff_t(start + n), 'a');
+      ASSERT_EQ(n, scan_strlen(buf.data() + start)) << start << " " << n;
+    }
+  }
+  ASSERT_EQ(0u, scan_strlen(""));
+  ASSERT_EQ(11u, scan_strlen("hello world"));
+}
+
+TEST(ByteScanTest, FirstOf) {
+  byte_set empty;
+  byte_set delims(" \t,=\n");
+  for(int c = 0; c < 256; ++c) {
+    ASSERT_FALSE(empty.test((unsigned char)c));
+    ASSERT_EQ(c == ' ' || c == '\t' || c == ',' || c == '=' || c == '\n', delims.test((unsigned char)c));
+  }
+  const char line[] = "level=info msg=started,pid=1";
+  ASSERT_EQ(line + 5, scan_first_of(line, sizeof(line) - 1, delims));
+  ASSERT_EQ(nullptr, scan_first_of(line, 5, delims));
+  ASSERT_EQ(nullptr, scan_first_of(line, sizeof(line) - 1, empty));
+
+  //Random sets of every size with bytes from the whole range, every byte value in every position
+  std::vector<unsigned char> buf(512);
+  xorshift64 rng;
+  for(auto& b : buf) b = (unsigned char)rng();
+  for(int k = 0; k < 300; ++k) {
+    byte_set s;
+    for(int i = 0; i < k % 40; ++i) s.set((unsigned char)rng());
+    const uint64_t r = rng();
+    size_t start = r % 256;
+    size_t n = (r >> 16) % 256;
+    const unsigned char* p = buf.data() + start;
+    ASSERT_EQ(ref_first(p, n, s), index_of(scan_first_of(p, n, s), p, n)) << k;
+  }
+  for(int c = 0; c < 256; ++c) {
+    byte_set s;
+    s.set((unsigned char)c);
+    for(size_t i = 0; i < 64; ++i) {
+      std::vector<unsigned char> v(64, (unsigned char)(c + 1));
+      v[i] = (unsigned char)c;
+      ASSERT_EQ(v.data() + i, scan_first_of(v.data(), v.size(), s)) << c << " " << i;
+    }
+  }
+}
+
+//Sets of bytes < 0x80 with different low nibbles take the single pshufb match, the others the nibble lookup
+TEST(ByteScanTest, FirstOfDirect) {
+  ASSERT_NE(nullptr, byte_set(" \t,=\n").direct_table());
+  ASSERT_NE(nullptr, byte_set("aa").direct_table());
+  ASSERT_EQ(nullptr, byte_set("{[").direct_table());
+  ASSERT_EQ(nullptr, byte_set("a\x80").direct_table());
+  ASSERT_EQ(nullptr, byte_set("\x10\x20").direct_table());
+
+  std::vector<unsigned char> buf(512);
+  xorshift64 rng(0x2545F4914F6CDD1DULL);
+  for(auto& b : buf) b = (unsigned char)(rng() & 0x7F);
+  for(int k = 0; k < 300; ++k) {
+    //A byte of each of k % 17 low nibbles, then with k >= 150 one which shares a low nibble
+    byte_set s;
+    for(int i = 0; i < k % 17; ++i) {
+      s.set((unsigned char)(((rng() >> 8) & 0x70) | unsigned(i)));
+    }
+    if(k >= 150) {
+      s.set((unsigned char)(0x80 | (k & 0x7F)));
+    }
+    ASSERT_EQ(k < 150, s.direct_table() != nullptr) << k;
+    const uint64_t r = rng();
+    size_t start = r % 256;
+    size_t n = (r >> 16) % 256;
+    const unsigned char* p = buf.data() + start;
+    ASSERT_EQ(ref_first(p, n, s), index_of(scan_first_of(p, n, s), p, n)) << k;
+  }
+}
+
+#if defined(__unix__)
+//Ranges ending at a page which may not be read
+TEST(ByteScanTest, PageEnd) {
+  size_t page = size_t(sysconf(_SC_PAGESIZE));
+  void* m = mmap(nullptr, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  ASSERT_NE(MAP_FAILED, m);
+  unsigned char* p = static_cast<unsigned char*>(m);
+  ASSERT_EQ(0, mprotect(p + page, page, PROT_NONE));
+  std::fill(p, p + page, 'a');
+  for(size_t n = 1; n < 600; ++n) {
+    unsigned char* s = p + page - n;
+    ASSERT_EQ(nullptr, scan_memchr(s, 'c', n));
+    ASSERT_EQ(nullptr, scan_memrchr(s, 'c', n));
+    ASSERT_EQ(nullptr, scan_first_of(s, n, byte_set("cd")));
+    s[n - 1] = 'd';
+    ASSERT_EQ(s + n - 1, scan_first_of(s, n, byte_set("cd")));
+    s[n - 1] = '\0';
+    ASSERT_EQ(n - 1, scan_strlen(reinterpret_cast<const char*>(s)));
+    s[n - 1] = 'a';
+  }
+  munmap(m, 2 * page);
+}
+
+//Ranges starting after a page which may not be read, which the scans from the end read towards
+TEST(ByteScanTest, PageStart) {
+  size_t page = size_t(sysconf(_SC_PAGESIZE));
+  void* m = mmap(nullptr, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  ASSERT_NE(MAP_FAILED, m);
+  unsigned char* p = static_cast<unsigned char*>(m);
+  ASSERT_EQ(0, mprotect(p, page, PROT_NONE));
+  unsigned char* s = p + page;
+  std::fill(s, s + page, 'a');
+  for(size_t n = 1; n < 600; ++n) {
+    ASSERT_EQ(nullptr, scan_memrchr(s, 'c', n));
+    ASSERT_EQ(nullptr, scan_memchr(s, 'c', n));
+    ASSERT_EQ(nullptr, scan_first_of(s, n, byte_set("cd")));
+    s[0] = 'c';
+    ASSERT_EQ(s, scan_memrchr(s, 'c', n));
+    ASSERT_EQ(s, scan_first_of(s, n, byte_set("cd")));
+    s[0] = 'a';
+  }
+  munmap(m, 2 * page);
+}
+#endif
@@ -0,0 +1,152 @@
+#include <bitops.hh>
+#include "driver.hh"
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+template <typename T>
+class CountTest : public ::testing::Test {
+};
+TYPED_TEST_CASE_P(CountTest);
+
+//Bit by bit reference implementations
+template <typename T>
+int naive_cntt0(T x) {
+  int n = 0;
+  for(int i = 0; i < int(sizeof(T) * CHAR_BIT) && !testbit(x, i); ++i) ++n;
+  return n;
+}
+
+template <typename T>
+int naive_cntl0(T x) {
+  int n = 0;
+  for(int i = int(sizeof(T) * CHAR_BIT) - 1; i >= 0 && !testbit(x, i); --i) ++n;
+  return n;
+}
+
+template <typename T>
+int naive_popcount(T x) {
+  int n = 0;
+  for(int i = 0; i < int(sizeof(T) * CHAR_BIT); ++i) n += testbit(x, i);
+  return n;
+}
+
+//Values with every single bit, every run of low and high bits, and some noise
+template <typename T>
+std::vector<T> count_inputs() {
+  constexpr int nbits = int(sizeof(T) * CHAR_BIT);
+  std::vector<T> v = { T(0), T(~T(0)) };
+  for(int i = 0; i < nbits; ++i) {
+    v.push_back(T(shll(T(1), i)));
+    v.push_back(T(~shll(T(1), i)));
+    v.push_back(T(shll(T(~T(0)), i)));
+    v.push_back(T(shlr(T(~T(0)), i)));
+  }
+  xorshift64 rng;
+  for(int i = 0; i < 64; ++i) v.push_back(T(rng()));
+  return v;
+}
+
+TYPED_TEST_P(CountTest, Zero) {
+  typedef TypeParam T;
+  constexpr int nbits = int(sizeof(T) * CHAR_BIT);
+
+  ASSERT_EQ(nbits, cntt0(T(0)));
+  ASSERT_EQ(nbits, cntl0(T(0)));
+  ASSERT_EQ(nbits, cntt1(T(~T(0))));
+  ASSERT_EQ(nbits, cntl1(T(~T(0))));
+  ASSERT_EQ(0, popcount(T(0)));
+  ASSERT_EQ(0, parity(T(0)));
+  ASSERT_EQ(nbits, bitops_detail::cntt0_portable(T(0)));
+  ASSERT_EQ(nbits, bitops_detail::cntl0_portable(T(0)));
+}
+
+TYPED_TEST_P(CountTest, Reference) {
+  typedef TypeParam T;
+
+  for(T x : count_inputs<T>()) {
+    ASSERT_EQ(naive_cntt0(x), cntt0(x)) << +x;
+    ASSERT_EQ(naive_cntl0(x), cntl0(x)) << +x;
+    ASSERT_EQ(naive_cntt0(T(~x)), cntt1(x)) << +x;
+    ASSERT_EQ(naive_cntl0(T(~x)), cntl1(x)) << +x;
+    ASSERT_EQ(naive_popcount(x), popcount(x)) << +x;
+    ASSERT_EQ(naive_popcount(x) & 1, parity(x)) << +x;
+  }
+}
+
+TYPED_TEST_P(CountTest, Portable) {
+  typedef TypeParam T;
+
+  for(T x : count_inputs<T>()) {
+    ASSERT_EQ(cntt0(x), bitops_detail::cntt0_portable(x)) << +x;
+    ASSERT_EQ(cntl0(x), bitops_detail::cntl0_portable(x)) << +x;
+    ASSERT_EQ(popcount(x), bitops_detail::popcount_portable(x)) << +x;
+    ASSERT_EQ(parity(x), bitops_detail::parity_portable(x)) << +x;
+  }
+}
+
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201304
+TYPED_TEST_P(CountTest, Constexpr) {
+  typedef TypeParam T;
+  constexpr int nbits = int(sizeof(T) * CHAR_BIT);
+
+  static_assert(cntt0(T(0)) == nbits, "cntt0");
+  static_assert(cntt0(T(8)) == 3, "cntt0");
+  static_assert(cntl0(T(0)) == nbits, "cntl0");
+  static_assert(cntl0(T(1)) == nbits - 1, "cntl0");
+  static_assert(cntl1(T(~T(1))) == nbits - 1, "cntl1");
+  static_assert(cntt1(T(7)) == 3, "cntt1");
+  static_assert(popcount(T(0x77)) == 6, "popcount");
+  static_assert(parity(T(7)) == 1, "parity");
+}
+#else
+TYPED_TEST_P(CountTest, Constexpr) {
+}
+#endif
+
+TYPED_TEST_P(CountTest, Span) {
+  typedef TypeParam T;
+
+  //Long enough for several unrolled iterations of the vector kernels
+  typedef typename make_unsigned<T>::type U;
+  std::vector<T> v = count_inputs<T>();
+  while(v.size() * sizeof(T) < 8192) {
+    v.push_back(T(U(U(v[v.size() - 1]) * U(37) + U(v[v.size() / 2]))));
+  }
+  const size_t lens[] = { 0, 1, 3, 17, 64, 65, 300, 1029 };
+  for(size_t off = 0; off < 9; ++off) {
+    for(size_t len : lens) {
+      len = std::min(len, v.size() - off);
+      size_t expected = 0;
+      for(size_t i = 0; i < len; ++i) expected += popcount(v[off + i]);
+      ASSERT_EQ(expected, popcount(v.data() + off, len)) << off << " " << len;
+    }
+    size_t expected = 0;
+    for(size_t i = off; i < v.size(); ++i) expected += popcount(v[i]);
+    ASSERT_EQ(expected, popcount(v.data() + off, v.size() - off)) << off;
+  }
+}
+
+#if defined(BITOPS_RUNTIME_DISPATCH)
+TEST(CountSpanTest, Kernels) {
+  alignas(64) uint64_t buf[16 * 8 + 24];
+  xorshift64 rng;
+  size_t expected = 0;
+  for(auto& w : buf) {
+    w = rng();
+    expected += popcount(w);
+  }
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(buf);
+  if(bitops_detail::cpu().avx2) {
+    ASSERT_EQ(expected, bitops_detail::popcount_avx2(p, sizeof(buf) / 32));
+  }
+  if(bitops_detail::cpu().avx512vpopcntdq) {
+    ASSERT_EQ(expected, bitops_detail::popcount_avx512(p, sizeof(buf) / 64));
+  }
+}
+#endif
+
+REGISTER_TYPED_TEST_CASE_P(CountTest, Zero, Reference, Portable, Constexpr, Span);
+INSTANTIATE_TYPED_TEST_CASE_P(Ints, CountTest, IntTypes);
@@ -0,0 +1,125 @@
+#include <decimal.hh>
+#include "driver.hh"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+template <typename T>
+class DecimalTest : public ::testing::Test {
+};
+TYPED_TEST_CASE_P(DecimalTest);
+
+//Division loop reference
+template <typename U>
+static int ref_ilog10(U u) {
+  int n = -1;
+  for(; u != 0; u = U(u / 10)) {
+    ++n;
+  }
+  return n;
+}
+
+template <typename T>
+static std::string ref_decimal(T x) {
+  typedef typename bitops_detail::make_unsigned<T>::type U;
+  U u = x < 0 ? U(U(0) - U(x)) : U(x);
+  std::string s;
+  do {
+    s.insert(s.begin(), char('0' + int(u % 10)));
+    u = U(u / 10);
+  } while(u != 0);
+  return x < 0 ? "-" + s : s;
+}
+
+//Every power of 10 and 2 and their neighbours, random values with every number of significant bits,
+//and the limits
+template <typename T>
+static std::vector<T> decimal_values() {
+  typedef typename bitops_detail::make_unsigned<T>::type U;
+  constexpr int nbits = int(sizeof(T) * CHAR_BIT);
+  std::vector<T> v;
+  for(U p = 1; p != 0 && U(p * 10u) / 10u == p; p = U(p * 10u)) {
+    v.push_back(T(p));
+    v.push_back(T(U(p * 10u) - 1u));
+    v.push_back(T(U(p * 10u)));
+  }
+  for(int b = 0; b < nbits; ++b) {
+    v.push_back(T(shll(U(1), b)));
+    v.push_back(T(shll(U(1), b) - 1u));
+  }
+  xorshift64 rng;
+  for(int i = 0; i < 2000; ++i) {
+    uint64_t r = rng();
+    U u = U(r);
+    for(size_t k = 8; k < sizeof(U); k += 8) {
+      r = rng();
+      u = U(shll(u, 64) | r);
+    }
+    v.push_back(T(shlr(u, int(r % nbits))));
+  }
+  //The limits of signed and unsigned types
+  v.push_back(T(~U(0)));
+  v.push_back(T(shlr(U(~U(0)), 1)));
+  v.push_back(T(shll(U(1), nbits - 1)));
+  v.push_back(T(0));
+  return v;
+}
+
+template <typename T>
+static void check_decimal(const std::vector<T>& values) {
+  typedef typename bitops_detail::make_unsigned<T>::type U;
+  for(T x : values) {
+    if(x >= 0) {
+      ASSERT_EQ(ref_ilog10(U(x)), ilog10(x)) << ref_decimal(x);
+    }
+    std::string ref = ref_decimal(x);
+    ASSERT_EQ(ref.size(), decimal_size(x)) << ref;
+    ASSERT_LE(ref.size(), decimal_max_size<T>());
+    //Nothing is written past the end
+    char buf[64];
+    std::memset(buf, '#', sizeof(buf));
+    ASSERT_EQ(ref.size(), to_decimal(x, buf + 1));
+    ASSERT_EQ(ref, std::string(buf + 1, ref.size()));
+    ASSERT_EQ('#', buf[0]);
+    ASSERT_EQ('#', buf[ref.size() + 1]);
+  }
+}
+
+TYPED_TEST_P(DecimalTest, Digits) {
+  typedef TypeParam T;
+
+  ASSERT_EQ(-1, ilog10(T(0)));
+  ASSERT_EQ(0, ilog10(T(9)));
+  ASSERT_EQ(1, ilog10(T(10)));
+  ASSERT_EQ(1u, decimal_size(T(0)));
+  //Exact, the longest of the limits
+  ASSERT_EQ(std::max(decimal_size(numeric_limits<T>::min()), decimal_size(numeric_limits<T>::max())), decimal_max_size<T>());
+  check_decimal(decimal_values<T>());
+}
+
+REGISTER_TYPED_TEST_CASE_P(DecimalTest, Digits);
+INSTANTIATE_TYPED_TEST_CASE_P(Ints, DecimalTest, IntTypes);
+
+#if defined(__SIZEOF_INT128__)
+TEST(DecimalTest, Int128) {
+  ASSERT_EQ(38, ilog10(~(unsigned __int128)0));
+  ASSERT_EQ(39u, decimal_max_size<unsigned __int128>());
+  ASSERT_EQ(40u, decimal_max_size<__int128>());
+  ASSERT_EQ(39u, decimal_size(~(unsigned __int128)0));
+  ASSERT_EQ(40u, decimal_size((__int128)((unsigned __int128)1 << 127)));
+  check_decimal(decimal_values<unsigned __int128>());
+  check_decimal(decimal_values<__int128>());
+}
+#endif
+
+TEST(DecimalTest, Constexpr) {
+#if __cplusplus >= 201402L
+  static_assert(ilog10(uint64_t(999)) == 2, "");
+  static_assert(decimal_size(int32_t(-1000)) == 5, "");
+#endif
+  static_assert(decimal_max_size<int8_t>() == 4, "");
+  static_assert(decimal_max_size<int64_t>() == 20, "");
+  static_assert(decimal_max_size<uint64_t>() == 20, "");
+}
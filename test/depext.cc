@@ -0,0 +1,97 @@
+#include <bitops.hh>
+#include "driver.hh"
+
+#include <vector>
+
+using namespace std;
+
+template <typename T>
+class DepExtTest : public ::testing::Test {
+};
+TYPED_TEST_CASE_P(DepExtTest);
+
+//One bit at a time reference implementations
+template <typename T>
+T naive_deposit(T x, T mask) {
+  T res = 0;
+  for(int i = 0, j = 0; i < int(sizeof(T) * CHAR_BIT); ++i) {
+    if(testbit(mask, i)) {
+      if(testbit(x, j)) res = setbit(res, i);
+      ++j;
+    }
+  }
+  return res;
+}
+
+template <typename T>
+T naive_extract(T x, T mask) {
+  T res = 0;
+  for(int i = 0, j = 0; i < int(sizeof(T) * CHAR_BIT); ++i) {
+    if(testbit(mask, i)) {
+      if(testbit(x, i)) res = setbit(res, j);
+      ++j;
+    }
+  }
+  return res;
+}
+
+//Empty, full, dense, sparse and random masks
+template <typename T>
+std::vector<T> masks() {
+  std::vector<T> v = { T(0), T(~T(0)), T(0x5555555555555555ULL), T(0xF0F0F0F0F0F0F0F0ULL),
+    T(0x8000000000000001ULL), T(shll(T(1), sizeof(T) * CHAR_BIT - 1)), T(0x0FFFFFFFFFFFFFF0ULL) };
+  xorshift64 rng(0x2545F4914F6CDD1DULL);
+  for(int i = 0; i < 32; ++i) {
+    const uint64_t r = rng();
+    v.push_back(T(r));
+    v.push_back(T(r & (r >> 11) & (r >> 23)));
+  }
+  return v;
+}
+
+TYPED_TEST_P(DepExtTest, Example) {
+  typedef TypeParam T;
+
+  ASSERT_EQ(T(0x64), deposit_bits(T(0x0F), T(0x64)));
+  ASSERT_EQ(T(0x44), deposit_bits(T(0x05), T(0x64)));
+  ASSERT_EQ(T(0x07), extract_bits(T(0xFF), T(0x64)));
+  ASSERT_EQ(T(0x05), extract_bits(T(0x44), T(0x64)));
+}
+
+TYPED_TEST_P(DepExtTest, Reference) {
+  typedef TypeParam T;
+
+  for(T m : masks<T>()) {
+    bits_mask<T> bm(m);
+    ASSERT_EQ(m, bm.mask());
+    for(T x : masks<T>()) {
+      T d = naive_deposit(x, m);
+      T e = naive_extract(x, m);
+      ASSERT_EQ(d, deposit_bits(x, m)) << +x << " " << +m;
+      ASSERT_EQ(e, extract_bits(x, m)) << +x << " " << +m;
+      ASSERT_EQ(d, bitops_detail::deposit_bits_portable(x, m)) << +x << " " << +m;
+      ASSERT_EQ(e, bitops_detail::extract_bits_portable(x, m)) << +x << " " << +m;
+      ASSERT_EQ(d, deposit_bits(x, bm)) << +x << " " << +m;
+      ASSERT_EQ(e, extract_bits(x, bm)) << +x << " " << +m;
+      ASSERT_EQ(d, deposit_bits_runtime(x, m)) << +x << " " << +m;
+      ASSERT_EQ(e, extract_bits_runtime(x, m)) << +x << " " << +m;
+    }
+  }
+}
+
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201304
+TYPED_TEST_P(DepExtTest, Constexpr) {
+  typedef TypeParam T;
+
+  static_assert(deposit_bits(T(0x0F), T(0x64)) == T(0x64), "deposit_bits");
+  static_assert(extract_bits(T(0x44), T(0x64)) == T(0x05), "extract_bits");
+  static_assert(bits_mask<T>(T(0x64)).deposit(T(0x05)) == T(0x44), "bits_mask");
+  static_assert(bits_mask<T>(T(0x64)).extract(T(0xFF)) == T(0x07), "bits_mask");
+}
+#else
+TYPED_TEST_P(DepExtTest, Constexpr) {
+}
+#endif
+
+REGISTER_TYPED_TEST_CASE_P(DepExtTest, Example, Reference, Constexpr);
+INSTANTIATE_TYPED_TEST_CASE_P(Ints, DepExtTest, IntTypes);
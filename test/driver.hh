@@ -2,7 +2,10 @@
 #define DRIVER_HH
 #include "gtest/gtest.h"
 
+#include <cstdint>
+
 typedef ::testing::Types<int8_t, uint8_t, int16_t, uint16_t, int32_t, uint32_t, int64_t, uint64_t> IntTypes;
+typedef ::testing::Types<uint8_t, uint16_t, uint32_t, uint64_t> UIntTypes;
 typedef ::testing::Types<
   std::pair<int8_t, int8_t>,
   std::pair<int8_t, uint8_t>,
@@ -77,4 +80,17 @@ typedef ::testing::Types<
   std::pair<uint64_t, uint32_t>
   > IntPairTypes;
 
+//xorshift64, the same sequence of random words on every platform for a given nonzero seed
+class xorshift64 {
+  public:
+    explicit xorshift64(uint64_t seed = 0x9E3779B97F4A7C15ULL) : _s(seed) {}
+
+    uint64_t operator()() {
+      _s ^= _s << 13; _s ^= _s >> 7; _s ^= _s << 17;
+      return _s;
+    }
+  private:
+    uint64_t _s;
+};
+
 #endif
@@ -0,0 +1,89 @@
+#include <bitops.hh>
+#include "driver.hh"
+
+#include <vector>
+
+using namespace std;
+
+template <typename T>
+class EndianTest : public ::testing::Test {
+};
+TYPED_TEST_CASE_P(EndianTest);
+
+TYPED_TEST_P(EndianTest, LoadStore) {
+  typedef TypeParam T;
+  typedef typename make_unsigned<T>::type U;
+
+  unsigned char buf[sizeof(T) + 8];
+  for(size_t i = 0; i < sizeof(buf); ++i) {
+    buf[i] = (unsigned char)(0x11 * (i + 1));
+  }
+  //Every alignment
+  for(size_t off = 0; off < 8; ++off) {
+    U le = 0, be = 0;
+    for(size_t i = 0; i < sizeof(T); ++i) {
+      le |= U(U(buf[off + i]) << (8 * i));
+      be = U(U(be << 4) << 4) | U(buf[off + i]);
+    }
+    ASSERT_EQ(T(le), load_le<T>(buf + off)) << off;
+    ASSERT_EQ(T(be), load_be<T>(buf + off)) << off;
+
+    unsigned char out[sizeof(T) + 8] = {};
+    store_le(out + off, T(le));
+    ASSERT_EQ(0, memcmp(buf + off, out + off, sizeof(T))) << off;
+    store_be(out + off, T(be));
+    ASSERT_EQ(0, memcmp(buf + off, out + off, sizeof(T))) << off;
+    ASSERT_EQ(0, out[off + sizeof(T)]);
+  }
+}
+
+TYPED_TEST_P(EndianTest, Cursor) {
+  typedef TypeParam T;
+
+  std::vector<unsigned char> buf(3 * sizeof(T) + 1);
+  store_be(buf.data() + 1, std::numeric_limits<T>::min());
+  store_le(buf.data() + 1 + sizeof(T), std::numeric_limits<T>::max());
+  store_be(buf.data() + 1 + 2 * sizeof(T), T(0x5A));
+
+  byte_cursor c(buf.data(), buf.size());
+  ASSERT_EQ(buf.size(), c.remaining());
+  c.skip(1);
+  ASSERT_EQ(std::numeric_limits<T>::min(), c.peek_be<T>());
+  ASSERT_EQ(std::numeric_limits<T>::min(), c.read_be<T>());
+  ASSERT_EQ(std::numeric_limits<T>::max(), c.peek_le<T>());
+  ASSERT_EQ(std::numeric_limits<T>::max(), c.read_le<T>());
+  T x = 0;
+  ASSERT_TRUE(c.try_read_be(x));
+  ASSERT_EQ(T(0x5A), x);
+  ASSERT_EQ(buf.data() + buf.size(), c.data());
+  ASSERT_FALSE(c.has(1));
+  ASSERT_FALSE(c.try_read_le(x));
+  ASSERT_EQ(T(0x5A), x);
+}
+
+REGISTER_TYPED_TEST_CASE_P(EndianTest, LoadStore, Cursor);
+INSTANTIATE_TYPED_TEST_CASE_P(Ints, EndianTest, IntTypes);
+
+TEST(EndianTest, Packet) {
+  //IPv4 header of a UDP packet followed by a truncated UDP header
+  const unsigned char pkt[] = {
+    0x45, 0x00, 0x00, 0x3C, 0x1C, 0x46, 0x40, 0x00, 0x40, 0x11, 0xB1, 0xE6,
+    0xC0, 0xA8, 0x00, 0x68, 0xC0, 0xA8, 0x00, 0x01, 0x30, 0x39, 0x00,
+  };
+  byte_cursor c(pkt, sizeof(pkt));
+  uint8_t ver_ihl = c.read_be<uint8_t>();
+  ASSERT_EQ(4, ver_ihl >> 4);
+  ASSERT_EQ(5, ver_ihl & 0xF);
+  c.skip(1);
+  ASSERT_EQ(60, c.read_be<uint16_t>());
+  ASSERT_EQ(0x1C46, c.read_be<uint16_t>());
+  c.skip(4);
+  ASSERT_EQ(0xB1E6, c.read_be<uint16_t>());
+  ASSERT_EQ(0xC0A80068UL, c.read_be<uint32_t>());
+  ASSERT_EQ(0xC0A80001UL, c.read_be<uint32_t>());
+  uint16_t port = 0;
+  ASSERT_TRUE(c.try_read_be(port));
+  ASSERT_EQ(12345, port);
+  ASSERT_FALSE(c.try_read_be(port));
+  ASSERT_EQ(1u, c.remaining());
+}
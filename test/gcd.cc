@@ -0,0 +1,201 @@
+#include <bitops.hh>
+#include "driver.hh"
+
+#include <vector>
+
+using namespace std;
+
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201304
+static_assert(gcd(12, 18) == 6, "");
+static_assert(gcd(-12, 18) == 6, "");
+static_assert(gcd(0u, 7u) == 7u, "");
+static_assert(lcm(4, 6) == 12, "");
+static_assert(lcm(0, 6) == 0, "");
+static_assert(isqrt(99u) == 9u, "");
+static_assert(isqrt(100u) == 10u, "");
+static_assert(isqrt(~uint64_t(0)) == 0xFFFFFFFFu, "");
+#endif
+
+template <typename T>
+class GcdTest : public ::testing::Test {
+};
+TYPED_TEST_CASE_P(GcdTest);
+
+template <typename T>
+class BatchTest : public ::testing::Test {
+};
+TYPED_TEST_CASE_P(BatchTest);
+
+template <typename U>
+static U ref_gcd(U a, U b) {
+  while(b != 0) {
+    U t = U(a % b);
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+template <typename T>
+static std::vector<T> gcd_inputs(size_t n, uint64_t seed) {
+  std::vector<T> v(n);
+  xorshift64 rng(seed);
+  for(auto& x : v) {
+    const uint64_t r = rng();
+    //Shared factors of 2 and small values are common
+    x = T(shll(r >> (r % 61), int(r >> 58) % 8));
+  }
+  return v;
+}
+
+TYPED_TEST_P(GcdTest, GcdLcm) {
+  typedef TypeParam T;
+  typedef typename make_unsigned<T>::type U;
+  const bool is_signed = T(-1) < T(0);
+
+  ASSERT_EQ(T(0), gcd(T(0), T(0)));
+  ASSERT_EQ(T(0), lcm(T(0), T(0)));
+  for(int a = 0; a < 100; ++a) {
+    for(int b = 0; b < 100; ++b) {
+      ASSERT_EQ(T(ref_gcd(a, b)), gcd(T(a), T(b))) << a << " " << b;
+      const int m = a == 0 || b == 0 ? 0 : a / ref_gcd(a, b) * b;
+      if(m <= int(numeric_limits<T>::max())) {
+        ASSERT_EQ(T(m), lcm(T(a), T(b))) << a << " " << b;
+      }
+      if(is_signed) {
+        ASSERT_EQ(T(ref_gcd(a, b)), gcd(T(-a), T(b)));
+        ASSERT_EQ(T(ref_gcd(a, b)), gcd(T(a), T(-b)));
+        ASSERT_EQ(T(ref_gcd(a, b)), gcd(T(-a), T(-b)));
+      }
+    }
+  }
+
+  std::vector<T> a = gcd_inputs<T>(2000, 0x9E3779B97F4A7C15ULL);
+  std::vector<T> b = gcd_inputs<T>(2000, 0x2545F4914F6CDD1DULL);
+  for(size_t i = 0; i < a.size(); ++i) {
+    if(a[i] == numeric_limits<T>::min() || b[i] == numeric_limits<T>::min()) {
+      continue;
+    }
+    U ua = U(a[i] < 0 ? -a[i] : a[i]);
+    U ub = U(b[i] < 0 ? -b[i] : b[i]);
+    U g = ref_gcd(ua, ub);
+    ASSERT_EQ(T(g), gcd(a[i], b[i])) << +a[i] << " " << +b[i];
+    if(ua != 0 && ub != 0 && ua / g <= U(numeric_limits<T>::max()) / ub) {
+      ASSERT_EQ(T(ua / g * ub), lcm(a[i], b[i]));
+    }
+  }
+
+  //Powers of 2 and the largest values
+  const T max = numeric_limits<T>::max();
+  for(int i = 0; i < int(sizeof(T) * CHAR_BIT) - 1; ++i) {
+    for(int j = 0; j < int(sizeof(T) * CHAR_BIT) - 1; ++j) {
+      ASSERT_EQ(shll(T(1), std::min(i, j)), gcd(shll(T(1), i), shll(T(1), j)));
+    }
+    ASSERT_EQ(T(1), gcd(max, shll(T(1), i)));
+  }
+  ASSERT_EQ(max, gcd(max, max));
+  ASSERT_EQ(T(max), gcd(T(0), max));
+  ASSERT_EQ(T(max), gcd(max, T(0)));
+  ASSERT_EQ(T(1), gcd(max, T(max - 1)));
+}
+
+TYPED_TEST_P(GcdTest, Isqrt) {
+  typedef TypeParam T;
+  typedef typename make_unsigned<T>::type U;
+  for(int x = 0; x < 128; ++x) {
+    int r = 0;
+    while((r + 1) * (r + 1) <= x) ++r;
+    ASSERT_EQ(T(r), isqrt(T(x))) << x;
+  }
+  //Every square and its neighbours
+  const U max = U(numeric_limits<T>::max());
+  const U root = bitops_detail::isqrt_newton(max);
+  for(U k = 1; k <= root; k = U(k + 1 + k / 64)) {
+    const U s = U(k * k);
+    ASSERT_EQ(T(k), isqrt(T(s))) << +k;
+    ASSERT_EQ(T(k - 1), isqrt(T(s - 1))) << +k;
+    if(s < max) {
+      ASSERT_EQ(T(k), isqrt(T(s + 1))) << +k;
+    }
+  }
+  ASSERT_EQ(T(root), isqrt(T(max)));
+  ASSERT_EQ(T(root), isqrt(T(root * root)));
+  ASSERT_LE(root * root, max);
+  ASSERT_GT(U(root + 1), max / U(root + 1));
+
+  xorshift64 rng;
+  for(int k = 0; k < 10000; ++k) {
+    const uint64_t r = rng();
+    const U x = U(U(r >> (r % 61)) & max);
+    const U s = U(isqrt(T(x)));
+    ASSERT_EQ(bitops_detail::isqrt_newton(x), s) << +x;
+    ASSERT_LE(s, x / (s == 0 ? 1 : s));
+    ASSERT_GT(U(s + 1), x / U(s + 1));
+  }
+}
+
+TYPED_TEST_P(BatchTest, Batch) {
+  typedef TypeParam T;
+  for(size_t n : {0, 1, 3, 7, 8, 9, 31, 1000}) {
+    std::vector<T> a = gcd_inputs<T>(n, 0x9E3779B97F4A7C15ULL + n);
+    std::vector<T> b = gcd_inputs<T>(n, 0x2545F4914F6CDD1DULL + n);
+    //Zeros and equal pairs
+    for(size_t i = 0; i < n; i += 5) {
+      (i % 3 == 0 ? a : i % 3 == 1 ? b : a)[i] = i % 3 == 2 ? b[i] : T(0);
+    }
+    std::vector<T> out(n + 1);
+    gcd(a.data(), b.data(), out.data(), n);
+    for(size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(gcd(a[i], b[i]), out[i]) << i << " " << +a[i] << " " << +b[i];
+    }
+    ASSERT_EQ(T(0), out.back());
+
+    std::vector<T> m(n);
+    for(size_t i = 0; i < n; ++i) {
+      a[i] = T(shlr(a[i], int(sizeof(T) * CHAR_BIT / 2)));
+      b[i] = T(shlr(b[i], int(sizeof(T) * CHAR_BIT / 2)));
+      m[i] = lcm(a[i], b[i]);
+    }
+    lcm(a.data(), b.data(), out.data(), n);
+    ASSERT_TRUE(std::equal(m.begin(), m.end(), out.begin()));
+    //In place
+    lcm(a.data(), b.data(), a.data(), n);
+    ASSERT_TRUE(std::equal(m.begin(), m.end(), a.begin()));
+
+    isqrt(b.data(), out.data(), n);
+    for(size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(isqrt(b[i]), out[i]);
+    }
+  }
+
+  //Every lane of the batch kernels against the largest values
+  std::vector<T> x(64, numeric_limits<T>::max());
+  std::vector<T> out(x.size());
+  for(size_t i = 0; i < x.size(); ++i) {
+    x[i] = T(x[i] - T(i));
+  }
+  isqrt(x.data(), out.data(), x.size());
+  for(size_t i = 0; i < x.size(); ++i) {
+    ASSERT_EQ(isqrt(x[i]), out[i]);
+  }
+  gcd(x.data(), x.data() + 1, out.data(), x.size() - 1);
+  for(size_t i = 0; i + 1 < x.size(); ++i) {
+    ASSERT_EQ(T(1), out[i]);
+  }
+}
+
+#if defined(__SIZEOF_INT128__)
+TEST(GcdTest, Int128) {
+  const unsigned __int128 p = (unsigned __int128)0xFFFFFFFFFFFFFFC5ULL * 0xFFFFFFFFFFFFFFC5ULL;
+  ASSERT_TRUE(0xFFFFFFFFFFFFFFC5ULL == isqrt(p));
+  ASSERT_TRUE(0xFFFFFFFFFFFFFFC4ULL == isqrt(p - 1));
+  ASSERT_TRUE(0xFFFFFFFFFFFFFFC5ULL == gcd(p, (unsigned __int128)0xFFFFFFFFFFFFFFC5ULL * 6));
+  ASSERT_TRUE(p * 6 == lcm(p, (unsigned __int128)6));
+  ASSERT_TRUE(3 == gcd((__int128)-9, (__int128)12));
+}
+#endif
+
+REGISTER_TYPED_TEST_CASE_P(GcdTest, GcdLcm, Isqrt);
+INSTANTIATE_TYPED_TEST_CASE_P(Ints, GcdTest, IntTypes);
+REGISTER_TYPED_TEST_CASE_P(BatchTest, Batch);
+INSTANTIATE_TYPED_TEST_CASE_P(UInts, BatchTest, UIntTypes);
@@ -0,0 +1,103 @@
+#include <bitops.hh>
+#include "driver.hh"
+
+#include <vector>
+
+using namespace std;
+
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201304
+static_assert(morton2(uint32_t(0xFFFF), uint32_t(0)) == 0x55555555, "");
+static_assert(morton2_y(morton2(uint16_t(0x12), uint16_t(0x34))) == 0x34, "");
+static_assert(morton3(uint64_t(1), uint64_t(2), uint64_t(4)) == 0x1 + 0x10 + 0x100, "");
+static_assert(morton3_z(morton3(uint32_t(5), uint32_t(6), uint32_t(0x3FF))) == 0x3FF, "");
+#endif
+
+template <typename T>
+class MortonTest : public ::testing::Test {
+};
+TYPED_TEST_CASE_P(MortonTest);
+
+template <typename T>
+std::vector<T> morton_inputs(size_t n, uint64_t seed) {
+  std::vector<T> v(n);
+  xorshift64 rng(0x9E3779B97F4A7C15ULL ^ seed);
+  for(auto& x : v) x = T(rng());
+  return v;
+}
+
+TYPED_TEST_P(MortonTest, Morton2) {
+  typedef TypeParam T;
+  constexpr int nbits = int(sizeof(T) * CHAR_BIT);
+  const T even = T(0x5555555555555555ULL);
+  const T odd = T(0xAAAAAAAAAAAAAAAAULL);
+
+  ASSERT_EQ(T(0), morton2(T(0), T(0)));
+  ASSERT_EQ(even, morton2(T(~T(0)), T(0)));
+  ASSERT_EQ(odd, morton2(T(0), T(~T(0))));
+  ASSERT_EQ(T(3), morton2(T(1), T(1)));
+
+  std::vector<T> xs = morton_inputs<T>(200, 1);
+  std::vector<T> ys = morton_inputs<T>(200, 2);
+  for(size_t i = 0; i < xs.size(); ++i) {
+    T x = xs[i], y = ys[i];
+    T m = morton2(x, y);
+    ASSERT_EQ(T(deposit_bits(x, even) | deposit_bits(y, odd)), m);
+    ASSERT_EQ(rstbitsge(x, nbits / 2), morton2_x(m));
+    ASSERT_EQ(rstbitsge(y, nbits / 2), morton2_y(m));
+  }
+}
+
+TYPED_TEST_P(MortonTest, Morton3) {
+  typedef TypeParam T;
+  constexpr int nbits = int(sizeof(T) * CHAR_BIT);
+  constexpr int cbits = nbits / 3;
+  T mask = 0;
+  for(int i = 0; i < cbits; ++i) mask = setbit(mask, 3 * i);
+
+  ASSERT_EQ(T(0), morton3(T(0), T(0), T(0)));
+  ASSERT_EQ(mask, morton3(T(~T(0)), T(0), T(0)));
+  ASSERT_EQ(T(mask << 1), morton3(T(0), T(~T(0)), T(0)));
+  ASSERT_EQ(T(mask << 2), morton3(T(0), T(0), T(~T(0))));
+  ASSERT_EQ(T(7), morton3(T(1), T(1), T(1)));
+
+  std::vector<T> xs = morton_inputs<T>(200, 1);
+  std::vector<T> ys = morton_inputs<T>(200, 2);
+  std::vector<T> zs = morton_inputs<T>(200, 3);
+  for(size_t i = 0; i < xs.size(); ++i) {
+    T x = xs[i], y = ys[i], z = zs[i];
+    T m = morton3(x, y, z);
+    ASSERT_EQ(T(deposit_bits(x, mask) | deposit_bits(y, T(mask << 1)) | deposit_bits(z, T(mask << 2))), m);
+    ASSERT_EQ(rstbitsge(x, cbits), morton3_x(m));
+    ASSERT_EQ(rstbitsge(y, cbits), morton3_y(m));
+    ASSERT_EQ(rstbitsge(z, cbits), morton3_z(m));
+  }
+  //Bits past the last full coordinate are ignored
+  ASSERT_EQ(T(0), morton3_x(T(~mask)));
+}
+
+TYPED_TEST_P(MortonTest, Array) {
+  typedef TypeParam T;
+
+  //Odd lengths leave a tail for the scalar encoder
+  for(size_t n : {0, 1, 7, 33, 130}) {
+    std::vector<T> xs = morton_inputs<T>(n, 1);
+    std::vector<T> ys = morton_inputs<T>(n, 2);
+    std::vector<T> zs = morton_inputs<T>(n, 3);
+    std::vector<T> out(n + 1, T(0x5A));
+
+    morton2(xs.data(), ys.data(), out.data(), n);
+    for(size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(morton2(xs[i], ys[i]), out[i]);
+    }
+    ASSERT_EQ(T(0x5A), out[n]);
+
+    morton3(xs.data(), ys.data(), zs.data(), out.data(), n);
+    for(size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(morton3(xs[i], ys[i], zs[i]), out[i]);
+    }
+    ASSERT_EQ(T(0x5A), out[n]);
+  }
+}
+
+REGISTER_TYPED_TEST_CASE_P(MortonTest, Morton2, Morton3, Array);
+INSTANTIATE_TYPED_TEST_CASE_P(UInts, MortonTest, UIntTypes);
@@ -0,0 +1,99 @@
+#include <packed_array.hh>
+#include "driver.hh"
+
+#include <vector>
+
+using namespace std;
+
+template <typename T>
+class PackedTest : public ::testing::Test {
+};
+TYPED_TEST_CASE_P(PackedTest);
+
+template <typename T>
+static std::vector<T> random_values(size_t n, uint64_t seed) {
+  std::vector<T> v(n);
+  xorshift64 rng(seed);
+  for(auto& x : v) x = T(rng());
+  return v;
+}
+
+TYPED_TEST_P(PackedTest, PackUnpack) {
+  typedef TypeParam T;
+  constexpr int nbits = int(sizeof(T) * CHAR_BIT);
+
+  std::vector<T> src = random_values<T>(1003, 0x9E3779B97F4A7C15ULL);
+  for(int width = 1; width <= nbits; ++width) {
+    T mask = width == nbits ? T(~T(0)) : T(rstbitsge(~T(0), width));
+    for(size_t n : {0, 1, 63, 64, 65, 200, 1003}) {
+      //A guard word after the packed words must be left alone
+      std::vector<uint64_t> words(packed_words(n, width) + 1, 0x0123456789ABCDEFULL);
+      pack_bits(src.data(), n, width, words.data());
+      ASSERT_EQ(0x0123456789ABCDEFULL, words.back());
+      for(size_t i = 0; i < n; ++i) {
+        for(int b = 0; b < width; ++b) {
+          size_t bit = i * size_t(width) + size_t(b);
+          ASSERT_EQ(testbit(src[i], b), testbit(words[bit / 64], int(bit % 64))) << width << " " << n << " " << i;
+        }
+      }
+      std::vector<T> dst(n + 1, T(0x5A));
+      unpack_bits(words.data(), n, width, dst.data());
+      for(size_t i = 0; i < n; ++i) {
+        ASSERT_EQ(T(src[i] & mask), dst[i]) << width << " " << n << " " << i;
+      }
+      ASSERT_EQ(T(0x5A), dst[n]);
+    }
+  }
+}
+
+TYPED_TEST_P(PackedTest, Array) {
+  typedef TypeParam T;
+  constexpr int nbits = int(sizeof(T) * CHAR_BIT);
+
+  std::vector<T> src = random_values<T>(500, 0x9E3779B97F4A7C15ULL);
+  for(int width = 1; width <= nbits; ++width) {
+    T mask = width == nbits ? T(~T(0)) : T(rstbitsge(~T(0), width));
+    packed_array<T> a(src.data(), src.size(), width);
+    ASSERT_EQ(src.size(), a.size());
+    ASSERT_EQ(width, a.width());
+    for(size_t i = 0; i < src.size(); ++i) {
+      ASSERT_EQ(T(src[i] & mask), a[i]) << width << " " << i;
+    }
+    //Overwrite every third value and check that the neighbours are kept
+    std::vector<T> ref(src.size());
+    for(size_t i = 0; i < src.size(); ++i) {
+      ref[i] = T((i % 3 == 0 ? T(~src[i]) : src[i]) & mask);
+      if(i % 3 == 0) {
+        a.set(i, T(~src[i]));
+      }
+    }
+    for(size_t first : {0, 1, 63, 64, 100}) {
+      std::vector<T> out(src.size() - first);
+      a.unpack(first, out.size(), out.data());
+      for(size_t i = 0; i < out.size(); ++i) {
+        ASSERT_EQ(ref[first + i], out[i]) << width << " " << first << " " << i;
+      }
+    }
+  }
+}
+
+REGISTER_TYPED_TEST_CASE_P(PackedTest, PackUnpack, Array);
+INSTANTIATE_TYPED_TEST_CASE_P(UInts, PackedTest, UIntTypes);
+
+TEST(PackedTest, Fixed) {
+  std::vector<uint32_t> src = random_values<uint32_t>(1000, 0x9E3779B97F4A7C15ULL);
+  std::vector<uint64_t> words(packed_words(src.size(), 13));
+  pack_bits(src.data(), src.size(), 13, words.data());
+  std::vector<uint32_t> dst(src.size());
+  unpack_bits<13>(words.data(), dst.size(), dst.data());
+  for(size_t i = 0; i < src.size(); ++i) {
+    ASSERT_EQ(src[i] & 0x1FFF, dst[i]) << i;
+  }
+
+  std::vector<uint64_t> src64 = random_values<uint64_t>(100, 1);
+  std::vector<uint64_t> dst64(src64.size());
+  words.resize(packed_words(src64.size(), 64));
+  pack_bits(src64.data(), src64.size(), 64, words.data());
+  unpack_bits<64>(words.data(), dst64.size(), dst64.data());
+  ASSERT_EQ(src64, dst64);
+}
@@ -0,0 +1,236 @@
+#include <pool_allocator.hh>
+#include "driver.hh"
+
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201304
+static_assert(size_class_pool::size_class(1) == 0, "");
+static_assert(size_class_pool::size_class(16) == 0, "");
+static_assert(size_class_pool::size_class(17) == 1, "");
+static_assert(size_class_pool::size_class(65536) == size_class_pool::num_classes - 1, "");
+#endif
+
+TEST(PoolTest, SizeClass) {
+  for(size_t n = 1; n <= size_class_pool::max_size; ++n) {
+    int c = size_class_pool::size_class(n);
+    ASSERT_EQ(n <= 16 ? size_t(16) : ceilp2(n), size_class_pool::class_size(c)) << n;
+  }
+}
+
+TEST(PoolTest, AllocateFree) {
+  std::vector<std::pair<void*, size_t>> blocks;
+  for(size_t n = 1; n <= 2 * size_class_pool::max_size; n = n * 3 / 2 + 1) {
+    void* p = size_class_pool::allocate(n);
+    ASSERT_NE(nullptr, p);
+    if(n <= size_class_pool::max_size) {
+      size_t size = size_class_pool::class_size(size_class_pool::size_class(n));
+      ASSERT_TRUE(is_aligned(p, size < 4096 ? size : 4096)) << n;
+    }
+    memset(p, 0xA5, n);
+    blocks.push_back(std::make_pair(p, n));
+  }
+  for(auto& b : blocks) {
+    size_class_pool::deallocate(b.first, b.second);
+    //The block just freed is reused first
+    if(b.second <= size_class_pool::max_size) {
+      void* p = size_class_pool::allocate(b.second);
+      ASSERT_EQ(b.first, p) << b.second;
+      size_class_pool::deallocate(p, b.second);
+    }
+  }
+}
+
+TEST(PoolTest, Containers) {
+  std::vector<int, pool_allocator<int>> v;
+  for(int i = 0; i < 100000; ++i) {
+    v.push_back(i);
+  }
+  for(int i = 0; i < 100000; ++i) {
+    ASSERT_EQ(i, v[i]);
+  }
+
+  std::map<int, int, std::less<int>, pool_allocator<std::pair<const int, int>>> m;
+  for(int i = 0; i < 1000; ++i) {
+    m[i * 7 % 1000] = i;
+  }
+  ASSERT_EQ(1000u, m.size());
+  for(int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(i, m[i * 7 % 1000]);
+  }
+  ASSERT_TRUE(pool_allocator<int>() == pool_allocator<double>());
+}
+
+TEST(PoolTest, Threads) {
+  //Blocks allocated by one thread and freed by another, with threads exiting in between
+  const int nthreads = 4;
+  const size_t n = 10000;
+  std::vector<std::vector<char*>> blocks(nthreads);
+  std::vector<std::thread> threads;
+  for(int t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&blocks, t]() {
+      for(size_t i = 0; i < n; ++i) {
+        size_t size = 16 + i % 1000;
+        char* p = static_cast<char*>(size_class_pool::allocate(size));
+        memset(p, t, size);
+        blocks[t].push_back(p);
+      }
+    });
+  }
+  for(auto& th : threads) {
+    th.join();
+  }
+  threads.clear();
+  for(int t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&blocks, t]() {
+      const std::vector<char*>& mine = blocks[(t + 1) % nthreads];
+      for(size_t i = 0; i < n; ++i) {
+        size_t size = 16 + i % 1000;
+        for(size_t j = 0; j < size; ++j) {
+          if(mine[i][j] != char((t + 1) % nthreads)) {
+            ADD_FAILURE() << "block " << i << " of thread " << (t + 1) % nthreads << " was reused";
+            return;
+          }
+        }
+        size_class_pool::deallocate(mine[i], size);
+      }
+    });
+  }
+  for(auto& th : threads) {
+    th.join();
+  }
+}
+
+TEST(PoolTest, ProducerConsumer) {
+  //One thread allocates and another frees with a constant live set, the freed blocks have to
+  //find their way back to the allocating thread instead of it taking a new slab every round
+  const size_t size = 64;
+  const size_t n = 10000;
+  const int rounds = 100;
+  std::mutex m;
+  std::condition_variable cv;
+  std::vector<void*> handoff;
+  bool full = false;
+  size_t slabs = size_class_pool::slabs();
+  std::thread consumer([&]() {
+    for(int r = 0; r < rounds; ++r) {
+      std::vector<void*> blocks;
+      {
+        std::unique_lock<std::mutex> lock(m);
+        cv.wait(lock, [&]() { return full; });
+        blocks.swap(handoff);
+        full = false;
+      }
+      cv.notify_one();
+      for(void* p : blocks) {
+        size_class_pool::deallocate(p, size);
+      }
+    }
+  });
+  for(int r = 0; r < rounds; ++r) {
+    std::vector<void*> blocks;
+    for(size_t i = 0; i < n; ++i) {
+      blocks.push_back(size_class_pool::allocate(size));
+    }
+    std::unique_lock<std::mutex> lock(m);
+    cv.wait(lock, [&]() { return !full; });
+    handoff.swap(blocks);
+    full = true;
+    cv.notify_one();
+  }
+  consumer.join();
+  //At most 3 rounds are live, about 7.3 slabs, and the consumer keeps at most 2 slabs' worth
+  ASSERT_LT(size_class_pool::slabs() - slabs, 16u);
+}
+
+TEST(PoolTest, SharedRefill) {
+  //One thread frees 8 slabs' worth of blocks, then 2 threads allocate. The first one to miss takes
+  //one batch of the depot, so the other finds the rest there instead of taking new slabs.
+  const size_t size = 2048;
+  const size_t per_slab = size_class_pool::slab_size / size;
+  std::vector<void*> blocks;
+  for(size_t i = 0; i < 8 * per_slab; ++i) {
+    blocks.push_back(size_class_pool::allocate(size));
+  }
+  std::thread([&]() {
+    for(void* p : blocks) {
+      size_class_pool::deallocate(p, size);
+    }
+  }).join();
+  blocks.clear();
+  size_t slabs = size_class_pool::slabs();
+
+  std::mutex m;
+  std::condition_variable cv;
+  int step = 0;
+  std::thread first([&]() {
+    void* p = size_class_pool::allocate(size);
+    std::unique_lock<std::mutex> lock(m);
+    step = 1;
+    cv.notify_all();
+    cv.wait(lock, [&]() { return step == 2; });
+    size_class_pool::deallocate(p, size);
+  });
+  std::thread second([&]() {
+    {
+      std::unique_lock<std::mutex> lock(m);
+      cv.wait(lock, [&]() { return step == 1; });
+    }
+    for(size_t i = 0; i < 4 * per_slab; ++i) {
+      blocks.push_back(size_class_pool::allocate(size));
+    }
+    ASSERT_EQ(slabs, size_class_pool::slabs());
+    for(void* p : blocks) {
+      size_class_pool::deallocate(p, size);
+    }
+  });
+  second.join();
+  {
+    std::lock_guard<std::mutex> lock(m);
+    step = 2;
+    cv.notify_all();
+  }
+  first.join();
+}
+
+//Frees a block in its destructor, after the thread cache is gone
+struct late_free {
+  void* p = nullptr;
+  ~late_free() {
+    size_class_pool::deallocate(p, 4096);
+    freed = p;
+  }
+  static void* freed;
+};
+void* late_free::freed = nullptr;
+
+TEST(PoolTest, ThreadExit) {
+  //Short lived threads using every class, each one reuses what the exited ones left behind
+  size_t slabs = size_class_pool::slabs();
+  for(int t = 0; t < 50; ++t) {
+    std::thread([]() {
+      //Constructed before the thread cache, so destroyed after it, lf last
+      static thread_local late_free lf;
+      static thread_local std::vector<int, pool_allocator<int>> late;
+      //The block freed by the previous thread's late destructor is at the head of the depot
+      lf.p = size_class_pool::allocate(4096);
+      if(late_free::freed != nullptr) {
+        ASSERT_EQ(late_free::freed, lf.p);
+      }
+      late.resize(1000);
+      for(int c = 0; c < size_class_pool::num_classes; ++c) {
+        size_t size = size_class_pool::class_size(c);
+        void* p = size_class_pool::allocate(size);
+        memset(p, 0x5A, size);
+        size_class_pool::deallocate(p, size);
+      }
+    }).join();
+  }
+  ASSERT_LE(size_class_pool::slabs() - slabs, size_t(2 * size_class_pool::num_classes));
+}
@@ -0,0 +1,103 @@
+#include <rank_select.hh>
+#include "driver.hh"
+
+#include <vector>
+
+using namespace std;
+
+//Random bitmap where each bit is set with probability about 1 / (1 << sparsity)
+static std::vector<uint64_t> random_bitmap(size_t nbits, int sparsity, uint64_t seed) {
+  std::vector<uint64_t> v((nbits + 63) / 64);
+  xorshift64 next(seed);
+  for(auto& w : v) {
+    w = next();
+    for(int i = 0; i < sparsity; ++i) w &= next();
+  }
+  return v;
+}
+
+static void check(const std::vector<uint64_t>& bits, size_t nbits) {
+  rank_select rs(bits.data(), nbits);
+  ASSERT_EQ(nbits, rs.size());
+  size_t ones = 0;
+  for(size_t i = 0; i < nbits; ++i) {
+    ASSERT_EQ(ones, rs.rank1(i)) << i;
+    ASSERT_EQ(i - ones, rs.rank0(i)) << i;
+    bool b = testbit(bits[i / 64], int(i % 64));
+    ASSERT_EQ(b, rs.test(i)) << i;
+    if(b) {
+      ASSERT_EQ(i, rs.select1(ones)) << ones;
+      ++ones;
+    }
+  }
+  ASSERT_EQ(ones, rs.rank1(nbits));
+  ASSERT_EQ(ones, rs.count());
+}
+
+TEST(RankSelectTest, Empty) {
+  std::vector<uint64_t> bits(4, 0);
+  check(bits, 0);
+  check(bits, 200);
+}
+
+TEST(RankSelectTest, Full) {
+  std::vector<uint64_t> bits(100, ~uint64_t(0));
+  check(bits, 64 * 100);
+  check(bits, 4096);
+  check(bits, 64 * 100 - 7);
+}
+
+TEST(RankSelectTest, Dense) {
+  check(random_bitmap(100000, 0, 1), 100000);
+  check(random_bitmap(65536, 0, 2), 65536);
+}
+
+TEST(RankSelectTest, Sparse) {
+  check(random_bitmap(200000, 3, 3), 200000);
+  check(random_bitmap(300001, 6, 4), 300001);
+}
+
+TEST(RankSelectTest, TrailingGarbage) {
+  //Bits past the end must not be counted
+  std::vector<uint64_t> bits(3, ~uint64_t(0));
+  rank_select rs(bits.data(), 130);
+  ASSERT_EQ(130u, rs.count());
+  ASSERT_EQ(129u, rs.select1(129));
+}
+
+//Position of the 1 bit of rank r in w, one bit at a time
+static int naive_select(uint64_t w, int r) {
+  for(int i = 0; i < 64; ++i) {
+    if(testbit(w, i) && r-- == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static void check_select_in_word(uint64_t w) {
+  for(int r = 0; r < popcount(w); ++r) {
+    ASSERT_EQ(naive_select(w, r), bitops_detail::select_in_word_broadword(w, r)) << w << " " << r;
+    ASSERT_EQ(naive_select(w, r), bitops_detail::select_in_word(w, r)) << w << " " << r;
+  }
+}
+
+TEST(RankSelectTest, SelectInWord) {
+  //The broadword select is only used by select1 without a fast PDEP
+  check_select_in_word(0);
+  for(int i = 0; i < 64; ++i) {
+    check_select_in_word(shll(uint64_t(1), i));
+    check_select_in_word(rstbitsge(~uint64_t(0), i));
+    check_select_in_word(~rstbitsge(~uint64_t(0), i));
+  }
+  check_select_in_word(~uint64_t(0));
+  check_select_in_word(uint64_t(1) << 63);
+  check_select_in_word(0x8000000000000001ULL);
+  check_select_in_word(0xFF000000000000FFULL);
+  xorshift64 rng;
+  for(int k = 0; k < 10000; ++k) {
+    uint64_t w = rng();
+    check_select_in_word(w);
+    check_select_in_word(w & rng() & rng());
+  }
+}
@@ -0,0 +1,141 @@
+#include "driver.hh"
+
+#include <bitops.hh>
+
+#include <vector>
+
+using namespace std;
+
+TEST(RevBitsTest, Rev8) {
+  ASSERT_EQ(uint8_t(0x80), reverse_bits(uint8_t(0x01)));
+  ASSERT_EQ(uint8_t(0x3A), reverse_bits(uint8_t(0x5C)));
+  ASSERT_EQ(uint8_t(0x5C), reverse_bits(uint8_t(0x5C), 1, 1));
+  ASSERT_EQ(uint8_t(0x9A), reverse_bits(uint8_t(0x65), 1, 2));
+  ASSERT_EQ(uint8_t(0xC5), reverse_bits(uint8_t(0x5C), 4));
+  ASSERT_EQ(uint8_t(0x35), reverse_bits(uint8_t(0x5C), 2));
+}
+
+TEST(RevBitsTest, Rev32) {
+  ASSERT_EQ(uint32_t(0x80000000UL), reverse_bits(uint32_t(0x00000001UL)));
+  ASSERT_EQ(uint32_t(0x1E6A2C48UL), reverse_bits(uint32_t(0x12345678UL)));
+  ASSERT_EQ(uint32_t(0x78563412UL), reverse_bits(uint32_t(0x12345678UL), 8));
+  ASSERT_EQ(uint32_t(0x87654321UL), reverse_bits(uint32_t(0x12345678UL), 4));
+  ASSERT_EQ(uint32_t(0x482C6A1EUL), reverse_bits(uint32_t(0x12345678UL), 1, 8));
+  ASSERT_EQ(uint32_t(0x56781234UL), reverse_bits(uint32_t(0x12345678UL), 16, 2));
+}
+
+TEST(RevBitsTest, Shuffle) {
+  //abcdefgh -> aebfcgdh
+  ASSERT_EQ(uint8_t(0xAA), outer_pshuffle(uint8_t(0xF0)));
+  ASSERT_EQ(uint8_t(0xF0), outer_punshuffle(uint8_t(0xAA)));
+  //abcdefgh -> eafbgchd
+  ASSERT_EQ(uint8_t(0x55), inner_pshuffle(uint8_t(0xF0)));
+  ASSERT_EQ(uint8_t(0xF0), inner_punshuffle(uint8_t(0x55)));
+  ASSERT_EQ(uint32_t(0x12345678UL), inner_punshuffle(inner_pshuffle(uint32_t(0x12345678UL))));
+  ASSERT_EQ(uint32_t(0x12345678UL), outer_punshuffle(outer_pshuffle(uint32_t(0x12345678UL))));
+}
+
+template <typename T>
+class RevBitsArrayTest : public ::testing::Test {
+};
+TYPED_TEST_CASE_P(RevBitsArrayTest);
+
+TYPED_TEST_P(RevBitsArrayTest, Array) {
+  typedef TypeParam T;
+  constexpr int nbits = int(sizeof(T) * CHAR_BIT);
+
+  std::vector<T> src(301);
+  xorshift64 rng;
+  for(auto& x : src) x = T(rng());
+  for(int sub = 1; sub <= nbits; sub *= 2) {
+    for(int grp = 1; grp <= nbits / sub; grp *= 2) {
+      for(size_t off = 0; off < 3; ++off) {
+        size_t n = src.size() - off;
+        std::vector<T> dst(n);
+        reverse_bits(src.data() + off, dst.data(), n, sub, grp);
+        for(size_t i = 0; i < n; ++i) {
+          ASSERT_EQ(reverse_bits(src[off + i], sub, grp), dst[i]) << sub << " " << grp << " " << i;
+        }
+        std::vector<T> inplace(src.begin() + off, src.end());
+        reverse_bits(inplace.data(), n, sub, grp);
+        ASSERT_EQ(dst, inplace);
+      }
+    }
+  }
+
+  std::vector<T> dst(src.size());
+  reverse_bits(src.data(), dst.data(), src.size());
+  for(size_t i = 0; i < src.size(); ++i) {
+    ASSERT_EQ(reverse_bits(src[i]), dst[i]);
+  }
+}
+
+REGISTER_TYPED_TEST_CASE_P(RevBitsArrayTest, Array);
+INSTANTIATE_TYPED_TEST_CASE_P(Ints, RevBitsArrayTest, IntTypes);
+
+//The template forms are usable in constant expressions and map to byte swaps and rotates
+static_assert(reverse_bits<8>(uint32_t(0x12345678UL)) == uint32_t(0x78563412UL), "");
+static_assert(reverse_bits<8, 2>(uint32_t(0x12345678UL)) == uint32_t(0x34127856UL), "");
+static_assert(reverse_bits<1>(uint8_t(0x01)) == uint8_t(0x80), "");
+static_assert(reverse_bits<4>(uint8_t(0x5C)) == uint8_t(0xC5), "");
+static_assert(reverse_bits<1, 8>(uint64_t(0x0102040810204080ULL)) == uint64_t(0x8040201008040201ULL), "");
+static_assert(reverse_bytes<1, 4>(uint64_t(0x0123456789ABCDEFULL)) == uint64_t(0x67452301EFCDAB89ULL), "");
+static_assert(reverse_bytes<2>(int32_t(0x12345678L)) == int32_t(0x56781234L), "");
+
+template <typename T>
+class RevBitsFixedTest : public ::testing::Test {
+};
+TYPED_TEST_CASE_P(RevBitsFixedTest);
+
+//Subwords wider than T are rejected at compile time
+template <int S, int G, typename T>
+  auto check_fixed(const std::vector<T>&) -> typename std::enable_if<(S > int(sizeof(T) * CHAR_BIT))>::type {
+  }
+
+template <int S, int G, typename T>
+  auto check_fixed(const std::vector<T>& src) -> typename std::enable_if<(S <= int(sizeof(T) * CHAR_BIT))>::type {
+    for(T x : src) {
+      ASSERT_EQ(reverse_bits(x, S, G), (reverse_bits<S, G>(x))) << S << " " << G;
+      if(S >= 8) {
+        ASSERT_EQ(reverse_bytes(x, S / 8, G), (reverse_bytes<(S >= 8 ? S / 8 : 1), G>(x))) << S << " " << G;
+      }
+      if(G == 128) {
+        ASSERT_EQ(reverse_bits(x, S), reverse_bits<S>(x)) << S;
+      }
+    }
+  }
+
+template <int S, typename T>
+  void check_fixed_groups(const std::vector<T>& src) {
+    check_fixed<S, 1>(src);
+    check_fixed<S, 2>(src);
+    check_fixed<S, 4>(src);
+    check_fixed<S, 8>(src);
+    check_fixed<S, 16>(src);
+    check_fixed<S, 32>(src);
+    check_fixed<S, 64>(src);
+    check_fixed<S, 128>(src);
+  }
+
+TYPED_TEST_P(RevBitsFixedTest, Fixed) {
+  typedef TypeParam T;
+
+  std::vector<T> src(64);
+  xorshift64 rng;
+  for(auto& x : src) x = T(rng());
+  src[0] = std::numeric_limits<T>::min();
+  src[1] = std::numeric_limits<T>::max();
+  src[2] = T(1);
+
+  check_fixed_groups<1>(src);
+  check_fixed_groups<2>(src);
+  check_fixed_groups<4>(src);
+  check_fixed_groups<8>(src);
+  check_fixed_groups<16>(src);
+  check_fixed_groups<32>(src);
+  check_fixed_groups<64>(src);
+  ASSERT_EQ(reverse_bytes(src[3]), reverse_bytes<1>(src[3]));
+}
+
+REGISTER_TYPED_TEST_CASE_P(RevBitsFixedTest, Fixed);
+INSTANTIATE_TYPED_TEST_CASE_P(Ints, RevBitsFixedTest, IntTypes);
@@ -2,6 +2,8 @@
 
 #include <bitops.hh>
 
+#include <vector>
+
 using namespace std;
 
 TEST(RevBytesTest, Rev8) {
@@ -85,3 +87,40 @@ TEST(RevBytesTest, RevI64) {
   ASSERT_EQ(int64_t(0xDDCCBBAA44332211UL), reverse_bytes(int64_t(0x44332211DDCCBBAAUL), 4, 2));
 }
 
+
+template <typename T>
+class RevBytesArrayTest : public ::testing::Test {
+};
+TYPED_TEST_CASE_P(RevBytesArrayTest);
+
+TYPED_TEST_P(RevBytesArrayTest, Array) {
+  typedef TypeParam T;
+
+  std::vector<T> src(301);
+  xorshift64 rng;
+  for(auto& x : src) x = T(rng());
+  for(int bpb = 1; bpb <= int(sizeof(T)); bpb *= 2) {
+    for(int bpg = 1; bpg <= int(sizeof(T)); bpg *= 2) {
+      for(size_t off = 0; off < 3; ++off) {
+        size_t n = src.size() - off;
+        std::vector<T> dst(n);
+        reverse_bytes(src.data() + off, dst.data(), n, bpb, bpg);
+        for(size_t i = 0; i < n; ++i) {
+          ASSERT_EQ(reverse_bytes(src[off + i], bpb, bpg), dst[i]) << bpb << " " << bpg << " " << i;
+        }
+        std::vector<T> inplace(src.begin() + off, src.end());
+        reverse_bytes(inplace.data(), n, bpb, bpg);
+        ASSERT_EQ(dst, inplace);
+      }
+    }
+  }
+
+  std::vector<T> dst(src.size());
+  reverse_bytes(src.data(), dst.data(), src.size());
+  for(size_t i = 0; i < src.size(); ++i) {
+    ASSERT_EQ(reverse_bytes(src[i]), dst[i]);
+  }
+}
+
+REGISTER_TYPED_TEST_CASE_P(RevBytesArrayTest, Array);
+INSTANTIATE_TYPED_TEST_CASE_P(Ints, RevBytesArrayTest, IntTypes);
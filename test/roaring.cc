@@ -0,0 +1,176 @@
+#include <roaring_bitmap.hh>
+#include "driver.hh"
+
+#include <set>
+#include <vector>
+
+using namespace std;
+
+//Values which make all 3 kinds of containers: sparse values, a dense chunk, long runs, and the ends of the range
+static std::set<uint32_t> random_values(uint64_t seed) {
+  std::set<uint32_t> v;
+  xorshift64 rng(seed);
+  for(int i = 0; i < 3000; ++i) v.insert(uint32_t(rng()));
+  for(int i = 0; i < 20000; ++i) v.insert(0x50000 | uint32_t(rng() % 0x10000));
+  for(int i = 0; i < 40; ++i) {
+    const uint64_t s = rng();
+    uint32_t first = 0x70000 + uint32_t(s % 0x20000);
+    for(uint32_t x = first; x < first + uint32_t(s >> 40) % 3000; ++x) {
+      v.insert(x);
+    }
+  }
+  v.insert(0);
+  v.insert(0xFFFF);
+  v.insert(0x10000);
+  v.insert(0xFFFFFFFF);
+  return v;
+}
+
+static roaring_bitmap make(const std::set<uint32_t>& v) {
+  roaring_bitmap b;
+  for(uint32_t x : v) {
+    b.set(x);
+  }
+  return b;
+}
+
+//Compares b against v at the values, their neighbours, and by iterating
+template <typename B>
+static void check(const B& b, const std::set<uint32_t>& v) {
+  ASSERT_EQ(v.size(), b.count());
+  ASSERT_EQ(v.empty(), b.empty());
+  for(uint32_t x : v) {
+    ASSERT_TRUE(b.test(x)) << x;
+    ASSERT_EQ(v.count(x + 1) != 0, b.test(x + 1)) << x + 1;
+    ASSERT_EQ(v.count(x - 1) != 0, b.test(x - 1)) << x - 1;
+  }
+  std::vector<uint32_t> got;
+  b.for_each([&](uint32_t x) { got.push_back(x); });
+  ASSERT_TRUE(std::equal(v.begin(), v.end(), got.begin()));
+  ASSERT_EQ(v.size(), got.size());
+}
+
+TEST(RoaringBitmapTest, Empty) {
+  roaring_bitmap b;
+  ASSERT_TRUE(b.empty());
+  ASSERT_EQ(0u, b.count());
+  ASSERT_FALSE(b.test(0));
+  b.set(7);
+  b.reset(7);
+  ASSERT_TRUE(b.empty());
+  ASSERT_EQ(8u, b.serialized_size());
+}
+
+TEST(RoaringBitmapTest, SetReset) {
+  std::set<uint32_t> v = random_values(0x9E3779B97F4A7C15ULL);
+  roaring_bitmap b = make(v);
+  check(b, v);
+
+  //Removing most of the dense chunk turns it back into an array
+  xorshift64 rng(0x2545F4914F6CDD1DULL);
+  for(int i = 0; i < 60000; ++i) {
+    const uint64_t s = rng();
+    uint32_t x = i < 50000 ? 0x50000 | uint32_t(s % 0x10000) : uint32_t(s);
+    v.erase(x);
+    b.reset(x);
+  }
+  check(b, v);
+}
+
+TEST(RoaringBitmapTest, RunOptimize) {
+  std::set<uint32_t> v = random_values(0x9E3779B97F4A7C15ULL);
+  //A full chunk is 1 run
+  for(uint32_t x = 0x30000; x < 0x40000; ++x) {
+    v.insert(x);
+  }
+  roaring_bitmap b = make(v);
+  size_t before = b.serialized_size();
+  b.run_optimize();
+  check(b, v);
+  ASSERT_LT(b.serialized_size(), before);
+
+  //Changing run containers
+  for(uint32_t x : {0x30005u, 0x70000u, 0x7FFFFu, 0x8ABCDu}) {
+    b.reset(x);
+    v.erase(x);
+  }
+  b.set(0x12345678);
+  v.insert(0x12345678);
+  check(b, v);
+  b.run_optimize();
+  check(b, v);
+}
+
+TEST(RoaringBitmapTest, AndOr) {
+  std::set<uint32_t> va = random_values(0x9E3779B97F4A7C15ULL);
+  std::set<uint32_t> vb = random_values(0x2545F4914F6CDD1DULL);
+  for(uint32_t x = 0x52000; x < 0x5C000; ++x) {
+    vb.insert(x);
+  }
+  std::set<uint32_t> vand, vor;
+  std::set_intersection(va.begin(), va.end(), vb.begin(), vb.end(), std::inserter(vand, vand.end()));
+  std::set_union(va.begin(), va.end(), vb.begin(), vb.end(), std::inserter(vor, vor.end()));
+
+  roaring_bitmap a = make(va);
+  roaring_bitmap b = make(vb);
+  for(int optimize = 0; optimize < 3; ++optimize) {
+    check(a & b, vand);
+    check(b & a, vand);
+    check(a | b, vor);
+    check(b | a, vor);
+    check(a & a, va);
+    check(a | a, va);
+    check(a & roaring_bitmap(), std::set<uint32_t>());
+    check(a | roaring_bitmap(), va);
+    //Run containers on one side, then both
+    (optimize == 0 ? a : b).run_optimize();
+  }
+}
+
+TEST(RoaringBitmapTest, Serialize) {
+  std::set<uint32_t> v = random_values(0x9E3779B97F4A7C15ULL);
+  roaring_bitmap b = make(v);
+  for(int optimize = 0; optimize < 2; ++optimize) {
+    //At an odd address, as in a file with other data before it
+    std::vector<unsigned char> buf(b.serialized_size() + 1, 0xAA);
+    b.serialize(buf.data() + 1);
+    roaring_view r(buf.data() + 1, buf.size() - 1);
+    ASSERT_TRUE(r.valid());
+    check(r, v);
+    b.run_optimize();
+  }
+
+  roaring_view e;
+  ASSERT_FALSE(e.valid());
+  ASSERT_TRUE(e.empty());
+  ASSERT_FALSE(e.test(0));
+  std::vector<unsigned char> buf(roaring_bitmap().serialized_size());
+  roaring_bitmap().serialize(buf.data());
+  roaring_view r(buf.data(), buf.size());
+  ASSERT_TRUE(r.valid());
+  check(r, std::set<uint32_t>());
+}
+
+TEST(RoaringBitmapTest, InvalidBuffers) {
+  std::set<uint32_t> v = random_values(0x9E3779B97F4A7C15ULL);
+  roaring_bitmap b = make(v);
+  b.run_optimize();
+  std::vector<unsigned char> buf(b.serialized_size());
+  b.serialize(buf.data());
+
+  //Every truncation is found
+  for(size_t n = 0; n < buf.size(); n += n < 200 ? 1 : 97) {
+    ASSERT_FALSE(roaring_view(buf.data(), n).valid()) << n;
+  }
+  ASSERT_TRUE(roaring_view(buf.data(), buf.size()).valid());
+
+  //Bad magic, kind, offset, size, and order of keys
+  for(size_t i : {0, 10, 19, 23}) {
+    std::vector<unsigned char> bad = buf;
+    bad[i] ^= 0x40;
+    ASSERT_FALSE(roaring_view(bad.data(), bad.size()).valid()) << i;
+  }
+  std::vector<unsigned char> bad = buf;
+  std::memcpy(&bad[24], &bad[8], 2);
+  ASSERT_FALSE(roaring_view(bad.data(), bad.size()).valid());
+}
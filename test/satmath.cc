@@ -1,6 +1,9 @@
 #include <bitops.hh>
 #include "driver.hh"
 
+#include <algorithm>
+#include <vector>
+
 using namespace std;
 
 template <typename T>
@@ -16,26 +19,117 @@ TYPED_TEST_P(SatMathTest, Add) {
 
   auto lmax = std::numeric_limits<L>::max();
   auto rmax = std::numeric_limits<R>::max();
+  auto lmin = std::numeric_limits<L>::min();
+  auto rmin = std::numeric_limits<R>::min();
   auto lrmax = std::numeric_limits<LR>::max();
+  auto lrmin = std::numeric_limits<LR>::min();
 
   if(sizeof(L) == sizeof(LR) && samesign) {
     ASSERT_EQ(lrmax, satadd(lmax, R(1)));
+    ASSERT_EQ(lrmin, satadd(lmin, R(0)));
   }
   if(sizeof(R) == sizeof(LR) && samesign) {
     ASSERT_EQ(lrmax, satadd(L(1), rmax));
   }
+  if(sizeof(L) == sizeof(LR) && samesign && std::is_signed<R>::value) {
+    ASSERT_EQ(lrmin, satadd(lmin, R(-1)));
+  }
+  if(sizeof(R) == sizeof(LR) && samesign && std::is_signed<L>::value) {
+    ASSERT_EQ(lrmin, satadd(L(-1), rmin));
+  }
+  ASSERT_EQ(LR(3), satadd(L(1), R(2)));
 };
 
 TYPED_TEST_P(SatMathTest, Sub) {
   typedef typename TypeParam::first_type L;
   typedef typename TypeParam::second_type R;
   typedef decltype(L() - R()) LR;
+  constexpr bool samesign = std::is_signed<L>::value == std::is_signed<R>::value;
 
-  //auto lrmax = std::numeric_limits<LR>::max();
-  //auto lrmin = std::numeric_limits<LR>::min();
+  auto lmax = std::numeric_limits<L>::max();
+  auto lmin = std::numeric_limits<L>::min();
+  auto lrmax = std::numeric_limits<LR>::max();
+  auto lrmin = std::numeric_limits<LR>::min();
 
+  if(sizeof(L) == sizeof(LR) && samesign) {
+    ASSERT_EQ(lrmin, satsub(lmin, R(1)));
+    ASSERT_EQ(lrmax, satsub(lmax, R(0)));
+  }
+  if(sizeof(L) == sizeof(LR) && samesign && std::is_signed<R>::value) {
+    ASSERT_EQ(lrmax, satsub(lmax, R(-1)));
+  }
+  ASSERT_EQ(LR(1), satsub(L(3), R(2)));
 };
 
 REGISTER_TYPED_TEST_CASE_P(SatMathTest, Add, Sub);
 INSTANTIATE_TYPED_TEST_CASE_P(Ints, SatMathTest, IntPairTypes);
 
+template <typename T>
+class SatMathArrayTest : public ::testing::Test {
+};
+TYPED_TEST_CASE_P(SatMathArrayTest);
+
+//Saturated to T, unlike the scalar functions which saturate to the promoted type
+template <typename T>
+T ref_satadd(T a, T b) {
+  return std::is_signed<T>::value ?
+    T(std::max<int64_t>(std::numeric_limits<T>::min(), std::min<int64_t>(std::numeric_limits<T>::max(), satadd(int64_t(a), int64_t(b))))) :
+    T(std::min<uint64_t>(std::numeric_limits<T>::max(), satadd(uint64_t(a), uint64_t(b))));
+}
+
+template <typename T>
+T ref_satsub(T a, T b) {
+  return std::is_signed<T>::value ?
+    T(std::max<int64_t>(std::numeric_limits<T>::min(), std::min<int64_t>(std::numeric_limits<T>::max(), satsub(int64_t(a), int64_t(b))))) :
+    T(satsub(uint64_t(a), uint64_t(b)));
+}
+
+template <typename T>
+std::vector<T> sat_inputs(uint64_t seed, size_t n) {
+  std::vector<T> v(n);
+  xorshift64 rng(seed);
+  for(auto& x : v) x = T(rng());
+  v[0] = std::numeric_limits<T>::max();
+  v[1] = std::numeric_limits<T>::min();
+  return v;
+}
+
+TYPED_TEST_P(SatMathArrayTest, AddSub) {
+  typedef TypeParam T;
+
+  const size_t n = 203;
+  std::vector<T> a = sat_inputs<T>(0x9E3779B97F4A7C15ULL, n);
+  std::vector<T> b = sat_inputs<T>(0x2545F4914F6CDD1DULL, n);
+  std::vector<T> sum(n), diff(n);
+  satadd(a.data(), b.data(), sum.data(), n);
+  satsub(a.data(), b.data(), diff.data(), n);
+  for(size_t i = 0; i < n; ++i) {
+    ASSERT_EQ(ref_satadd(a[i], b[i]), sum[i]) << i;
+    ASSERT_EQ(ref_satsub(a[i], b[i]), diff[i]) << i;
+  }
+}
+
+TYPED_TEST_P(SatMathArrayTest, Accumulate) {
+  typedef TypeParam T;
+
+  const size_t n = 203;
+  std::vector<std::vector<T>> streams;
+  std::vector<const T*> src;
+  for(uint64_t k = 0; k < 5; ++k) {
+    streams.push_back(sat_inputs<T>(0x9E3779B97F4A7C15ULL * (k + 1), n));
+    src.push_back(streams.back().data());
+  }
+  std::vector<T> dst(n);
+  satadd(src.data(), src.size(), dst.data(), n);
+  for(size_t i = 0; i < n; ++i) {
+    T acc = streams[0][i];
+    for(size_t k = 1; k < streams.size(); ++k) acc = ref_satadd(acc, streams[k][i]);
+    ASSERT_EQ(acc, dst[i]) << i;
+  }
+
+  satadd(src.data(), 0, dst.data(), n);
+  ASSERT_EQ(std::vector<T>(n, T(0)), dst);
+}
+
+REGISTER_TYPED_TEST_CASE_P(SatMathArrayTest, AddSub, Accumulate);
+INSTANTIATE_TYPED_TEST_CASE_P(Ints, SatMathArrayTest, IntTypes);
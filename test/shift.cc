@@ -18,6 +18,25 @@ TYPED_TEST_P(ShiftTest, Shll) {
   ASSERT_EQ(T(32), shll(T(16), 1));
 };
 
-REGISTER_TYPED_TEST_CASE_P(ShiftTest, Shll);
+TYPED_TEST_P(ShiftTest, Rotate) {
+  typedef TypeParam T;
+  typedef typename std::make_unsigned<T>::type U;
+  constexpr int nbits = int(sizeof(T) * CHAR_BIT);
+
+  //Includes negative values of signed types and rotation by 0 and by the full width
+  for(T x : {T(1), T(0x5A), T(~T(0x5A)), T(std::numeric_limits<T>::min()), T(std::numeric_limits<T>::max())}) {
+    for(int s = 0; s <= nbits; ++s) {
+      U l = U(x), r = U(x);
+      for(int i = 0; i < s; ++i) {
+        l = U(U(l << 1) | U(l >> (nbits - 1)));
+        r = U(U(r >> 1) | U(r << (nbits - 1)));
+      }
+      ASSERT_EQ(T(l), rotl(x, s));
+      ASSERT_EQ(T(r), rotr(x, s));
+    }
+  }
+}
+
+REGISTER_TYPED_TEST_CASE_P(ShiftTest, Shll, Rotate);
 INSTANTIATE_TYPED_TEST_CASE_P(Ints, ShiftTest, IntTypes);
 
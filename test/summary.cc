@@ -0,0 +1,112 @@
+#include <summary_bitmap.hh>
+#include "driver.hh"
+
+#include <vector>
+
+using namespace std;
+
+static const size_t npos = size_t(summary_bitmap::npos);
+
+static size_t ref_next(const std::vector<bool>& ref, size_t i) {
+  for(; i < ref.size(); ++i) {
+    if(ref[i]) return i;
+  }
+  return npos;
+}
+
+static size_t ref_prev(const std::vector<bool>& ref, size_t i) {
+  for(i = std::min(i, ref.size() - 1) + 1; i-- > 0;) {
+    if(ref[i]) return i;
+  }
+  return npos;
+}
+
+static void check(const summary_bitmap& b, const std::vector<bool>& ref, xorshift64& rng) {
+  bool any = false;
+  for(size_t i = 0; i < ref.size(); ++i) {
+    ASSERT_EQ(bool(ref[i]), b.test(i)) << i;
+    any |= ref[i];
+  }
+  ASSERT_EQ(any, b.any());
+  //Every boundary of the first few words and random positions beyond
+  for(int k = 0; k < 300; ++k) {
+    const uint64_t s = rng();
+    size_t i = k < 200 ? size_t(k) : size_t(s % (ref.size() + 10));
+    ASSERT_EQ(ref_next(ref, i), b.find_next(i)) << i;
+    ASSERT_EQ(ref_prev(ref, i), b.find_prev(i)) << i;
+  }
+  //Walking all of the set bits in both directions
+  size_t n = 0;
+  for(size_t i = b.find_next(0); i != npos; i = b.find_next(i + 1)) {
+    ASSERT_TRUE(ref[i]);
+    ++n;
+  }
+  for(size_t i = b.find_prev(ref.size()); i != npos; i = i == 0 ? npos : b.find_prev(i - 1)) {
+    ASSERT_TRUE(ref[i]);
+    --n;
+  }
+  ASSERT_EQ(0u, n);
+}
+
+TEST(SummaryBitmapTest, Empty) {
+  summary_bitmap b(0);
+  ASSERT_EQ(0u, b.size());
+  ASSERT_FALSE(b.any());
+  ASSERT_EQ(npos, b.find_next(0));
+  ASSERT_EQ(npos, b.find_prev(0));
+}
+
+TEST(SummaryBitmapTest, Bits) {
+  xorshift64 rng;
+  for(size_t nbits : {1, 63, 64, 65, 4096, 4097, 300000}) {
+    summary_bitmap b(nbits);
+    std::vector<bool> ref(nbits);
+    check(b, ref, rng);
+    for(int k = 0; k < 50; ++k) {
+      size_t i = size_t(rng() % nbits);
+      b.set(i);
+      ref[i] = true;
+    }
+    b.set(nbits - 1);
+    ref[nbits - 1] = true;
+    check(b, ref, rng);
+    for(int k = 0; k < 30; ++k) {
+      size_t i = b.find_next(size_t(rng() % nbits));
+      if(i != npos) {
+        b.reset(i);
+        ref[i] = false;
+      }
+    }
+    check(b, ref, rng);
+  }
+}
+
+TEST(SummaryBitmapTest, Ranges) {
+  xorshift64 rng;
+  for(size_t nbits : {1, 64, 100, 5000, 300000}) {
+    summary_bitmap b(nbits);
+    std::vector<bool> ref(nbits);
+    for(int k = 0; k < 40; ++k) {
+      const uint64_t s = rng();
+      size_t first = size_t(s % (nbits + 1));
+      //Mostly short ranges, some spanning several summary words
+      size_t len = size_t(s >> 32) % (k % 4 == 0 ? nbits + 1 : 130);
+      size_t last = std::min(nbits, first + len);
+      bool set = k % 3 != 2;
+      if(set) {
+        b.set(first, last);
+      } else {
+        b.reset(first, last);
+      }
+      for(size_t i = first; i < last; ++i) {
+        ref[i] = set;
+      }
+      check(b, ref, rng);
+    }
+    b.reset(0, nbits);
+    ASSERT_FALSE(b.any());
+    b.set(0, nbits);
+    ASSERT_EQ(0u, b.find_next(0));
+    ASSERT_EQ(nbits - 1, b.find_prev(nbits));
+  }
+}
@@ -0,0 +1,93 @@
+#include <bitops.hh>
+#include "driver.hh"
+
+#include <vector>
+
+using namespace std;
+
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201304
+static_assert(transpose8(0x00000000000000FFULL) == 0x0101010101010101ULL, "");
+static_assert(transpose8(0x8040201008040201ULL) == 0x8040201008040201ULL, "");
+#endif
+
+template <typename T>
+class TransposeTest : public ::testing::Test {
+};
+TYPED_TEST_CASE_P(TransposeTest);
+typedef ::testing::Types<uint32_t, uint64_t> TransposeTypes;
+
+template <typename T>
+static std::vector<T> transpose_inputs(size_t n) {
+  std::vector<T> v(n);
+  xorshift64 rng;
+  for(auto& x : v) x = T(rng());
+  return v;
+}
+
+static void transpose(const uint32_t* src, uint32_t* dst, size_t n) { transpose32(src, dst, n); }
+static void transpose(const uint64_t* src, uint64_t* dst, size_t n) { transpose64(src, dst, n); }
+static void transpose(uint32_t* m) { transpose32(m); }
+static void transpose(uint64_t* m) { transpose64(m); }
+
+TEST(TransposeTest, Transpose8) {
+  xorshift64 rng;
+  for(int k = 0; k < 1000; ++k) {
+    const uint64_t r = rng();
+    uint64_t t = transpose8(r);
+    for(int i = 0; i < 8; ++i) {
+      for(int j = 0; j < 8; ++j) {
+        ASSERT_EQ(testbit(r, 8 * i + j), testbit(t, 8 * j + i));
+      }
+    }
+    ASSERT_EQ(r, transpose8(t));
+  }
+}
+
+TYPED_TEST_P(TransposeTest, Blocks) {
+  typedef TypeParam T;
+  constexpr size_t n = sizeof(T) * CHAR_BIT;
+
+  for(size_t nblocks : {0, 1, 2, 5}) {
+    std::vector<T> src = transpose_inputs<T>(n * nblocks + 1);
+    std::vector<T> dst(src.size());
+    transpose(src.data(), dst.data(), nblocks);
+    for(size_t b = 0; b < nblocks; ++b) {
+      for(size_t i = 0; i < n; ++i) {
+        for(size_t j = 0; j < n; ++j) {
+          ASSERT_EQ(testbit(src[n * b + i], int(j)), testbit(dst[n * b + j], int(i))) << b << " " << i << " " << j;
+        }
+      }
+    }
+    //Nothing past the last block is written
+    ASSERT_EQ(T(0), dst.back());
+
+    //In place, and back again
+    std::vector<T> m = dst;
+    transpose(m.data(), m.data(), nblocks);
+    ASSERT_TRUE(std::equal(m.begin(), m.end() - 1, src.begin()));
+  }
+
+  std::vector<T> m = transpose_inputs<T>(n);
+  std::vector<T> ref(n);
+  transpose(m.data(), ref.data(), 1);
+  transpose(m.data());
+  ASSERT_EQ(ref, m);
+
+  //The identity matrix and a single column
+  for(size_t i = 0; i < n; ++i) {
+    m[i] = shll(T(1), int(i));
+  }
+  transpose(m.data());
+  for(size_t i = 0; i < n; ++i) {
+    ASSERT_EQ(shll(T(1), int(i)), m[i]);
+  }
+  std::fill(m.begin(), m.end(), T(1));
+  transpose(m.data());
+  ASSERT_EQ(T(~T(0)), m[0]);
+  for(size_t i = 1; i < n; ++i) {
+    ASSERT_EQ(T(0), m[i]);
+  }
+}
+
+REGISTER_TYPED_TEST_CASE_P(TransposeTest, Blocks);
+INSTANTIATE_TYPED_TEST_CASE_P(Words, TransposeTest, TransposeTypes);
@@ -0,0 +1,157 @@
+#include <varint.hh>
+#include "driver.hh"
+
+#include <vector>
+
+using namespace std;
+
+template <typename T>
+class VarintTest : public ::testing::Test {
+};
+TYPED_TEST_CASE_P(VarintTest);
+
+//Byte at a time reference encoder
+template <typename U>
+static std::vector<unsigned char> leb128(U u) {
+  std::vector<unsigned char> b;
+  do {
+    b.push_back((unsigned char)((u & 0x7F) | (u > 0x7F ? 0x80 : 0)));
+    u = U(u >> 7);
+  } while(u != 0);
+  return b;
+}
+
+//Values with every number of significant bits, mixed signs for the signed types
+template <typename T>
+static std::vector<T> varint_values() {
+  std::vector<T> v;
+  xorshift64 rng;
+  for(int i = 0; i < 2000; ++i) {
+    const uint64_t r = rng();
+    v.push_back(T(shlr(r, int(r % 64))));
+  }
+  v.push_back(std::numeric_limits<T>::min());
+  v.push_back(std::numeric_limits<T>::max());
+  v.push_back(T(0));
+  return v;
+}
+
+TYPED_TEST_P(VarintTest, ZigZag) {
+  typedef TypeParam T;
+  typedef typename make_unsigned<T>::type U;
+  typedef typename make_signed<T>::type S;
+
+  ASSERT_EQ(U(0), zigzag_encode(S(0)));
+  ASSERT_EQ(U(1), zigzag_encode(S(-1)));
+  ASSERT_EQ(U(2), zigzag_encode(S(1)));
+  ASSERT_EQ(U(~U(0)), zigzag_encode(std::numeric_limits<S>::min()));
+  ASSERT_EQ(U(~U(1)), zigzag_encode(std::numeric_limits<S>::max()));
+  for(S x : varint_values<S>()) {
+    ASSERT_EQ(x, zigzag_decode(zigzag_encode(x)));
+  }
+}
+
+TYPED_TEST_P(VarintTest, EncodeDecode) {
+  typedef TypeParam T;
+  typedef typename make_unsigned<T>::type U;
+
+  for(T x : varint_values<T>()) {
+    U u = std::is_signed<T>::value ? U(zigzag_encode(typename make_signed<T>::type(x))) : U(x);
+    std::vector<unsigned char> ref = leb128(u);
+    ASSERT_EQ(ref.size(), varint_size(x)) << x;
+    ASSERT_LE(ref.size(), varint_max_size<T>());
+
+    unsigned char buf[16];
+    memset(buf, 0xEE, sizeof(buf));
+    ASSERT_EQ(ref.size(), varint_encode(x, buf + 1));
+    ASSERT_EQ(0, memcmp(ref.data(), buf + 1, ref.size())) << x;
+    ASSERT_EQ(0xEE, buf[ref.size() + 1]);
+
+    //Decode with and without room for a full word load
+    for(size_t n : {ref.size(), sizeof(buf) - 1}) {
+      T y = T(~x);
+      ASSERT_EQ(ref.size(), varint_decode(buf + 1, n, y)) << x;
+      ASSERT_EQ(x, y);
+    }
+    T y = T(~x);
+    ASSERT_EQ(0u, varint_decode(buf + 1, ref.size() - 1, y));
+    ASSERT_EQ(T(~x), y);
+  }
+}
+
+TYPED_TEST_P(VarintTest, Malformed) {
+  typedef TypeParam T;
+  constexpr size_t max = varint_max_size<T>();
+
+  //One byte too many
+  for(size_t pad : {0, 16}) {
+    std::vector<unsigned char> b(max + 1 + pad, 0);
+    for(size_t i = 0; i < max; ++i) {
+      b[i] = 0x80;
+    }
+    T x = T(0x5A);
+    ASSERT_EQ(0u, varint_decode(b.data(), b.size(), x));
+    //Too large for T
+    b[max - 1] = 0x7F;
+    ASSERT_EQ(0u, varint_decode(b.data(), b.size(), x));
+    ASSERT_EQ(T(0x5A), x);
+    //Overlong but in range
+    b[max - 1] = 0;
+    ASSERT_EQ(max, varint_decode(b.data(), b.size(), x));
+    ASSERT_EQ(T(0), x);
+  }
+}
+
+TYPED_TEST_P(VarintTest, Stream) {
+  typedef TypeParam T;
+
+  //Runs of short values take the single byte paths, the rest mixes all lengths
+  std::vector<T> src = varint_values<T>();
+  for(size_t i = 0; i < 100; ++i) {
+    src.insert(src.begin() + 1000, T(i % 50));
+  }
+  std::vector<unsigned char> buf(src.size() * varint_max_size<T>());
+  varint_writer w(buf.data(), buf.size());
+  ASSERT_EQ(src.size(), w.write(src.data(), src.size()));
+  size_t nbytes = size_t(w.data() - buf.data());
+  size_t expect = 0;
+  for(T x : src) {
+    expect += varint_size(x);
+  }
+  ASSERT_EQ(expect, nbytes);
+
+  //Batches of every size decode to the same values
+  for(size_t batch : {1, 3, 4, 16, 17, 5000}) {
+    varint_reader r(buf.data(), nbytes);
+    std::vector<T> dst(src.size() + 1, T(0x5A));
+    size_t i = 0;
+    while(i < src.size()) {
+      size_t n = std::min(batch, src.size() - i);
+      ASSERT_EQ(n, r.read(dst.data() + i, n)) << batch << " " << i;
+      i += n;
+    }
+    ASSERT_EQ(0u, r.remaining());
+    ASSERT_EQ(0u, r.read(dst.data() + i, 1));
+    ASSERT_EQ(T(0x5A), dst[src.size()]);
+    dst.pop_back();
+    ASSERT_EQ(src, dst) << batch;
+  }
+
+  //Reading stops before a truncated varint
+  buf[nbytes - 1] |= 0x80;
+  varint_reader r(buf.data(), nbytes);
+  std::vector<T> dst(src.size());
+  ASSERT_EQ(src.size() - 1, r.read(dst.data(), dst.size()));
+  ASSERT_EQ(varint_size(src.back()), r.remaining());
+  T x;
+  ASSERT_FALSE(r.read(x));
+
+  //Writing stops at the first value which does not fit
+  varint_writer small(buf.data(), 2);
+  T big[] = { T(1), std::numeric_limits<T>::max(), T(1) };
+  ASSERT_EQ(1u, small.write(big, 3));
+  ASSERT_EQ(1u, small.remaining());
+}
+
+REGISTER_TYPED_TEST_CASE_P(VarintTest, ZigZag, EncodeDecode, Malformed, Stream);
+INSTANTIATE_TYPED_TEST_CASE_P(Ints, VarintTest, IntTypes);
@@ -0,0 +1,216 @@
+#include <bitops.hh>
+#include "driver.hh"
+
+#include <array>
+#include <vector>
+
+using namespace std;
+
+#if defined(__SIZEOF_INT128__)
+typedef unsigned __int128 u128;
+
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201304
+static_assert(cntl0(u128(1)) == 127, "");
+static_assert(cntt0(u128(1) << 100) == 100, "");
+static_assert(popcount(~u128(0)) == 128, "");
+static_assert(reverse_bits(u128(1)) == u128(1) << 127, "");
+static_assert(ceilp2(u128(3) << 70) == u128(1) << 72, "");
+#endif
+
+static std::vector<u128> wide_inputs() {
+  std::vector<u128> v = {0, 1, ~u128(0), u128(1) << 64, u128(1) << 127, u128(0xFFFFFFFFFFFFFFFFULL)};
+  xorshift64 rng;
+  for(int i = 0; i < 64; ++i) {
+    const uint64_t hi = rng();
+    u128 x = u128(hi) << 64 | rng();
+    //Clear a random number of high or low bits to get all counts
+    v.push_back(x >> (i * 2));
+    v.push_back(x << (i * 2));
+  }
+  return v;
+}
+
+static bool bit(u128 x, int i) {
+  return (x >> i) & 1;
+}
+
+TEST(Int128Test, Counting) {
+  for(u128 x : wide_inputs()) {
+    int t0 = 0, l0 = 0, pop = 0;
+    while(t0 < 128 && !bit(x, t0)) ++t0;
+    while(l0 < 128 && !bit(x, 127 - l0)) ++l0;
+    for(int i = 0; i < 128; ++i) pop += bit(x, i);
+
+    ASSERT_EQ(t0, cntt0(x));
+    ASSERT_EQ(l0, cntl0(x));
+    ASSERT_EQ(pop, popcount(x));
+    ASSERT_EQ(pop & 1, parity(x));
+    ASSERT_EQ(t0, cntt0(__int128(x)));
+    ASSERT_EQ(l0, cntl0(__int128(x)));
+    ASSERT_EQ(cntt0(~x), cntt1(x));
+    ASSERT_EQ(cntl0(~x), cntl1(__int128(x)));
+  }
+}
+
+TEST(Int128Test, Shifts) {
+  for(u128 x : wide_inputs()) {
+    for(int s = 0; s < 128; ++s) {
+      ASSERT_TRUE(x << s == shll(x, s));
+      ASSERT_TRUE(x >> s == shlr(x, s));
+      ASSERT_TRUE(__int128(x) >> s == shar(__int128(x), s));
+      u128 l = s == 0 ? x : x << s | x >> (128 - s);
+      u128 r = s == 0 ? x : x >> s | x << (128 - s);
+      ASSERT_TRUE(l == rotl(x, s));
+      ASSERT_TRUE(r == rotr(x, s));
+      ASSERT_TRUE(__int128(l) == rotl(__int128(x), s));
+    }
+  }
+}
+
+TEST(Int128Test, Reverse) {
+  for(u128 x : wide_inputs()) {
+    for(int sub = 1; sub <= 128; sub *= 2) {
+      for(int group = 1; group * sub <= 128; group *= 2) {
+        int k = group * sub - sub;
+        u128 expected = 0;
+        for(int i = 0; i < 128; ++i) {
+          if(bit(x, i)) expected |= u128(1) << (i ^ k);
+        }
+        ASSERT_TRUE(expected == reverse_bits(x, sub, group)) << sub << " " << group;
+      }
+    }
+    u128 bytes = 0;
+    for(int i = 0; i < 16; ++i) {
+      bytes |= u128(uint8_t(x >> (8 * i))) << (8 * (15 - i));
+    }
+    ASSERT_TRUE(bytes == reverse_bytes(x));
+    ASSERT_TRUE(__int128(bytes) == reverse_bytes(__int128(x)));
+    ASSERT_TRUE(bytes == reverse_bytes<1>(x));
+    ASSERT_TRUE(reverse_bits(x) == reverse_bits<1>(x));
+    ASSERT_TRUE(reverse_bits(x, 1, 8) == (reverse_bits<1, 8>(x)));
+    ASSERT_TRUE(reverse_bits(x, 8, 4) == (reverse_bits<8, 4>(x)));
+    ASSERT_TRUE(reverse_bits(x, 64) == reverse_bits<64>(x));
+    ASSERT_TRUE(reverse_bits(__int128(x), 2) == reverse_bits<2>(__int128(x)));
+    unsigned char buf[17];
+    store_be(buf + 1, x);
+    ASSERT_TRUE(bytes == load_le<u128>(buf + 1));
+    ASSERT_TRUE(x == load_be<u128>(buf + 1));
+  }
+}
+
+TEST(Int128Test, Pow2) {
+  ASSERT_TRUE(u128(0) == ceilp2(u128(0)));
+  for(int b = 0; b < 127; ++b) {
+    u128 p = u128(1) << b;
+    ASSERT_TRUE(p == ceilp2(p));
+    ASSERT_TRUE(p << 1 == ceilp2(u128(p + 1)) || b == 0);
+    ASSERT_TRUE(p == floorp2(u128((p << 1) - 1)));
+  }
+}
+#endif
+
+template <typename N>
+class MultiwordTest : public ::testing::Test {
+};
+TYPED_TEST_CASE_P(MultiwordTest);
+
+template <size_t N>
+static bool bit(const std::array<uint64_t, N>& x, size_t i) {
+  return (x[i / 64] >> (i % 64)) & 1;
+}
+
+template <size_t N>
+static std::vector<std::array<uint64_t, N>> multiword_inputs() {
+  std::vector<std::array<uint64_t, N>> v(3);
+  v[0].fill(0);
+  v[1].fill(~uint64_t(0));
+  v[2].fill(0);
+  v[2][0] = 1;
+  xorshift64 rng;
+  for(size_t i = 0; i < 40; ++i) {
+    std::array<uint64_t, N> x;
+    for(auto& w : x) w = rng();
+    //Clear words at either end so that the scans need to skip some
+    for(size_t j = 0; j < i % (N + 1); ++j) x[i % 2 ? j : N - 1 - j] = 0;
+    if(i % 3 == 0) {
+      std::array<uint64_t, N> p = {};
+      p[i % N] = uint64_t(1) << (i % 64);
+      v.push_back(p);
+    }
+    v.push_back(x);
+  }
+  return v;
+}
+
+TYPED_TEST_P(MultiwordTest, Counting) {
+  constexpr size_t N = TypeParam::value;
+  constexpr size_t nbits = N * 64;
+
+  for(const auto& x : multiword_inputs<N>()) {
+    int t0 = 0, l0 = 0, pop = 0;
+    while(size_t(t0) < nbits && !bit(x, size_t(t0))) ++t0;
+    while(size_t(l0) < nbits && !bit(x, nbits - 1 - size_t(l0))) ++l0;
+    for(size_t i = 0; i < nbits; ++i) pop += bit(x, i);
+
+    ASSERT_EQ(t0, cntt0(x));
+    ASSERT_EQ(l0, cntl0(x));
+    ASSERT_EQ(pop, popcount(x));
+  }
+}
+
+TYPED_TEST_P(MultiwordTest, Shifts) {
+  constexpr size_t N = TypeParam::value;
+  constexpr size_t nbits = N * 64;
+
+  for(const auto& x : multiword_inputs<N>()) {
+    for(size_t s = 0; s < nbits; s += (s < 130 ? 1 : 7)) {
+      std::array<uint64_t, N> l = shll(x, int(s));
+      std::array<uint64_t, N> r = shlr(x, int(s));
+      std::array<uint64_t, N> rl = rotl(x, int(s));
+      std::array<uint64_t, N> rr = rotr(x, int(s));
+      for(size_t i = 0; i < nbits; ++i) {
+        ASSERT_EQ(i >= s && bit(x, i - s), bit(l, i)) << s << " " << i;
+        ASSERT_EQ(i + s < nbits && bit(x, i + s), bit(r, i)) << s << " " << i;
+        ASSERT_EQ(bit(x, (i + nbits - s) % nbits), bit(rl, i)) << s << " " << i;
+        ASSERT_EQ(bit(x, (i + s) % nbits), bit(rr, i)) << s << " " << i;
+      }
+    }
+  }
+}
+
+TYPED_TEST_P(MultiwordTest, Reverse) {
+  constexpr size_t N = TypeParam::value;
+  constexpr size_t nbits = N * 64;
+
+  for(const auto& x : multiword_inputs<N>()) {
+    std::array<uint64_t, N> r = reverse_bits(x);
+    for(size_t i = 0; i < nbits; ++i) {
+      ASSERT_EQ(bit(x, i), bit(r, nbits - 1 - i));
+    }
+  }
+}
+
+TYPED_TEST_P(MultiwordTest, Pow2) {
+  constexpr size_t N = TypeParam::value;
+  constexpr size_t nbits = N * 64;
+
+  for(const auto& x : multiword_inputs<N>()) {
+    std::array<uint64_t, N> p = ceilp2(x);
+    int l = cntl0(x);
+    if(size_t(l) == nbits) {
+      ASSERT_EQ(x, p);
+    } else if(popcount(x) == 1) {
+      ASSERT_EQ(x, p);
+    } else if(l == 0) {
+      ASSERT_EQ(0, popcount(p));
+    } else {
+      ASSERT_EQ(1, popcount(p));
+      ASSERT_EQ(nbits - size_t(l), size_t(cntt0(p)));
+    }
+  }
+}
+
+REGISTER_TYPED_TEST_CASE_P(MultiwordTest, Counting, Shifts, Reverse, Pow2);
+typedef ::testing::Types<std::integral_constant<size_t, 1>, std::integral_constant<size_t, 2>,
+  std::integral_constant<size_t, 3>, std::integral_constant<size_t, 4>> WordCounts;
+INSTANTIATE_TYPED_TEST_CASE_P(Words, MultiwordTest, WordCounts);